@@ -0,0 +1,1148 @@
+#ifdef CINDER_BENCHMARK //Separate executable from the same sources, Main.cpp's main steps aside when this is defined
+#include "VulkanCore.h"
+#include "VulkanWrapper.h"
+#include "VulkanBuffer.h"
+#include "VulkanClusteredLighting.h"
+#include "VulkanGpuProfiler.h"
+#include "VulkanHelper.h"
+#include "VulkanMemoryStats.h"
+#include "VulkanModel.h"
+#include "VulkanParallelRecorder.h"
+#include "VulkanPipelineManager.h"
+#include "VulkanShadowCache.h"
+#include "VulkanTimeline.h"
+#include "DrawSort.h"
+#include "JobSystem.h"
+#include "TextureDecode.h"
+#include "Vertex.h"
+#include "glm/glm.hpp"
+#include "glm/gtc/constants.hpp"
+#include "glm/gtc/matrix_clip_space.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include <SDL2/SDL_events.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+	std::atomic<uint64_t> heapAllocations{ 0 }; //Every operator new in the process, sampled around the measured frames
+}
+
+void* operator new(std::size_t size) {
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+	if (void* pointer = std::malloc(size ? size : 1))
+		return pointer;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
+
+using namespace CinderVk;
+
+namespace {
+	constexpr uint32_t UNIFORM_SLOTS = MAX_FRAMES_IN_FLIGHT + 1; //The slot being written is never one a frame in flight reads
+	constexpr uint32_t INSTANCE_BATCH = 1024; //Instances per draw in the instanced scenes
+	constexpr uint32_t GRID_SIDE = 64; //Match benchmarkVertex.vert
+	constexpr float GRID_SPACING = 3.0f;
+	constexpr uint32_t TEXTURE_SIZE = 64;
+	constexpr uint32_t RANDOM_SEED = 1337; //Fixed, two runs of the same build generate identical scenes
+	constexpr size_t RECORDING_DRAWS = 16 * 1024; //Per recorded frame in the recording scaling run
+	constexpr uint32_t RECORDING_ITERATIONS = 100;
+	constexpr uint32_t STRESS_SLOTS = 4; //Staging ring the ordering stress upload thread cycles through
+	constexpr vk::DeviceSize STRESS_UPLOAD_BYTES = 64 * 1024;
+
+	struct BenchmarkUniforms { //Matches benchmarkVertex.vert
+		glm::mat4 model;
+		glm::mat4 view;
+		glm::mat4 proj;
+	};
+
+	struct BenchmarkOptions {
+		uint32_t warmupFrames = 60;
+		uint32_t measuredFrames = 600;
+		uint32_t width = 1920;
+		uint32_t height = 1080;
+		bool windowed = false;
+		std::string sceneFilter; //Empty runs every scene
+		std::string outputPath; //Empty writes the JSON to stdout
+		std::vector<std::string> decodePaths; //Texture corpus for the decode throughput run, empty skips it
+		bool stressOrdering = false; //Runs the timeline ordering stress instead of the scenes, headless only
+	};
+
+	struct BenchmarkMesh {
+		std::unique_ptr<VulkanModelData> data;
+		vk::DeviceSize gpuBytes = 0;
+	};
+
+	struct BenchmarkDraw {
+		uint32_t mesh;
+		uint32_t material;
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+		glm::vec3 centre; //World space, for the view depth in the sort key
+		float radius; //World space, bounds every instance in the draw, for LOD selection
+		uint32_t pipeline = 0; //Into BenchmarkScene::pipelineKeys
+	};
+
+	struct BenchmarkTexture {
+		vk::Image image;
+		vk::DeviceMemory memory;
+		vk::ImageView view;
+		vk::DeviceSize gpuBytes = 0;
+	};
+
+	struct BenchmarkScene {
+		std::string name;
+		std::vector<BenchmarkMesh> meshes;
+		std::vector<BenchmarkDraw> draws;
+		uint32_t materialCount = 1;
+		uint32_t lightCount = 0;
+		uint32_t shadowedLightCount = 0; //The first lights, held still so their cached static tiles stay valid
+		uint32_t shadowCasterMesh = UINT32_MAX; //Into meshes, every caster merged into one static draw
+		std::vector<PipelineStateKey> pipelineKeys; //Empty draws everything with the benchmark shaders
+		bool pushMaterialFeatures = false; //For the unspecialized fragment shader, which branches on them
+		bool depthPrepass = false; //Needs pipelineKeys, benchmarkVertex offsets instances where depthPrepass.vert can't see it
+		glm::vec3 centre = glm::vec3(0.0f);
+		float radius = 1.0f; //Camera orbit distance
+	};
+
+	struct SceneResult {
+		std::string name;
+		uint32_t frames = 0;
+		std::vector<double> cpuFrameMs;
+		std::vector<double> gpuFrameMs; //Empty when the queue has no timestamps
+		std::vector<GpuScopeStats> gpuPasses; //Rolling averages as the scene finished
+		BindStats bindsPerFrame;
+		double heapAllocationsPerFrame = 0.0;
+		double setupMs = 0.0;
+		vk::DeviceSize gpuBytes = 0;
+		std::string memoryJson; //VulkanMemoryStats with the scene still resident
+	};
+
+	double toMilliseconds(std::chrono::steady_clock::duration duration) {
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+
+	uint64_t getPeakResidentKilobytes() {
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters{};
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return counters.PeakWorkingSetSize / 1024;
+
+		return 0;
+#else
+		rusage usage{};
+		if (getrusage(RUSAGE_SELF, &usage) == 0)
+			return static_cast<uint64_t>(usage.ru_maxrss); //Kilobytes on Linux
+
+		return 0;
+#endif
+	}
+
+	void appendCube(std::vector<Vertex>& verts, std::vector<uint32_t>& indices, const glm::vec3& centre, float halfSize, const glm::vec3& colour) {
+		const glm::vec3 normals[6] = { {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1} };
+
+		for (const glm::vec3& normal : normals) {
+			glm::vec3 tangent = std::abs(normal.y) > 0.5f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+			glm::vec3 bitangent = glm::cross(normal, tangent);
+			uint32_t base = static_cast<uint32_t>(verts.size());
+
+			for (uint32_t corner = 0; corner != 4; corner++) {
+				glm::vec2 uv(corner & 1 ? 1.0f : 0.0f, corner & 2 ? 1.0f : 0.0f);
+				glm::vec3 position = centre + (normal + tangent * (uv.x * 2.0f - 1.0f) + bitangent * (uv.y * 2.0f - 1.0f)) * halfSize;
+
+				verts.push_back({ position, colour, uv, normal });
+			}
+
+			indices.insert(indices.end(), { base, base + 1, base + 3, base, base + 3, base + 2 });
+		}
+	}
+
+	void appendSphere(std::vector<Vertex>& verts, std::vector<uint32_t>& indices, const glm::vec3& centre, float radius, uint32_t segments, std::mt19937& random, const glm::vec3& colour) {
+		std::uniform_real_distribution<float> bump(0.9f, 1.1f); //Each sphere different enough that its LODs aren't all the same
+		uint32_t base = static_cast<uint32_t>(verts.size());
+
+		for (uint32_t ring = 0; ring <= segments; ring++)
+			for (uint32_t segment = 0; segment <= segments; segment++) {
+				glm::vec2 uv(static_cast<float>(segment) / segments, static_cast<float>(ring) / segments);
+				float theta = uv.y * glm::pi<float>();
+				float phi = uv.x * glm::two_pi<float>();
+				glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+				float r = (segment == segments || ring == 0 || ring == segments) ? radius : radius * bump(random);
+
+				verts.push_back({ centre + normal * r, colour, uv, normal });
+			}
+
+		for (uint32_t ring = 0; ring != segments; ring++)
+			for (uint32_t segment = 0; segment != segments; segment++) {
+				uint32_t a = base + ring * (segments + 1) + segment;
+				uint32_t b = a + segments + 1;
+
+				indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+			}
+	}
+
+	glm::vec3 gridPosition(uint32_t instance) { //Same layout as benchmarkVertex.vert
+		return glm::vec3(instance % GRID_SIDE, instance / (GRID_SIDE * GRID_SIDE), (instance / GRID_SIDE) % GRID_SIDE) * GRID_SPACING;
+	}
+
+	BenchmarkMesh uploadMesh(VulkanCore* core, std::vector<Vertex>& verts, std::vector<uint32_t>& indices, const MeshSimplify::LodOptions& lodOptions = {}) {
+		BenchmarkMesh mesh;
+		mesh.data = std::make_unique<VulkanModelData>("", *core->getLogicalDevicePtr(), *core->getGraphicsQueuePtr(), *core->getCommandPoolPtr(), *core->getPhysicalDevicePtr(), core->getDeletionQueuePtr(), core->getTimelinePtr());
+		mesh.data->setupBuffers(verts, indices, lodOptions);
+		mesh.gpuBytes = static_cast<vk::DeviceSize>(mesh.data->getModelVerticesSize()) * (sizeof(Vertex) + sizeof(glm::vec3)) +
+			static_cast<vk::DeviceSize>(mesh.data->getTotalIndicesSize()) * sizeof(uint32_t);
+
+		return mesh;
+	}
+
+	void addInstancedDraws(BenchmarkScene& scene, uint32_t instanceCount, uint32_t batchSize, uint32_t materialCount) {
+		for (uint32_t first = 0; first < instanceCount; first += batchSize) {
+			uint32_t count = std::min(batchSize, instanceCount - first);
+			uint32_t material = (first / batchSize * 7919u) % materialCount; //Scattered, so the sort has something to group
+			glm::vec3 centre = (gridPosition(first) + gridPosition(first + count - 1)) * 0.5f;
+			float radius = glm::length(gridPosition(first + count - 1) - gridPosition(first)) * 0.5f + scene.meshes[0].data->getBounds().radius; //Batches are whole grid rows, so the two ends are opposite corners
+
+			scene.draws.push_back({ 0, material, first, count, centre, radius });
+		}
+
+		glm::vec3 farCorner = glm::vec3(std::min(instanceCount, GRID_SIDE) - 1, (instanceCount - 1) / (GRID_SIDE * GRID_SIDE), std::min((instanceCount - 1) / GRID_SIDE, GRID_SIDE - 1)) * GRID_SPACING;
+		scene.centre = farCorner * 0.5f;
+		scene.radius = std::max(glm::length(farCorner) * 0.75f, 10.0f);
+	}
+
+	BenchmarkScene makeInstancedCubes(VulkanCore* core, uint32_t instanceCount) { //Few draws, many triangles, GPU bound
+		BenchmarkScene scene;
+		scene.name = "instancedCubes";
+
+		std::vector<Vertex> verts;
+		std::vector<uint32_t> indices;
+		appendCube(verts, indices, glm::vec3(0.0f), 1.0f, glm::vec3(0.8f, 0.6f, 0.4f));
+		scene.meshes.push_back(uploadMesh(core, verts, indices));
+
+		addInstancedDraws(scene, instanceCount, INSTANCE_BATCH, 1);
+		return scene;
+	}
+
+	BenchmarkScene makeUniqueMeshes(VulkanCore* core, uint32_t meshCount) { //One draw and one vertex buffer per mesh, CPU submission bound
+		BenchmarkScene scene;
+		scene.name = "uniqueMeshes";
+
+		std::mt19937 random(RANDOM_SEED);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<float>(meshCount))));
+
+		for (uint32_t i = 0; i != meshCount; i++) {
+			glm::vec3 centre = glm::vec3(i % side, i / (side * side), (i / side) % side) * GRID_SPACING;
+			glm::vec3 colour(unit(random), unit(random), unit(random));
+
+			std::vector<Vertex> verts;
+			std::vector<uint32_t> indices;
+			appendSphere(verts, indices, centre, 1.0f, 16, random, colour); //Positions baked in, the model matrix stays identity
+
+			scene.meshes.push_back(uploadMesh(core, verts, indices));
+			scene.draws.push_back({ i, 0, 0, 1, centre, scene.meshes.back().data->getBounds().radius });
+		}
+
+		scene.centre = glm::vec3(side - 1) * GRID_SPACING * 0.5f;
+		scene.radius = std::max(side * GRID_SPACING * 1.2f, 10.0f);
+		return scene;
+	}
+
+	uint8_t getBenchmarkMaterialFeatures(uint32_t material) { //Cycles through every combination of maps, the textures behind them are the same checkerboard
+		return static_cast<uint8_t>(material % (ALL_MATERIAL_FEATURES + 1));
+	}
+
+	BenchmarkScene makeMaterialPermutations(VulkanCore* core, uint32_t meshCount, bool specialized) { //The engine's PBR shaders, runtime map branches against one specialized pipeline per combination
+		BenchmarkScene scene = makeUniqueMeshes(core, meshCount); //vertexShader has no instance offset, so the positions have to be baked in
+		scene.name = specialized ? "materialSpecialized" : "materialBranches";
+		scene.materialCount = ALL_MATERIAL_FEATURES + 1;
+		scene.lightCount = 256;
+
+		VulkanPipelineManager* pipelineManager = core->getPipelineManagerPtr();
+		for (uint32_t material = 0; material != (specialized ? scene.materialCount : 1); material++) {
+			PipelineStateKey key = specialized ? pipelineManager->getMaterialKey(getBenchmarkMaterialFeatures(material)) : pipelineManager->getDefaultKey();
+			key.cullMode = vk::CullModeFlagBits::eBack;
+			key.blendMode = BlendMode::eOpaque;
+
+			scene.pipelineKeys.push_back(key);
+		}
+
+		for (uint32_t i = 0; i != scene.draws.size(); i++) {
+			BenchmarkDraw& draw = scene.draws[i];
+			draw.material = i % scene.materialCount;
+			draw.pipeline = specialized ? draw.material : 0;
+		}
+
+		scene.pushMaterialFeatures = !specialized;
+		return scene;
+	}
+
+	BenchmarkScene makeDepthPrepassScene(VulkanCore* core, uint32_t meshCount, bool depthPrepass) { //Same PBR scene with and without the pre-pass, compare the pair's depthPrepass plus main pass GPU times
+		BenchmarkScene scene = makeMaterialPermutations(core, meshCount, true);
+		scene.name = depthPrepass ? "depthPrepassOn" : "depthPrepassOff";
+		scene.depthPrepass = depthPrepass;
+
+		return scene;
+	}
+
+	BenchmarkScene makeManyLights(VulkanCore* core, uint32_t instanceCount, uint32_t lightCount, uint32_t shadowedLightCount) { //Cheap geometry, the clustered light culling and shading dominate
+		BenchmarkScene scene = makeInstancedCubes(core, instanceCount);
+		scene.name = "manyLights";
+		scene.lightCount = lightCount;
+		scene.shadowedLightCount = std::min({ shadowedLightCount, lightCount, MAX_SHADOWED_LIGHTS });
+
+		std::vector<Vertex> verts; //shadowCaster.vert has no instance offset, the cubes go in one mesh at their grid positions instead
+		std::vector<uint32_t> indices;
+		for (uint32_t instance = 0; instance != instanceCount; instance++)
+			appendCube(verts, indices, gridPosition(instance), 1.0f, glm::vec3(1.0f));
+
+		MeshSimplify::LodOptions lodOptions;
+		lodOptions.maxLods = 1; //Always drawn whole
+		scene.shadowCasterMesh = static_cast<uint32_t>(scene.meshes.size());
+		scene.meshes.push_back(uploadMesh(core, verts, indices, lodOptions));
+
+		return scene;
+	}
+
+	BenchmarkScene makeManyTextures(VulkanCore* core, uint32_t instanceCount, uint32_t materialCount) { //A descriptor set per material, tests the sort's bind elision
+		BenchmarkScene scene;
+		scene.name = "manyTextures";
+		scene.materialCount = materialCount;
+
+		std::vector<Vertex> verts;
+		std::vector<uint32_t> indices;
+		appendCube(verts, indices, glm::vec3(0.0f), 1.0f, glm::vec3(1.0f));
+		scene.meshes.push_back(uploadMesh(core, verts, indices));
+
+		addInstancedDraws(scene, instanceCount, INSTANCE_BATCH / 16, materialCount); //Small batches so every material is drawn several times
+		return scene;
+	}
+
+	std::vector<PointLight> animateLights(uint32_t lightCount, const BenchmarkScene& scene, uint32_t frame) { //Positions are a function of the frame number only
+		std::vector<PointLight> lights(lightCount);
+		std::mt19937 random(RANDOM_SEED);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		for (uint32_t i = 0; i != lightCount; i++) {
+			PointLight& light = lights[i];
+			glm::vec3 base = scene.centre + (glm::vec3(unit(random), unit(random), unit(random)) - 0.5f) * scene.radius;
+			float phase = unit(random) * glm::two_pi<float>() + (i < scene.shadowedLightCount ? 0.0f : frame * 0.02f);
+			glm::vec3 position = base + glm::vec3(std::cos(phase), std::sin(phase * 0.5f), std::sin(phase)) * 4.0f;
+
+			light.positionRadius = glm::vec4(position, 6.0f + unit(random) * 6.0f);
+			light.colour = glm::vec4(unit(random), unit(random), unit(random), 1.0f);
+		}
+
+		return lights;
+	}
+
+	class BenchmarkResources : VulkanWrapper { //Pipeline, textures, uniforms and descriptor sets shared by every scene
+	public:
+		BenchmarkResources(VulkanCore* coreRef, uint32_t maxMaterials) : VulkanWrapper(coreRef), materialCount(maxMaterials) {
+			init();
+		}
+
+		vk::Pipeline getPipeline() {
+			return pipeline;
+		}
+
+		uint16_t getPipelineSortId() {
+			return pipelineSortId;
+		}
+
+		vk::PipelineLayout getPipelineLayout() {
+			return getCorePtr()->getPipelineManagerPtr()->getPipelineLayout();
+		}
+
+		vk::DescriptorSet getDescriptorSet(uint32_t slot, uint32_t material) {
+			return descriptorSets[slot * materialCount + material];
+		}
+
+		void writeUniforms(uint32_t slot, const BenchmarkUniforms& uniforms) {
+			memcpy(uniformMapped[slot], &uniforms, sizeof(uniforms));
+		}
+
+		void writeLightingDescriptors(uint32_t slot, uint32_t usedMaterials) { //From the after graph compile callback, the lighting buffers and shadow atlas are this frame's
+			for (uint32_t material = 0; material != usedMaterials; material++)
+				getCorePtr()->writeLightingDescriptors(getDescriptorSet(slot, material));
+		}
+
+		vk::DeviceSize getGpuBytes() {
+			vk::DeviceSize total = sizeof(BenchmarkUniforms) * UNIFORM_SLOTS;
+			for (const auto& texture : textures)
+				total += texture.gpuBytes;
+
+			return total;
+		}
+
+		~BenchmarkResources() {
+			cleanup();
+		}
+
+	private:
+		uint32_t materialCount;
+		vk::Pipeline pipeline;
+		uint16_t pipelineSortId = 0;
+
+		std::vector<BenchmarkTexture> textures;
+		vk::Sampler sampler;
+
+		std::vector<vk::Buffer> uniformBuffers;
+		std::vector<vk::DeviceMemory> uniformMemory;
+		std::vector<void*> uniformMapped;
+
+		vk::DescriptorPool descriptorPool;
+		std::vector<vk::DescriptorSet> descriptorSets; //UNIFORM_SLOTS * materialCount, slot major
+
+		void init() {
+			VulkanPipelineManager* pipelineManager = getCorePtr()->getPipelineManagerPtr();
+			PipelineStateKey key = pipelineManager->getDefaultKey();
+			key.vertexShaderId = pipelineManager->getShaderId("benchmarkVertex.spv");
+			key.fragmentShaderId = pipelineManager->getShaderId("benchmarkFragment.spv");
+			key.cullMode = vk::CullModeFlagBits::eBack;
+			key.blendMode = BlendMode::eOpaque;
+
+			pipeline = pipelineManager->getPipelineBlocking(key); //Compiled up front so the first measured frame doesn't pay for it
+			pipelineSortId = pipelineManager->getSortId(key);
+
+			createTextures();
+			createUniforms();
+			createDescriptorSets();
+		}
+
+		void createTextures() {
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+			vk::PhysicalDevice* physicalDevice = getCorePtr()->getPhysicalDevicePtr();
+			vk::DeviceSize textureBytes = TEXTURE_SIZE * TEXTURE_SIZE * 4;
+			vk::Format format = vk::Format::eR8G8B8A8Unorm;
+
+			vk::Buffer stagingBuffer;
+			vk::DeviceMemory stagingMemory;
+			createBuffer(textureBytes * materialCount, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+				stagingBuffer, stagingMemory, *device, *physicalDevice);
+
+			void* mapped;
+			vulkanMapMemory(*device, stagingMemory, 0, textureBytes * materialCount, vk::MemoryMapFlagBits{}, &mapped);
+
+			std::mt19937 random(RANDOM_SEED);
+			std::uniform_int_distribution<uint32_t> channel(64, 255);
+			uint8_t* texels = static_cast<uint8_t*>(mapped);
+
+			for (uint32_t material = 0; material != materialCount; material++) { //Checkerboards with a colour and cell size per material
+				uint8_t r = static_cast<uint8_t>(channel(random)), g = static_cast<uint8_t>(channel(random)), b = static_cast<uint8_t>(channel(random));
+				uint32_t cell = 4u << (material % 3);
+
+				for (uint32_t y = 0; y != TEXTURE_SIZE; y++)
+					for (uint32_t x = 0; x != TEXTURE_SIZE; x++) {
+						bool dark = ((x / cell) + (y / cell)) & 1;
+						uint8_t* texel = texels + (material * TEXTURE_SIZE * TEXTURE_SIZE + y * TEXTURE_SIZE + x) * 4;
+
+						texel[0] = dark ? r / 2 : r;
+						texel[1] = dark ? g / 2 : g;
+						texel[2] = dark ? b / 2 : b;
+						texel[3] = 255;
+					}
+			}
+
+			vulkanUnmapMemory(*device, stagingMemory);
+
+			vk::CommandBuffer commandBuffer = beginSingleTimeCommands(*getCorePtr()->getCommandPoolPtr(), *device);
+			textures.resize(materialCount);
+
+			for (uint32_t material = 0; material != materialCount; material++) {
+				BenchmarkTexture& texture = textures[material];
+
+				vk::ImageCreateInfo imageInfo({}, vk::ImageType::e2D, format, vk::Extent3D(TEXTURE_SIZE, TEXTURE_SIZE, 1), 1, 1, vk::SampleCountFlagBits::e1,
+					vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, vk::SharingMode::eExclusive, 0, nullptr, vk::ImageLayout::eUndefined);
+
+				if (device->createImage(&imageInfo, nullptr, &texture.image) != vk::Result::eSuccess)
+					throw std::runtime_error("Failed to create benchmark texture!");
+
+				vk::MemoryRequirements requirements = device->getImageMemoryRequirements(texture.image);
+				vk::MemoryAllocateInfo allocInfo(requirements.size, findMemoryType(requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal, *physicalDevice));
+
+				if (device->allocateMemory(&allocInfo, nullptr, &texture.memory) != vk::Result::eSuccess)
+					throw std::runtime_error("Failed to allocate benchmark texture memory!");
+
+				trackDeviceMemory(texture.memory, requirements.size, allocInfo.memoryTypeIndex, MemoryCategory::eTexture, *physicalDevice);
+				device->bindImageMemory(texture.image, texture.memory, 0);
+				texture.gpuBytes = requirements.size;
+
+				vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+				vk::ImageMemoryBarrier toTransfer({}, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+					VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, texture.image, range);
+				commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+				vk::BufferImageCopy region{};
+				region.bufferOffset = textureBytes * material;
+				region.imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+				region.imageExtent = vk::Extent3D(TEXTURE_SIZE, TEXTURE_SIZE, 1);
+				commandBuffer.copyBufferToImage(stagingBuffer, texture.image, vk::ImageLayout::eTransferDstOptimal, 1, &region);
+
+				vk::ImageMemoryBarrier toShader(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+					VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, texture.image, range);
+				commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, 0, nullptr, 0, nullptr, 1, &toShader);
+
+				texture.view = Helper::createImageView(texture.image, format, vk::ImageAspectFlagBits::eColor, *device);
+			}
+
+			endSingleTimeCommands(commandBuffer, *getCorePtr()->getGraphicsQueuePtr(), *device, *getCorePtr()->getCommandPoolPtr(), getCorePtr()->getTimelinePtr());
+
+			vulkanDestroyBuffer(*device, stagingBuffer);
+			vulkanFreeMemory(*device, stagingMemory);
+
+			vk::SamplerCreateInfo samplerInfo{};
+			samplerInfo.magFilter = vk::Filter::eNearest;
+			samplerInfo.minFilter = vk::Filter::eLinear;
+			samplerInfo.addressModeU = vk::SamplerAddressMode::eRepeat;
+			samplerInfo.addressModeV = vk::SamplerAddressMode::eRepeat;
+			samplerInfo.addressModeW = vk::SamplerAddressMode::eRepeat;
+
+			if (device->createSampler(&samplerInfo, nullptr, &sampler) != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to create benchmark sampler!");
+		}
+
+		void createUniforms() {
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+
+			uniformBuffers.resize(UNIFORM_SLOTS);
+			uniformMemory.resize(UNIFORM_SLOTS);
+			uniformMapped.resize(UNIFORM_SLOTS);
+
+			for (uint32_t slot = 0; slot != UNIFORM_SLOTS; slot++) {
+				createBuffer(sizeof(BenchmarkUniforms), vk::BufferUsageFlagBits::eUniformBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+					uniformBuffers[slot], uniformMemory[slot], *device, *getCorePtr()->getPhysicalDevicePtr());
+				vulkanMapMemory(*device, uniformMemory[slot], 0, sizeof(BenchmarkUniforms), vk::MemoryMapFlagBits{}, &uniformMapped[slot]);
+			}
+		}
+
+		void createDescriptorSets() { //Bindings 0 to 5 here, 6 to 10 every frame through writeLightingDescriptors
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+			uint32_t setCount = UNIFORM_SLOTS * materialCount;
+
+			std::array<vk::DescriptorPoolSize, 3> poolSizes = { //Per set, as VulkanDescriptorSetLayout declares them
+				vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, setCount), //0
+				vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, setCount * 6), //1 to 5 and the shadow atlas at 9
+				vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, setCount * 4) //Lights, cluster grid, light indices and shadow tiles at 6, 7, 8 and 10
+			};
+
+			vk::DescriptorPoolCreateInfo poolInfo({}, setCount, static_cast<uint32_t>(poolSizes.size()), poolSizes.data());
+			if (device->createDescriptorPool(&poolInfo, nullptr, &descriptorPool) != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to create benchmark descriptor pool!");
+
+			std::vector<vk::DescriptorSetLayout> layouts(setCount, getCorePtr()->getDescriptorSetLayout());
+			vk::DescriptorSetAllocateInfo allocInfo(descriptorPool, setCount, layouts.data());
+
+			descriptorSets.resize(setCount);
+			if (device->allocateDescriptorSets(&allocInfo, descriptorSets.data()) != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to allocate benchmark descriptor sets!");
+
+			for (uint32_t slot = 0; slot != UNIFORM_SLOTS; slot++)
+				for (uint32_t material = 0; material != materialCount; material++) {
+					vk::DescriptorBufferInfo bufferInfo(uniformBuffers[slot], 0, sizeof(BenchmarkUniforms));
+					vk::DescriptorImageInfo imageInfo(sampler, textures[material].view, vk::ImageLayout::eShaderReadOnlyOptimal);
+
+					std::array<vk::WriteDescriptorSet, 6> writes;
+					writes[0] = vk::WriteDescriptorSet(getDescriptorSet(slot, material), 0, 0, 1, vk::DescriptorType::eUniformBuffer, nullptr, &bufferInfo, nullptr);
+					for (uint32_t binding = 1; binding != writes.size(); binding++) //The benchmark shaders only sample albedo, the other maps get the same texture so the set is complete
+						writes[binding] = vk::WriteDescriptorSet(getDescriptorSet(slot, material), binding, 0, 1, vk::DescriptorType::eCombinedImageSampler, &imageInfo, nullptr, nullptr);
+
+					device->updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+				}
+		}
+
+		void cleanup() { //The caller has waited for the device to go idle
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+
+			device->destroyDescriptorPool(descriptorPool, nullptr);
+
+			for (uint32_t slot = 0; slot != UNIFORM_SLOTS; slot++) {
+				vulkanUnmapMemory(*device, uniformMemory[slot]);
+				vulkanDestroyBuffer(*device, uniformBuffers[slot]);
+				vulkanFreeMemory(*device, uniformMemory[slot]);
+			}
+
+			device->destroySampler(sampler, nullptr);
+
+			for (auto& texture : textures) {
+				device->destroyImageView(texture.view, nullptr);
+				device->destroyImage(texture.image, nullptr);
+				vulkanFreeMemory(*device, texture.memory);
+			}
+		}
+	};
+
+	SceneResult runScene(VulkanCore* core, BenchmarkResources& resources, BenchmarkScene& scene, const BenchmarkOptions& options, double setupMs) {
+		SceneResult result;
+		result.name = scene.name;
+		result.frames = options.measuredFrames;
+		result.setupMs = setupMs;
+		result.gpuBytes = resources.getGpuBytes();
+		for (const auto& mesh : scene.meshes)
+			result.gpuBytes += mesh.gpuBytes;
+
+		const float zNear = 0.1f, zFar = scene.radius * 4.0f;
+		float aspect = static_cast<float>(core->getSwapchainExtentWidth()) / static_cast<float>(core->getSwapchainExtentHeight());
+		glm::mat4 proj = glm::perspectiveZO(glm::radians(60.0f), aspect, zNear, zFar); //Vulkan's zero to one depth, the cluster slices and depth prepass assume it
+		proj[1][1] *= -1; //Vulkan's clip space y points down
+
+		if (scene.depthPrepass && scene.pipelineKeys.empty())
+			throw std::runtime_error("Benchmark scene " + scene.name + " wants the depth pre-pass but draws with the benchmark shaders.");
+
+		std::vector<vk::Pipeline> pipelines;
+		std::vector<vk::Pipeline> afterPrepassPipelines; //What getMainPassKey hands out for the same keys once the pre-pass has run
+		std::vector<uint16_t> pipelineSortIds;
+		VulkanPipelineManager* pipelineManager = core->getPipelineManagerPtr();
+
+		for (const PipelineStateKey& key : scene.pipelineKeys) { //Compiled up front so the first measured frame doesn't pay for them
+			pipelines.push_back(pipelineManager->getPipelineBlocking(key));
+			pipelineSortIds.push_back(pipelineManager->getSortId(key));
+
+			if (scene.depthPrepass)
+				afterPrepassPipelines.push_back(pipelineManager->getPipelineBlocking(pipelineManager->getAfterDepthPrepassKey(key)));
+		}
+
+		if (pipelines.empty()) {
+			pipelines.push_back(resources.getPipeline());
+			pipelineSortIds.push_back(resources.getPipelineSortId());
+		}
+
+		std::vector<DrawItem> items(scene.draws.size());
+		std::vector<uint32_t> drawLods(scene.draws.size(), 0); //Kept between frames, selectLod's hysteresis needs the previous choice
+		float screenHeight = static_cast<float>(core->getSwapchainExtentHeight());
+		uint64_t allocationsBefore = 0;
+
+		core->setDepthPrepassEnabled(scene.depthPrepass);
+
+		std::vector<ShadowLight> shadowLights(scene.shadowedLightCount);
+		std::vector<PointLight> stillLights = animateLights(scene.shadowedLightCount, scene, 0);
+		for (uint32_t i = 0; i != scene.shadowedLightCount; i++) {
+			shadowLights[i].position = glm::vec3(stillLights[i].positionRadius);
+			shadowLights[i].radius = stillLights[i].positionRadius.w;
+		}
+
+		core->setShadowLights(shadowLights); //Once, the static tiles render on the first frame and are copied after that
+		core->setShadowCasterCallback([&scene](vk::CommandBuffer& commandBuffer, vk::PipelineLayout layout, bool staticCasters) {
+			if (!staticCasters || scene.shadowCasterMesh == UINT32_MAX) //Nothing moves
+				return;
+
+			VulkanModelData* casters = scene.meshes[scene.shadowCasterMesh].data.get();
+			glm::mat4 model(1.0f);
+			commandBuffer.pushConstants(layout, vk::ShaderStageFlagBits::eVertex, sizeof(glm::mat4), sizeof(model), &model);
+
+			vk::Buffer positionBuffer = casters->getPositionBuffer();
+			vk::DeviceSize offset = 0;
+			commandBuffer.bindVertexBuffers(0, 1, &positionBuffer, &offset);
+			commandBuffer.bindIndexBuffer(casters->getIndexBuffer(), 0, vk::IndexType::eUint32);
+			commandBuffer.drawIndexed(casters->getModelIndicesSize(), 1, 0, 0, 0);
+		});
+
+		uint32_t slot = 0;
+		core->setAfterGraphCompileCallback([&resources, &scene, &slot](uint32_t) {
+			resources.writeLightingDescriptors(slot, scene.materialCount);
+		});
+
+		for (uint32_t frame = 0; frame != options.warmupFrames + options.measuredFrames; frame++) {
+			bool measured = frame >= options.warmupFrames;
+			if (frame == options.warmupFrames) {
+				allocationsBefore = heapAllocations.load(std::memory_order_relaxed);
+				core->getGpuProfilerPtr()->resetScopeStats(); //Only this scene's passes, and none of its warmup
+			}
+
+			auto frameStart = std::chrono::steady_clock::now();
+
+			if (options.windowed) { //Keeps the window responsive, input is ignored
+				SDL_Event event;
+				while (SDL_PollEvent(&event)) {}
+
+				core->setWindowState(core->queryWindowState()); //tick runs on this thread
+			}
+
+			float angle = glm::two_pi<float>() * static_cast<float>(frame) / static_cast<float>(options.measuredFrames); //One orbit over the measured frames, same path every run
+			glm::vec3 eye = scene.centre + glm::vec3(std::cos(angle), 0.35f, std::sin(angle)) * scene.radius;
+			glm::mat4 view = glm::lookAt(eye, scene.centre, glm::vec3(0.0f, 1.0f, 0.0f));
+			glm::vec3 forward = glm::normalize(scene.centre - eye);
+
+			slot = static_cast<uint32_t>(core->getFrameNumber() % UNIFORM_SLOTS);
+			resources.writeUniforms(slot, { glm::mat4(1.0f), view, proj });
+
+			core->setCamera(view, proj, zNear, zFar);
+			core->setLights(animateLights(scene.lightCount, scene, frame));
+			if (scene.shadowCasterMesh != UINT32_MAX)
+				scene.meshes[scene.shadowCasterMesh].data->markUsed(core->getFrameNumber());
+
+			for (uint32_t i = 0; i != scene.draws.size(); i++) {
+				const BenchmarkDraw& draw = scene.draws[i];
+
+				BoundingSphere bounds;
+				bounds.centre = draw.centre;
+				bounds.radius = draw.radius;
+				drawLods[i] = MeshSimplify::selectLod(scene.meshes[draw.mesh].data->lods, 1.0f, bounds, eye, proj[1][1], screenHeight, 1.0f, drawLods[i]); //Model matrices are identity
+				scene.meshes[draw.mesh].data->markUsed(core->getFrameNumber()); //Here rather than in the record callback, that runs on several threads
+
+				DrawKeyFields fields{};
+				fields.pipeline = pipelineSortIds[draw.pipeline];
+				fields.material = static_cast<uint16_t>(draw.material);
+				fields.mesh = static_cast<uint16_t>(draw.mesh);
+				fields.viewDepth = glm::dot(draw.centre - eye, forward);
+
+				items[i] = { DrawSort::makeKey(fields, zNear, zFar), i };
+			}
+
+			auto recordDepthDraw = [&scene, &resources, &drawLods, slot](DrawStateCache& state, uint32_t drawIndex) { //Every benchmark draw is opaque
+				const BenchmarkDraw& draw = scene.draws[drawIndex];
+				VulkanModelData* mesh = scene.meshes[draw.mesh].data.get();
+				const MeshLod& lod = mesh->getLod(drawLods[drawIndex]);
+
+				state.bindDescriptorSet(resources.getPipelineLayout(), resources.getDescriptorSet(slot, 0)); //Only the uniforms are read, every material's set shares them
+				state.bindVertexBuffer(mesh->getPositionBuffer());
+				state.bindIndexBuffer(mesh->getIndexBuffer());
+				state.drawIndexed(lod.indexCount, lod.firstIndex, 0, draw.instanceCount, draw.firstInstance);
+			};
+
+			core->setMainPassDraws(items, [core, &scene, &resources, &drawLods, &pipelines, &afterPrepassPipelines, slot](DrawStateCache& state, uint32_t drawIndex) {
+				const BenchmarkDraw& draw = scene.draws[drawIndex];
+				VulkanModelData* mesh = scene.meshes[draw.mesh].data.get();
+				const MeshLod& lod = mesh->getLod(drawLods[drawIndex]);
+
+				state.bindPipeline(core->isDepthPrepassActive() ? afterPrepassPipelines[draw.pipeline] : pipelines[draw.pipeline]);
+				state.bindDescriptorSet(resources.getPipelineLayout(), resources.getDescriptorSet(slot, draw.material));
+				if (scene.pushMaterialFeatures)
+					state.pushMaterialFeatures(resources.getPipelineLayout(), getBenchmarkMaterialFeatures(draw.material));
+
+				state.bindVertexBuffer(mesh->getVertexBuffer());
+				state.bindIndexBuffer(mesh->getIndexBuffer());
+				state.drawIndexed(lod.indexCount, lod.firstIndex, 0, draw.instanceCount, draw.firstInstance);
+			}, scene.depthPrepass ? std::function<void(DrawStateCache&, uint32_t)>(recordDepthDraw) : nullptr);
+
+			core->tick();
+
+			if (measured) {
+				result.cpuFrameMs.push_back(toMilliseconds(std::chrono::steady_clock::now() - frameStart));
+				result.bindsPerFrame += core->getParallelRecorderPtr()->getLastFrameBindStats();
+
+				GpuScopeStats gpuFrame;
+				if (core->getGpuProfilerPtr()->getScopeStats("frame", gpuFrame))
+					result.gpuFrameMs.push_back(gpuFrame.lastMs); //Lags MAX_FRAMES_IN_FLIGHT frames, the first few are from the warmup
+			}
+		}
+
+		result.heapAllocationsPerFrame = static_cast<double>(heapAllocations.load(std::memory_order_relaxed) - allocationsBefore) / options.measuredFrames;
+		result.gpuPasses = core->getGpuProfilerPtr()->getScopeStats();
+		result.memoryJson = core->getMemoryStatsPtr()->toJson();
+		core->setMainPassDraws({}, nullptr); //Scene meshes are freed straight after, the deletion queue holds them until their last frame retires
+		core->setAfterGraphCompileCallback(nullptr);
+		core->setDepthPrepassEnabled(false);
+		core->setShadowLights({});
+		core->setShadowCasterCallback(nullptr);
+
+		return result;
+	}
+
+	struct OrderingStressResult {
+		uint32_t frames = 0;
+		uint32_t uploads = 0;
+		uint32_t deletions = 0;
+		std::vector<std::string> failures;
+	};
+
+	struct StressSlot { //Staging -> device local -> readback, the readback proves the copies were done when the value signalled
+		vk::Buffer staging, device, readback;
+		vk::DeviceMemory stagingMemory, deviceMemory, readbackMemory;
+		uint32_t* stagingMapped = nullptr;
+		const uint32_t* readbackMapped = nullptr;
+		vk::CommandBuffer commandBuffer;
+		uint64_t value = 0; //Timeline value of the last submission using this slot
+		uint32_t pattern = 0;
+	};
+
+	std::vector<std::string> runStressUploads(VulkanCore* core, const std::atomic<bool>& framesDone, uint32_t& uploadCount) { //Upload thread, a second submitter on the graphics queue
+		vk::Device* device = core->getLogicalDevicePtr();
+		vk::PhysicalDevice* physicalDevice = core->getPhysicalDevicePtr();
+		VulkanTimeline* timeline = core->getTimelinePtr();
+		std::vector<std::string> failures;
+
+		Helper::QueueFamilyIndices queueFamilyIndices = Helper::findQueueFamilies(*physicalDevice, *core->getSurfacePtr());
+		vk::CommandPoolCreateInfo poolInfo(vk::CommandPoolCreateFlagBits::eResetCommandBuffer, queueFamilyIndices.graphicsFamily.value()); //The core's pool belongs to the ticking thread
+
+		vk::CommandPool commandPool;
+		if (device->createCommandPool(&poolInfo, nullptr, &commandPool) != vk::Result::eSuccess)
+			throw std::runtime_error("Failed to create the stress upload command pool!");
+
+		std::array<StressSlot, STRESS_SLOTS> slots;
+		for (auto& slot : slots) {
+			vk::MemoryPropertyFlags hostVisible = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+			createBuffer(STRESS_UPLOAD_BYTES, vk::BufferUsageFlagBits::eTransferSrc, hostVisible, slot.staging, slot.stagingMemory, *device, *physicalDevice);
+			createBuffer(STRESS_UPLOAD_BYTES, vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal,
+				slot.device, slot.deviceMemory, *device, *physicalDevice);
+			createBuffer(STRESS_UPLOAD_BYTES, vk::BufferUsageFlagBits::eTransferDst, hostVisible, slot.readback, slot.readbackMemory, *device, *physicalDevice);
+
+			void* mapped;
+			vulkanMapMemory(*device, slot.stagingMemory, 0, STRESS_UPLOAD_BYTES, vk::MemoryMapFlagBits{}, &mapped);
+			slot.stagingMapped = static_cast<uint32_t*>(mapped);
+			vulkanMapMemory(*device, slot.readbackMemory, 0, STRESS_UPLOAD_BYTES, vk::MemoryMapFlagBits{}, &mapped);
+			slot.readbackMapped = static_cast<const uint32_t*>(mapped);
+
+			vk::CommandBufferAllocateInfo allocInfo(commandPool, vk::CommandBufferLevel::ePrimary, 1);
+			device->allocateCommandBuffers(&allocInfo, &slot.commandBuffer);
+		}
+
+		uint64_t lastValue = 0;
+		size_t words = STRESS_UPLOAD_BYTES / sizeof(uint32_t);
+
+		for (uint32_t upload = 0; !framesDone.load(std::memory_order_relaxed); upload++) {
+			StressSlot& slot = slots[upload % STRESS_SLOTS];
+
+			if (slot.value) { //Reuse only once the slot's value has signalled, and by then every copy it covers must have landed
+				if (!timeline->wait(slot.value) || !timeline->isComplete(slot.value))
+					failures.push_back("Upload slot value " + std::to_string(slot.value) + " never signalled.");
+				else if (std::any_of(slot.readbackMapped, slot.readbackMapped + words, [&slot](uint32_t word) { return word != slot.pattern; }))
+					failures.push_back("Upload value " + std::to_string(slot.value) + " signalled before its copies finished.");
+			}
+
+			slot.pattern = upload + 1;
+			std::fill(slot.stagingMapped, slot.stagingMapped + words, slot.pattern);
+
+			slot.commandBuffer.reset(vk::CommandBufferResetFlags{});
+			vk::CommandBufferBeginInfo beginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+			slot.commandBuffer.begin(&beginInfo);
+
+			vk::BufferCopy region(0, 0, STRESS_UPLOAD_BYTES);
+			slot.commandBuffer.copyBuffer(slot.staging, slot.device, 1, &region);
+
+			vk::MemoryBarrier toRead(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferRead);
+			slot.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, 1, &toRead, 0, nullptr, 0, nullptr);
+			slot.commandBuffer.copyBuffer(slot.device, slot.readback, 1, &region);
+
+			vk::MemoryBarrier toHost(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead);
+			slot.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, 1, &toHost, 0, nullptr, 0, nullptr);
+			slot.commandBuffer.end();
+
+			TimelineSubmitInfo submitInfo{};
+			submitInfo.commandBuffers = { slot.commandBuffer };
+			slot.value = timeline->submit(*core->getGraphicsQueuePtr(), submitInfo);
+
+			if (slot.value <= lastValue)
+				failures.push_back("Upload value " + std::to_string(slot.value) + " handed out after " + std::to_string(lastValue) + ".");
+
+			lastValue = slot.value;
+			uploadCount = upload + 1;
+		}
+
+		timeline->wait(lastValue);
+
+		for (auto& slot : slots) {
+			vulkanUnmapMemory(*device, slot.stagingMemory);
+			vulkanUnmapMemory(*device, slot.readbackMemory);
+
+			for (auto [buffer, memory] : { std::make_pair(slot.staging, slot.stagingMemory), std::make_pair(slot.device, slot.deviceMemory), std::make_pair(slot.readback, slot.readbackMemory) }) {
+				vulkanDestroyBuffer(*device, buffer);
+				vulkanFreeMemory(*device, memory);
+			}
+		}
+
+		device->destroyCommandPool(commandPool, nullptr);
+		return failures;
+	}
+
+	OrderingStressResult runOrderingStress(VulkanCore* core, uint32_t frameCount) { //Headless frames and main thread mesh uploads, with a second thread uploading through the same timeline. Meant for lavapipe in CI
+		OrderingStressResult result;
+		VulkanTimeline* timeline = core->getTimelinePtr();
+
+		std::atomic<bool> framesDone{ false };
+		std::vector<std::string> uploadFailures;
+		std::thread uploadThread([core, &framesDone, &uploadFailures, &result]() {
+			uploadFailures = runStressUploads(core, framesDone, result.uploads);
+		});
+
+		std::unordered_map<uint64_t, uint64_t> frameValues; //Frame number to the timeline value it signals
+		uint64_t lastFrameValue = 0, lastCompletedValue = 0;
+
+		std::vector<Vertex> verts;
+		std::vector<uint32_t> indices;
+		appendCube(verts, indices, glm::vec3(0.0f), 1.0f, glm::vec3(1.0f));
+
+		for (uint32_t frame = 0; frame != frameCount; frame++) {
+			uint64_t frameNumber = core->getFrameNumber();
+
+			core->getDeletionQueuePtr()->push(frameNumber, [&result, &frameValues, timeline, frameNumber]() { //Stands in for a resource the frame read
+				result.deletions++;
+
+				auto it = frameValues.find(frameNumber);
+				if (it == frameValues.end() || !timeline->isComplete(it->second))
+					result.failures.push_back("Frame " + std::to_string(frameNumber) + "'s resources were freed before its timeline value signalled.");
+			});
+
+			if (frame % 4 == 0) { //Main thread upload between frames, freed through the deletion queue straight away
+				BenchmarkMesh mesh = uploadMesh(core, verts, indices);
+				mesh.data->markUsed(frameNumber);
+			}
+
+			core->tick();
+
+			if (core->getFrameNumber() != frameNumber + 1) {
+				result.failures.push_back("Frame " + std::to_string(frameNumber) + " was not submitted.");
+				continue;
+			}
+
+			uint64_t frameValue = core->getLastFrameTimelineValue();
+			if (frameValue <= lastFrameValue)
+				result.failures.push_back("Frame " + std::to_string(frameNumber) + " signals " + std::to_string(frameValue) + ", not after the previous frame's " + std::to_string(lastFrameValue) + ".");
+
+			uint64_t completedValue = timeline->getCompletedValue();
+			if (completedValue < lastCompletedValue)
+				result.failures.push_back("Completed value went back from " + std::to_string(lastCompletedValue) + " to " + std::to_string(completedValue) + ".");
+
+			frameValues[frameNumber] = frameValue;
+			lastFrameValue = frameValue;
+			lastCompletedValue = completedValue;
+			result.frames++;
+		}
+
+		framesDone = true;
+		uploadThread.join();
+		result.failures.insert(result.failures.end(), uploadFailures.begin(), uploadFailures.end());
+
+		timeline->wait(timeline->getLastSubmittedValue());
+		core->getDeletionQueuePtr()->flush(); //Everything has signalled, the remaining deleters still check against frameValues before it goes
+
+		return result;
+	}
+
+	double percentile(std::vector<double> sorted, double fraction) { //Nearest rank
+		if (sorted.empty())
+			return 0.0;
+
+		std::sort(sorted.begin(), sorted.end());
+		size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+		return sorted[std::min(sorted.size() - 1, rank ? rank - 1 : 0)];
+	}
+
+	void writeTimes(std::ostream& out, const std::vector<double>& times) {
+		if (times.empty()) {
+			out << "null";
+			return;
+		}
+
+		double mean = 0.0;
+		for (double ms : times)
+			mean += ms / times.size();
+
+		out << "{ \"mean\": " << mean << ", \"p50\": " << percentile(times, 0.5) << ", \"p90\": " << percentile(times, 0.9)
+			<< ", \"p99\": " << percentile(times, 0.99) << ", \"max\": " << percentile(times, 1.0) << " }";
+	}
+
+	void writeJson(std::ostream& out, const std::vector<SceneResult>& results, const std::vector<TextureDecode::BenchmarkResult>& decodeResults,
+		const std::vector<RecordingBenchmarkResult>& recordingResults, const BenchmarkOptions& options) {
+		out << std::fixed << std::setprecision(3);
+		out << "{\n";
+		out << "  \"width\": " << options.width << ",\n";
+		out << "  \"height\": " << options.height << ",\n";
+		out << "  \"headless\": " << (options.windowed ? "false" : "true") << ",\n";
+		out << "  \"warmupFrames\": " << options.warmupFrames << ",\n";
+		out << "  \"peakRssKb\": " << getPeakResidentKilobytes() << ",\n";
+		out << "  \"decode\": [";
+
+		for (size_t i = 0; i != decodeResults.size(); i++)
+			out << (i ? ", " : "") << "{ \"threads\": " << decodeResults[i].threadCount << ", \"seconds\": " << decodeResults[i].seconds
+				<< ", \"megabytesPerSecond\": " << decodeResults[i].megabytesPerSecond << " }";
+
+		out << "],\n";
+		out << "  \"recording\": [";
+
+		for (size_t i = 0; i != recordingResults.size(); i++)
+			out << (i ? ", " : "") << "{ \"threads\": " << recordingResults[i].threadCount << ", \"ms\": " << recordingResults[i].milliseconds
+				<< ", \"drawsPerMs\": " << recordingResults[i].drawsPerMillisecond << " }";
+
+		out << "],\n";
+		out << "  \"scenes\": [\n";
+
+		for (size_t i = 0; i != results.size(); i++) {
+			const SceneResult& result = results[i];
+			double frames = std::max<double>(result.frames, 1);
+
+			out << "    {\n";
+			out << "      \"name\": \"" << result.name << "\",\n";
+			out << "      \"frames\": " << result.frames << ",\n";
+			out << "      \"setupMs\": " << result.setupMs << ",\n";
+			out << "      \"cpuFrameMs\": ";
+			writeTimes(out, result.cpuFrameMs);
+			out << ",\n      \"gpuFrameMs\": ";
+			writeTimes(out, result.gpuFrameMs);
+			out << ",\n      \"gpuPasses\": [";
+
+			for (size_t pass = 0; pass != result.gpuPasses.size(); pass++) {
+				const GpuScopeStats& stats = result.gpuPasses[pass];
+				out << (pass ? ", " : "") << "{ \"name\": \"" << stats.name << "\", \"averageMs\": " << stats.averageMs << ", \"vertexInvocations\": " << stats.vertexInvocations
+					<< ", \"fragmentInvocations\": " << stats.fragmentInvocations << ", \"clippingPrimitives\": " << stats.clippingPrimitives << " }";
+			}
+
+			out << "],\n";
+			out << "      \"drawCallsPerFrame\": " << result.bindsPerFrame.draws / frames << ",\n";
+			out << "      \"pipelineBindsPerFrame\": " << result.bindsPerFrame.pipelineBinds / frames << ",\n";
+			out << "      \"descriptorSetBindsPerFrame\": " << result.bindsPerFrame.descriptorSetBinds / frames << ",\n";
+			out << "      \"elidedBindsPerFrame\": " << result.bindsPerFrame.elidedBinds / frames << ",\n";
+			out << "      \"heapAllocationsPerFrame\": " << result.heapAllocationsPerFrame << ",\n";
+			out << "      \"gpuBytes\": " << result.gpuBytes << ",\n";
+			out << "      \"memory\": " << result.memoryJson << "\n";
+			out << "    }" << (i + 1 != results.size() ? "," : "") << "\n";
+		}
+
+		out << "  ]\n";
+		out << "}\n";
+	}
+
+	BenchmarkOptions parseOptions(int argc, char* argv[]) {
+		BenchmarkOptions options;
+
+		for (int i = 1; i < argc; i++) {
+			std::string argument = argv[i];
+			bool hasValue = i + 1 < argc;
+
+			if (argument == "--windowed")
+				options.windowed = true;
+			else if (argument == "--frames" && hasValue)
+				options.measuredFrames = std::max(1, std::atoi(argv[++i]));
+			else if (argument == "--warmup" && hasValue)
+				options.warmupFrames = std::max(0, std::atoi(argv[++i]));
+			else if (argument == "--width" && hasValue)
+				options.width = std::max(1, std::atoi(argv[++i]));
+			else if (argument == "--height" && hasValue)
+				options.height = std::max(1, std::atoi(argv[++i]));
+			else if (argument == "--scene" && hasValue)
+				options.sceneFilter = argv[++i];
+			else if (argument == "--output" && hasValue)
+				options.outputPath = argv[++i];
+			else if (argument == "--decode" && hasValue)
+				options.decodePaths.push_back(argv[++i]);
+			else if (argument == "--stress-ordering")
+				options.stressOrdering = true;
+			else
+				throw std::runtime_error("Unknown benchmark argument " + argument + ", expected --windowed, --frames n, --warmup n, --width n, --height n, --scene name, --output path, --decode image or --stress-ordering.");
+		}
+
+		if (options.stressOrdering && options.windowed)
+			throw std::runtime_error("--stress-ordering runs headless, drop --windowed.");
+
+		return options;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	try {
+		BenchmarkOptions options = parseOptions(argc, argv);
+
+		std::vector<TextureDecode::BenchmarkResult> decodeResults; //CPU only, before the device exists so nothing else competes for the cores
+		if (!options.decodePaths.empty())
+			decodeResults = TextureDecode::benchmarkDecode(options.decodePaths);
+
+		auto jobSystem = std::make_unique<Cinder::JobSystem>();
+		auto vulkanCore = options.windowed ? std::make_unique<VulkanCore>() : std::make_unique<VulkanCore>(options.width, options.height);
+		vulkanCore->setJobSystem(jobSystem.get());
+		vulkanCore->setPresentPolicy(PresentPolicy::eMaxThroughput); //Windowed runs shouldn't be capped at the refresh rate
+		vulkanCore->initVulkan();
+
+		if (options.stressOrdering) { //--frames frames, exits non-zero on any ordering failure
+			OrderingStressResult stress = runOrderingStress(vulkanCore.get(), options.measuredFrames);
+
+			for (const auto& failure : stress.failures)
+				std::cerr << failure << std::endl;
+
+			std::cout << "Ordering stress: " << stress.frames << " frames, " << stress.uploads << " uploads, " << stress.deletions << " deletions, "
+				<< stress.failures.size() << " failures (" << (vulkanCore->getTimelinePtr()->isUsingTimelineSemaphore() ? "timeline semaphore" : "fence fallback") << ")" << std::endl;
+
+			return stress.failures.empty() ? 0 : 1;
+		}
+
+		constexpr uint32_t MATERIAL_COUNT = 256;
+		auto resources = std::make_unique<BenchmarkResources>(vulkanCore.get(), MATERIAL_COUNT);
+
+		struct SceneFactory {
+			const char* name;
+			std::function<BenchmarkScene()> make;
+		};
+
+		VulkanCore* core = vulkanCore.get();
+		std::vector<SceneFactory> factories = {
+			{ "instancedCubes", [core]() { return makeInstancedCubes(core, 256 * 1024); } },
+			{ "uniqueMeshes", [core]() { return makeUniqueMeshes(core, 4096); } },
+			{ "manyLights", [core]() { return makeManyLights(core, 16 * 1024, 4096, 16); } },
+			{ "manyTextures", [core]() { return makeManyTextures(core, 64 * 1024, MATERIAL_COUNT); } },
+			{ "materialBranches", [core]() { return makeMaterialPermutations(core, 4096, false); } }, //Compare the pair's main pass GPU times
+			{ "materialSpecialized", [core]() { return makeMaterialPermutations(core, 4096, true); } },
+			{ "depthPrepassOff", [core]() { return makeDepthPrepassScene(core, 4096, false); } },
+			{ "depthPrepassOn", [core]() { return makeDepthPrepassScene(core, 4096, true); } }
+		};
+
+		std::vector<SceneResult> results;
+		for (const auto& factory : factories) {
+			if (!options.sceneFilter.empty() && options.sceneFilter != factory.name)
+				continue;
+
+			auto setupStart = std::chrono::steady_clock::now();
+			BenchmarkScene scene = factory.make();
+			double setupMs = toMilliseconds(std::chrono::steady_clock::now() - setupStart);
+
+			results.push_back(runScene(core, *resources, scene, options, setupMs));
+		}
+
+		if (results.empty())
+			throw std::runtime_error("No benchmark scene is called " + options.sceneFilter + ".");
+
+		std::vector<RecordingBenchmarkResult> recordingResults = core->getParallelRecorderPtr()->benchmarkRecording({ 1, 2, 4, 8 }, RECORDING_DRAWS, RECORDING_ITERATIONS,
+			resources->getPipeline()); //CPU only, how secondary command buffer recording scales with threads
+
+		vulkanCore->getLogicalDevicePtr()->waitIdle();
+		resources.reset();
+
+		if (options.outputPath.empty())
+			writeJson(std::cout, results, decodeResults, recordingResults, options);
+		else {
+			std::ofstream file(options.outputPath);
+			if (!file)
+				throw std::runtime_error("Failed to open " + options.outputPath + " for writing.");
+
+			writeJson(file, results, decodeResults, recordingResults, options);
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+#endif
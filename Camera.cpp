@@ -1 +1,38 @@
-#include "Camera.h"
\ No newline at end of file
+#include "Camera.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace Cinder {
+	glm::vec3 Camera::getForward() const {
+		float yawRadians = glm::radians(yaw), pitchRadians = glm::radians(pitch);
+		return glm::vec3(std::cos(yawRadians) * std::cos(pitchRadians), std::sin(pitchRadians), std::sin(yawRadians) * std::cos(pitchRadians));
+	}
+
+	glm::mat4 Camera::getView() const {
+		return glm::lookAt(position, position + getForward(), glm::vec3(0.0f, 1.0f, 0.0f));
+	}
+
+	glm::mat4 Camera::getProjection(float aspect) const {
+		glm::mat4 projection = glm::perspectiveZO(glm::radians(fovY), aspect, zNear, zFar);
+		projection[1][1] *= -1;
+
+		return projection;
+	}
+
+	void Camera::step(float seconds) {
+		position += velocity * seconds;
+		pitch = std::min(std::max(pitch, -89.0f), 89.0f);
+	}
+
+	Camera Camera::interpolate(const Camera& previous, const Camera& current, float alpha) {
+		Camera camera = current;
+		camera.position = glm::mix(previous.position, current.position, alpha);
+
+		float yawDelta = std::remainder(current.yaw - previous.yaw, 360.0f); //Shortest way round, 350 to 10 is +20 not -340
+		camera.yaw = previous.yaw + yawDelta * alpha;
+		camera.pitch = previous.pitch + (current.pitch - previous.pitch) * alpha;
+
+		return camera;
+	}
+}
@@ -1 +1,23 @@
-#pragma once
+#pragma once
+#include "glm/glm.hpp"
+
+namespace Cinder {
+	struct Camera { //Simulation state, rendered interpolated between the last two simulation steps
+		glm::vec3 position = glm::vec3(0.0f, 2.0f, 5.0f);
+		glm::vec3 velocity = glm::vec3(0.0f); //World units per second
+		float yaw = -90.0f; //Degrees, -90 looks down -z
+		float pitch = 0.0f; //Degrees, clamped short of straight up and down
+
+		float fovY = 60.0f; //Degrees
+		float zNear = 0.1f;
+		float zFar = 1000.0f;
+
+		glm::vec3 getForward() const;
+		glm::mat4 getView() const;
+		glm::mat4 getProjection(float aspect) const; //Vulkan clip space, y points down and depth is 0 to 1
+
+		void step(float seconds); //One fixed simulation step
+
+		static Camera interpolate(const Camera& previous, const Camera& current, float alpha); //alpha is how far past previous the render time is, in steps
+	};
+}
@@ -1,7 +1,7 @@
-namespace Cinder {
-	class CinderObject {
-		const virtual void tick() = 0;
-	};
-}
-
+namespace Cinder {
+	class CinderObject {
+		const virtual void tick() = 0;
+	};
+}
+
 using namespace Cinder; //Namespaces are just for organisation; I don't mind using statements for my own namespaces
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "DrawSort.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+
+namespace CinderVk {
+	namespace DrawSort {
+		namespace {
+			constexpr uint32_t PASS_SHIFT = 60;
+			constexpr uint32_t LAYER_SHIFT = 59;
+
+			//Opaque: pipeline, material, mesh, then depth front to back
+			constexpr uint32_t OPAQUE_PIPELINE_SHIFT = 47;
+			constexpr uint32_t OPAQUE_MATERIAL_SHIFT = 33;
+			constexpr uint32_t OPAQUE_MESH_SHIFT = 20;
+			constexpr uint32_t OPAQUE_DEPTH_BITS = 20;
+
+			//Transparent: depth back to front, then pipeline and material to group the rare ties
+			constexpr uint32_t TRANSPARENT_DEPTH_SHIFT = 35;
+			constexpr uint32_t TRANSPARENT_DEPTH_BITS = 24;
+			constexpr uint32_t TRANSPARENT_PIPELINE_SHIFT = 23;
+			constexpr uint32_t TRANSPARENT_MATERIAL_SHIFT = 9;
+
+			constexpr size_t MIN_ITEMS_PER_CHUNK = 2048; //Smaller chunks spend more on histograms than on sorting
+			constexpr uint32_t RADIX = 256;
+
+			uint64_t field(uint64_t value, uint32_t bits, uint32_t shift) {
+				return (value & ((1ull << bits) - 1)) << shift;
+			}
+
+			uint64_t quantizeDepth(float viewDepth, float zNear, float zFar, uint32_t bits) {
+				float clampedDepth = std::min(std::max(viewDepth, zNear), zFar);
+				float t = std::log(clampedDepth / zNear) / std::log(zFar / zNear); //Log spacing, as much precision near the camera as far away
+				uint64_t maxValue = (1ull << bits) - 1;
+
+				return std::min(static_cast<uint64_t>(t * static_cast<float>(maxValue)), maxValue);
+			}
+		}
+
+		uint64_t makeKey(const DrawKeyFields& fields, float zNear, float zFar) {
+			uint64_t key = field(fields.pass, 4, PASS_SHIFT);
+
+			if (fields.layer == DrawLayer::eOpaque) {
+				key |= field(fields.pipeline, 12, OPAQUE_PIPELINE_SHIFT);
+				key |= field(fields.material, 14, OPAQUE_MATERIAL_SHIFT);
+				key |= field(fields.mesh, 13, OPAQUE_MESH_SHIFT);
+				key |= quantizeDepth(fields.viewDepth, zNear, zFar, OPAQUE_DEPTH_BITS);
+			}
+			else {
+				uint64_t depth = quantizeDepth(fields.viewDepth, zNear, zFar, TRANSPARENT_DEPTH_BITS);
+
+				key |= 1ull << LAYER_SHIFT;
+				key |= field(((1ull << TRANSPARENT_DEPTH_BITS) - 1) - depth, TRANSPARENT_DEPTH_BITS, TRANSPARENT_DEPTH_SHIFT);
+				key |= field(fields.pipeline, 12, TRANSPARENT_PIPELINE_SHIFT);
+				key |= field(fields.material, 14, TRANSPARENT_MATERIAL_SHIFT);
+			}
+
+			return key;
+		}
+
+		void sort(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch, Cinder::JobSystem* jobs) {
+			size_t count = items.size();
+			if (count < 2)
+				return;
+
+			scratch.resize(count);
+
+			size_t chunkCount = 1;
+			if (jobs)
+				chunkCount = std::max<size_t>(1, std::min<size_t>(jobs->getThreadCount() * 2, count / MIN_ITEMS_PER_CHUNK));
+
+			size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+			std::vector<std::array<uint32_t, RADIX>> histograms(chunkCount);
+
+			auto forEachChunk = [&](const std::function<void(size_t chunk, size_t begin, size_t end)>& body) {
+				auto run = [&](size_t chunk) { body(chunk, chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize)); };
+
+				if (chunkCount > 1)
+					jobs->parallelFor(chunkCount, 1, [&](size_t begin, size_t end) {
+						for (size_t chunk = begin; chunk != end; chunk++)
+							run(chunk);
+					});
+				else
+					run(0);
+			};
+
+			DrawItem* source = items.data();
+			DrawItem* destination = scratch.data();
+
+			for (uint32_t shift = 0; shift != 64; shift += 8) {
+				forEachChunk([&](size_t chunk, size_t begin, size_t end) {
+					std::array<uint32_t, RADIX>& histogram = histograms[chunk];
+					histogram.fill(0);
+
+					for (size_t i = begin; i != end; i++)
+						histogram[(source[i].key >> shift) & (RADIX - 1)]++;
+				});
+
+				bool shared = false; //Every key has the same digit here, e.g. unused pass bits, the pass would only copy
+				for (uint32_t digit = 0; digit != RADIX && !shared; digit++) {
+					uint64_t total = 0;
+					for (const auto& histogram : histograms)
+						total += histogram[digit];
+
+					shared = total == count;
+				}
+
+				if (shared)
+					continue;
+
+				uint32_t offset = 0; //Histograms become each chunk's write cursor per digit, chunk order keeps the sort stable
+				for (uint32_t digit = 0; digit != RADIX; digit++)
+					for (auto& histogram : histograms) {
+						uint32_t digitCount = histogram[digit];
+						histogram[digit] = offset;
+						offset += digitCount;
+					}
+
+				forEachChunk([&](size_t chunk, size_t begin, size_t end) {
+					std::array<uint32_t, RADIX>& cursors = histograms[chunk];
+
+					for (size_t i = begin; i != end; i++)
+						destination[cursors[(source[i].key >> shift) & (RADIX - 1)]++] = source[i];
+				});
+
+				std::swap(source, destination);
+			}
+
+			if (source != items.data())
+				items.swap(scratch);
+		}
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace Cinder {
+	class JobSystem;
+}
+
+namespace CinderVk {
+	enum class DrawLayer : uint8_t {
+		eOpaque, //Front to back, grouped by state first
+		eTransparent //Back to front, blending needs the order more than state grouping
+	};
+
+	struct DrawKeyFields {
+		uint8_t pass = 0; //4 bits, most significant, earlier passes sort first
+		DrawLayer layer = DrawLayer::eOpaque;
+		uint16_t pipeline = 0; //12 bits, e.g. VulkanPipelineManager::getSortId
+		uint16_t material = 0; //14 bits
+		uint16_t mesh = 0; //13 bits, opaque only
+		float viewDepth = 0.0f; //Positive distance along the view direction
+	};
+
+	struct DrawItem {
+		uint64_t key;
+		uint32_t drawIndex; //Into whatever list the caller built the keys from
+	};
+
+	namespace DrawSort {
+		uint64_t makeKey(const DrawKeyFields& fields, float zNear, float zFar); //Depth is bucketed logarithmically between the planes
+
+		void sort(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch, Cinder::JobSystem* jobs = nullptr); //Stable 8 bit LSD radix sort, digits every key shares are skipped. scratch is reused between frames
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "Camera.h"
+#include "VulkanClusteredLighting.h"
+#include "VulkanCore.h"
+#include "VulkanShadowCache.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace Cinder {
+	struct FrameSnapshot { //Everything the render thread needs from one simulation step, never changed once published
+		uint64_t simulationStep = 0; //0 until the first publish
+		std::chrono::steady_clock::time_point published; //Interpolation runs from here
+		std::chrono::nanoseconds step{ 0 }; //Length of a simulation step
+		std::chrono::steady_clock::time_point inputPolled; //When the input this step simulated was polled, the start of input to present latency
+
+		Camera previousCamera, camera; //Rendered between the two
+		int64_t mouseTotalX = 0, mouseTotalY = 0; //Look already included in camera, motion past this is applied just before recording
+		std::vector<CinderVk::PointLight> lights;
+		std::vector<CinderVk::ShadowLight> shadowLights; //Entry i shadows lights[i]
+
+		uint32_t refreshRate = 0; //Asked for on the simulation thread, SDL video calls belong there
+		CinderVk::WindowState window; //Same, for swapchain recreation on the render thread
+	};
+
+	template <typename T>
+	class TripleBuffer { //Single producer single consumer, neither side ever waits. The reader always gets the newest published value, older ones are dropped
+	public:
+		T& getWriteBuffer() { //Holds whatever was published two writes ago, overwrite all of it. Containers keep their capacity so steady state doesn't allocate
+			return buffers[writeIndex];
+		}
+
+		void publish() {
+			writeIndex = middle.exchange(writeIndex | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+		}
+
+		bool consume() { //False if nothing was published since the last call, getReadBuffer still returns the previous value then
+			if (!(middle.load(std::memory_order_relaxed) & FRESH_BIT))
+				return false;
+
+			readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+			return true;
+		}
+
+		const T& getReadBuffer() const {
+			return buffers[readIndex];
+		}
+
+	private:
+		static constexpr uint8_t INDEX_MASK = 0x3;
+		static constexpr uint8_t FRESH_BIT = 0x4;
+
+		std::array<T, 3> buffers;
+		alignas(64) uint8_t writeIndex = 0; //Producer only
+		alignas(64) std::atomic<uint8_t> middle{ 1 }; //The slot being handed over, plus FRESH_BIT when the producer filled it since the consumer last took it
+		alignas(64) uint8_t readIndex = 2; //Consumer only
+	};
+}
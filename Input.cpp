@@ -1,48 +1,186 @@
-#include "Input.h"
-#include "SDL2/SDL.h"
-
-namespace Cinder {
-	struct InputCore::impl {
-		const float speed = 20.0f;
-		const float mouseSensitivity = 35.0f;
-
-		bool* activePtr = nullptr;
-
-		impl(bool* active) : activePtr(active) {}
-
-		~impl() {}
-
-		const void update() {
-			SDL_Event e;
-			SDL_PumpEvents();
-			const Uint8* state = SDL_GetKeyboardState(NULL);
-
-			if (state[SDL_SCANCODE_ESCAPE])
-				*activePtr = !(*activePtr);
-
-			while (SDL_PollEvent(&e)) {
-				switch (e.type) {
-				case SDL_QUIT:
-					*activePtr = !(*activePtr);
-					break;
-				case SDL_WINDOWEVENT&& SDL_WINDOWEVENT_RESIZED:
-					//vulkan->framebufferResizedSwitchPublic();
-					break;
-				case SDL_MOUSEMOTION:
-
-					break;
-				}
-			}
-		}
-
-	};
-
-	InputCore::InputCore(bool* activePtr) : pImpl(std::make_unique<impl>(activePtr)) {}
-	InputCore::~InputCore() {}
-}
-
-namespace Cinder {
-	const void InputCore::tick() {
-		pImpl->update();
-	}
-}
\ No newline at end of file
+#include "Input.h"
+#include "Camera.h"
+#include "VulkanCore.h"
+#include "SDL2/SDL.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <thread>
+
+namespace Cinder {
+	struct InputCore::impl {
+		const float speed = 20.0f;
+		const float mouseSensitivity = 35.0f; //Thousandths of a degree per raw count
+
+		bool* activePtr = nullptr;
+		CinderVk::VulkanCore* corePtr = nullptr;
+
+		std::array<InputEvent, EVENT_RING_SIZE> ring; //Main thread only, like everything else here but the mouse totals
+		uint64_t written = 0; //Total ever pushed, the ring index is this modulo EVENT_RING_SIZE
+		uint64_t consumed = 0; //Up to here has been handed to a step
+		int64_t steppedMouseX = 0, steppedMouseY = 0; //Mouse totals at the last step
+
+		std::atomic<int64_t> mouseTotalX{ 0 }, mouseTotalY{ 0 }; //Read by the render thread for late look
+		std::array<bool, SDL_NUM_SCANCODES> held{};
+
+		InputState state;
+
+		impl(bool* active, CinderVk::VulkanCore* core) : activePtr(active), corePtr(core) {
+			if (SDL_WasInit(SDL_INIT_VIDEO)) //Headless never initialises SDL, there is no window to grab the mouse for
+				SDL_SetRelativeMouseMode(SDL_TRUE); //Raw motion instead of the cursor, which is clamped at the window edges and accelerated by the OS
+		}
+
+		~impl() {}
+
+		const void push(InputEvent::Type type, int32_t code, int32_t x, int32_t y, Uint32 sdlTimestamp, std::chrono::steady_clock::time_point now, Uint32 nowTicks) {
+			InputEvent& event = ring[written % EVENT_RING_SIZE];
+			event.type = type;
+			event.code = code;
+			event.x = x;
+			event.y = y;
+			event.timestamp = now - std::chrono::milliseconds(nowTicks - std::min(sdlTimestamp, nowTicks)); //SDL stamps events in milliseconds since SDL_Init
+			written++;
+		}
+
+		const void poll() {
+			if (!SDL_WasInit(SDL_INIT_EVENTS)) //Headless, no event queue to drain
+				return;
+
+			SDL_Event e;
+			auto now = std::chrono::steady_clock::now();
+			Uint32 nowTicks = SDL_GetTicks();
+
+			while (SDL_PollEvent(&e)) { //Pumps too, no separate SDL_PumpEvents
+				switch (e.type) {
+				case SDL_QUIT:
+					*activePtr = false;
+					push(InputEvent::Type::eQuit, 0, 0, 0, e.quit.timestamp, now, nowTicks);
+					break;
+				case SDL_WINDOWEVENT:
+					if (e.window.event == SDL_WINDOWEVENT_RESIZED || e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) { //SIZE_CHANGED also covers resizes the program asked for
+						if (corePtr)
+							corePtr->framebufferResizedSwitch();
+						push(InputEvent::Type::eResize, 0, e.window.data1, e.window.data2, e.window.timestamp, now, nowTicks);
+					}
+					break;
+				case SDL_MOUSEMOTION:
+					mouseTotalX.fetch_add(e.motion.xrel, std::memory_order_relaxed);
+					mouseTotalY.fetch_add(e.motion.yrel, std::memory_order_relaxed);
+					push(InputEvent::Type::eMouseMotion, 0, e.motion.xrel, e.motion.yrel, e.motion.timestamp, now, nowTicks);
+					break;
+				case SDL_MOUSEBUTTONDOWN:
+				case SDL_MOUSEBUTTONUP:
+					push(e.type == SDL_MOUSEBUTTONDOWN ? InputEvent::Type::eMouseButtonDown : InputEvent::Type::eMouseButtonUp, e.button.button, e.button.x, e.button.y, e.button.timestamp, now, nowTicks);
+					break;
+				case SDL_KEYDOWN:
+				case SDL_KEYUP:
+					if (e.key.repeat)
+						break;
+
+					held[e.key.keysym.scancode] = e.type == SDL_KEYDOWN;
+					push(e.type == SDL_KEYDOWN ? InputEvent::Type::eKeyDown : InputEvent::Type::eKeyUp, e.key.keysym.scancode, 0, 0, e.key.timestamp, now, nowTicks);
+
+					if (e.type == SDL_KEYDOWN && e.key.keysym.scancode == SDL_SCANCODE_ESCAPE)
+						*activePtr = false;
+
+					if (e.type == SDL_KEYDOWN && e.key.keysym.scancode == SDL_SCANCODE_F10 && corePtr) //Low latency, max throughput, power saving, round again
+						corePtr->setPresentPolicy(static_cast<CinderVk::PresentPolicy>((static_cast<uint8_t>(corePtr->getPresentPolicy()) + 1) % 3));
+
+					if (e.type == SDL_KEYDOWN && e.key.keysym.scancode == SDL_SCANCODE_F12) //Last few seconds of every thread plus the GPU, open in ui.perfetto.dev
+						CINDER_TRACE_DUMP("cinderTrace.json");
+					break;
+				}
+			}
+		}
+
+		const InputState& tick() {
+			poll(); //Whatever arrived since the loop last polled belongs to this step
+
+			state.events.clear();
+			state.droppedEvents = 0;
+
+			if (written - consumed > EVENT_RING_SIZE) { //More than a ring's worth in one step, the oldest were overwritten
+				state.droppedEvents = static_cast<uint32_t>(written - consumed - EVENT_RING_SIZE);
+				consumed = written - EVENT_RING_SIZE;
+			}
+
+			for (; consumed != written; consumed++) {
+				const InputEvent& event = ring[consumed % EVENT_RING_SIZE];
+				state.events.push_back(event);
+			}
+
+			state.mouseTotalX = mouseTotalX.load(std::memory_order_relaxed); //Totals rather than summing the ring, motion in dropped events still counts
+			state.mouseTotalY = mouseTotalY.load(std::memory_order_relaxed);
+			state.mouseDeltaX = static_cast<int32_t>(state.mouseTotalX - steppedMouseX);
+			state.mouseDeltaY = static_cast<int32_t>(state.mouseTotalY - steppedMouseY);
+			steppedMouseX = state.mouseTotalX;
+			steppedMouseY = state.mouseTotalY;
+
+			state.forward = held[SDL_SCANCODE_W];
+			state.back = held[SDL_SCANCODE_S];
+			state.left = held[SDL_SCANCODE_A];
+			state.right = held[SDL_SCANCODE_D];
+			state.up = held[SDL_SCANCODE_SPACE];
+			state.down = held[SDL_SCANCODE_LCTRL];
+
+			return state;
+		}
+
+		const void look(Camera& camera, int64_t deltaX, int64_t deltaY) const {
+			float degreesPerCount = mouseSensitivity / 1000.0f;
+			camera.yaw += deltaX * degreesPerCount;
+			camera.pitch = std::min(std::max(camera.pitch - deltaY * degreesPerCount, -89.0f), 89.0f); //SDL's y grows downwards
+		}
+	};
+
+	InputCore::InputCore(bool* activePtr, CinderVk::VulkanCore* core) : pImpl(std::make_unique<impl>(activePtr, core)) {}
+	InputCore::~InputCore() {}
+}
+
+namespace Cinder {
+	const void InputCore::poll() {
+		CINDER_TRACE_SCOPE("InputCore::poll");
+		pImpl->poll();
+	}
+
+	const void InputCore::waitForEvents(std::chrono::steady_clock::time_point deadline) {
+		if (!SDL_WasInit(SDL_INIT_EVENTS)) { //Headless, SDL was never initialised and would return straight away
+			std::this_thread::sleep_until(deadline);
+			return;
+		}
+
+		auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()); //Rounded up, an early wake would just loop back here
+		if (remaining.count() > 0)
+			SDL_WaitEventTimeout(nullptr, static_cast<int>(remaining.count())); //Null leaves the event queued for poll
+	}
+
+	const InputState& InputCore::tick() {
+		CINDER_TRACE_SCOPE("InputCore::tick");
+		return pImpl->tick();
+	}
+
+	const void InputCore::driveCamera(Camera& camera) const {
+		const InputState& state = pImpl->state;
+		pImpl->look(camera, state.mouseDeltaX, state.mouseDeltaY);
+
+		glm::vec3 forward = camera.getForward();
+		glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+		glm::vec3 direction(0.0f);
+
+		direction += forward * static_cast<float>(state.forward - state.back);
+		direction += right * static_cast<float>(state.right - state.left);
+		direction.y += static_cast<float>(state.up - state.down);
+
+		camera.velocity = glm::dot(direction, direction) > 0.0f ? glm::normalize(direction) * pImpl->speed : glm::vec3(0.0f);
+	}
+
+	const void InputCore::applyPendingLook(Camera& camera, int64_t consumedX, int64_t consumedY) const {
+		pImpl->look(camera, pImpl->mouseTotalX.load(std::memory_order_relaxed) - consumedX, pImpl->mouseTotalY.load(std::memory_order_relaxed) - consumedY);
+	}
+
+	const void InputCore::getMouseTotal(int64_t& x, int64_t& y) const {
+		x = pImpl->mouseTotalX.load(std::memory_order_relaxed);
+		y = pImpl->mouseTotalY.load(std::memory_order_relaxed);
+	}
+}
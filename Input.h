@@ -1,15 +1,57 @@
-#pragma once
-#include <memory>
-
-namespace Cinder {
-	class InputCore {
-	public:
-		InputCore(bool* activePtr); //For now this will take pointer to game loop bool, will remove when engine passes stage of needing it
-		~InputCore();
-		const void tick();
-	private:
-		struct impl;
-		const std::unique_ptr<impl> pImpl;
-	};
-}
-
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace CinderVk {
+	class VulkanCore;
+}
+
+namespace Cinder {
+	struct Camera;
+
+	struct InputEvent {
+		enum class Type : uint8_t {
+			eKeyDown,
+			eKeyUp,
+			eMouseMotion,
+			eMouseButtonDown,
+			eMouseButtonUp,
+			eResize,
+			eQuit
+		};
+
+		Type type;
+		int32_t code = 0; //SDL scancode or mouse button
+		int32_t x = 0, y = 0; //Relative motion for eMouseMotion, new size for eResize
+		std::chrono::steady_clock::time_point timestamp; //When SDL received it, on the same clock as everything else
+	};
+
+	struct InputState { //One simulation step's worth of input
+		std::vector<InputEvent> events; //Since the previous step, oldest first
+		int32_t mouseDeltaX = 0, mouseDeltaY = 0; //Raw counts since the previous step, not scaled or accelerated
+		int64_t mouseTotalX = 0, mouseTotalY = 0; //Raw counts since startup up to this step, compare with getMouseTotal for motion the simulation hasn't seen yet
+		bool forward = false, back = false, left = false, right = false, up = false, down = false; //Held at the end of the step
+		uint32_t droppedEvents = 0; //Overwritten in the ring buffer before the step got to them
+	};
+
+	class InputCore {
+	public:
+		static constexpr uint32_t EVENT_RING_SIZE = 1024;
+
+		InputCore(bool* activePtr, CinderVk::VulkanCore* core = nullptr); //For now this will take pointer to game loop bool, will remove when engine passes stage of needing it. core gets resize notifications
+		~InputCore();
+
+		const void poll(); //Main thread, drains SDL's queue into the ring buffer. Call as often as the loop allows, not just once per step
+		const void waitForEvents(std::chrono::steady_clock::time_point deadline); //Main thread, sleeps until an event arrives or deadline passes
+		const InputState& tick(); //Once per simulation step, valid until the next call
+
+		const void driveCamera(Camera& camera) const; //Applies the last tick's movement keys and mouse look
+		const void applyPendingLook(Camera& camera, int64_t consumedX, int64_t consumedY) const; //Any thread, adds mouse motion the simulation hasn't consumed yet, just before recording
+		const void getMouseTotal(int64_t& x, int64_t& y) const; //Any thread
+	private:
+		struct impl;
+		const std::unique_ptr<impl> pImpl;
+	};
+}
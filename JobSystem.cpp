@@ -0,0 +1,322 @@
+#include "JobSystem.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+namespace Cinder {
+	namespace {
+		thread_local const void* currentOwner = nullptr; //The impl whose thread this is
+		thread_local uint32_t currentIndex = UINT32_MAX;
+
+		struct Job {
+			std::function<void()> function;
+			JobCounter* counter;
+		};
+
+		struct WorkerQueue { //Owner pushes and pops at the back, thieves take from the front
+			std::mutex mutex;
+			std::deque<Job> jobs;
+
+			std::atomic<uint64_t> jobsExecuted{ 0 };
+			std::atomic<uint64_t> jobsStolen{ 0 };
+			std::atomic<uint64_t> busyNanoseconds{ 0 };
+		};
+	}
+
+	struct JobSystem::impl {
+		std::vector<std::unique_ptr<WorkerQueue>> queues; //One per thread, 0 is the main thread
+		std::vector<std::thread> workers;
+
+		std::mutex mainThreadMutex;
+		std::deque<Job> mainThreadJobs; //Only the main thread takes these
+
+		std::mutex sleepMutex;
+		std::condition_variable sleepCondition;
+		std::atomic<uint32_t> queuedJobs{ 0 }; //Jobs sitting in any worker deque
+		std::atomic<bool> stopping{ false };
+
+		std::chrono::steady_clock::time_point statsStart = std::chrono::steady_clock::now();
+		const void* previousOwner = currentOwner; //A short lived system, e.g. for a benchmark, hands the thread back when it goes
+		uint32_t previousIndex = currentIndex;
+
+		impl(uint32_t workerCount) {
+			if (workerCount == 0)
+				workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+			for (uint32_t i = 0; i != workerCount + 1; i++)
+				queues.push_back(std::make_unique<WorkerQueue>());
+
+			currentOwner = this;
+			currentIndex = 0;
+
+			for (uint32_t i = 1; i != workerCount + 1; i++)
+				workers.emplace_back([this, i]() { workerLoop(i); });
+		}
+
+		~impl() {
+			{
+				std::lock_guard<std::mutex> lock(sleepMutex);
+				stopping = true;
+			}
+			sleepCondition.notify_all();
+
+			for (auto& worker : workers)
+				worker.join();
+
+			if (currentOwner == this) {
+				currentOwner = previousOwner;
+				currentIndex = previousIndex;
+			}
+		}
+
+		uint32_t getThreadIndex() const {
+			return currentOwner == this ? currentIndex : UINT32_MAX;
+		}
+
+		void workerLoop(uint32_t index) {
+			currentOwner = this;
+			currentIndex = index;
+			CINDER_TRACE_THREAD_NAME("Worker " + std::to_string(index));
+
+			while (true) {
+				if (tryRunOne(index))
+					continue;
+
+				std::unique_lock<std::mutex> lock(sleepMutex);
+				sleepCondition.wait(lock, [this]() { return queuedJobs.load() != 0 || stopping.load(); });
+
+				if (stopping && queuedJobs.load() == 0) //Queued work still finishes so nothing waiting on a counter hangs
+					return;
+			}
+		}
+
+		void push(Job&& job, JobAffinity affinity) {
+			if (affinity == JobAffinity::eMainThread) {
+				std::lock_guard<std::mutex> lock(mainThreadMutex);
+				mainThreadJobs.push_back(std::move(job));
+				return;
+			}
+
+			uint32_t index = getThreadIndex();
+			WorkerQueue& queue = *queues[index == UINT32_MAX ? 0 : index]; //Outside threads feed the main thread's deque, workers steal from it
+
+			{
+				std::lock_guard<std::mutex> lock(queue.mutex);
+				queue.jobs.push_back(std::move(job));
+			}
+
+			queuedJobs++;
+			{
+				std::lock_guard<std::mutex> lock(sleepMutex); //A worker between its predicate check and sleeping would otherwise miss this
+			}
+			sleepCondition.notify_one();
+		}
+
+		bool tryRunOne(uint32_t index) {
+			Job job;
+			bool found = false, stolen = false;
+
+			if (index != UINT32_MAX) {
+				WorkerQueue& own = *queues[index];
+				std::lock_guard<std::mutex> lock(own.mutex);
+
+				if (!own.jobs.empty()) { //Newest first, its data is most likely still in cache
+					job = std::move(own.jobs.back());
+					own.jobs.pop_back();
+					queuedJobs--;
+					found = true;
+				}
+			}
+
+			if (!found && index == 0) {
+				std::lock_guard<std::mutex> lock(mainThreadMutex);
+
+				if (!mainThreadJobs.empty()) {
+					job = std::move(mainThreadJobs.front());
+					mainThreadJobs.pop_front();
+					found = true;
+				}
+			}
+
+			if (!found && queuedJobs.load() != 0) {
+				uint32_t count = static_cast<uint32_t>(queues.size());
+				uint32_t start = index == UINT32_MAX ? 0 : index;
+
+				for (uint32_t i = 1; i != count + 1 && !found; i++) {
+					uint32_t victim = (start + i) % count;
+					if (victim == index)
+						continue;
+
+					WorkerQueue& queue = *queues[victim];
+					std::lock_guard<std::mutex> lock(queue.mutex);
+
+					if (!queue.jobs.empty()) { //Oldest first, usually the biggest remaining chunk of work
+						job = std::move(queue.jobs.front());
+						queue.jobs.pop_front();
+						queuedJobs--;
+						found = stolen = true;
+					}
+				}
+			}
+
+			if (!found)
+				return false;
+
+			execute(job, index, stolen);
+			return true;
+		}
+
+		void execute(Job& job, uint32_t index, bool stolen) {
+			CINDER_TRACE_SCOPE("job");
+			auto start = std::chrono::steady_clock::now();
+
+			try {
+				job.function();
+			}
+			catch (...) {
+				if (job.counter) {
+					std::lock_guard<std::mutex> lock(job.counter->continuationsMutex);
+					if (!job.counter->error)
+						job.counter->error = std::current_exception();
+				}
+			}
+
+			if (index != UINT32_MAX) {
+				WorkerQueue& queue = *queues[index];
+				queue.busyNanoseconds += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+				queue.jobsExecuted++;
+				if (stolen)
+					queue.jobsStolen++;
+			}
+
+			finish(job.counter);
+		}
+
+		void finish(JobCounter* counter) {
+			if (!counter)
+				return;
+
+			std::vector<JobCounter::Continuation> ready;
+			{
+				std::lock_guard<std::mutex> lock(counter->continuationsMutex); //Held across the decrement, wait() takes it too so the counter can't be destroyed under us
+				if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+					return;
+
+				ready.swap(counter->continuations);
+			}
+
+			for (auto& continuation : ready)
+				push({ std::move(continuation.function), continuation.counter }, continuation.affinity);
+		}
+	};
+
+	JobSystem::JobSystem(uint32_t workerCount) : pImpl(std::make_unique<impl>(workerCount)) {}
+
+	JobSystem::~JobSystem() = default;
+
+	void JobSystem::run(const std::function<void()>& job, JobCounter* counter, JobAffinity affinity) {
+		if (counter)
+			counter->pending++;
+
+		pImpl->push({ job, counter }, affinity);
+	}
+
+	void JobSystem::runAfter(JobCounter& dependency, const std::function<void()>& job, JobCounter* counter, JobAffinity affinity) {
+		if (counter)
+			counter->pending++; //Counted straight away so waiting on counter also waits for the dependency
+
+		{
+			std::lock_guard<std::mutex> lock(dependency.continuationsMutex);
+			if (!dependency.isDone()) {
+				dependency.continuations.push_back({ job, counter, affinity });
+				return;
+			}
+		}
+
+		pImpl->push({ job, counter }, affinity);
+	}
+
+	void JobSystem::wait(JobCounter& counter) {
+		uint32_t index = pImpl->getThreadIndex();
+
+		while (!counter.isDone())
+			if (!pImpl->tryRunOne(index))
+				std::this_thread::yield();
+
+		std::exception_ptr error;
+		{
+			std::lock_guard<std::mutex> lock(counter.continuationsMutex);
+			std::swap(error, counter.error);
+		}
+
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+	void JobSystem::parallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& body) {
+		if (count == 0)
+			return;
+
+		grainSize = std::max<size_t>(grainSize, 1);
+		if (count <= grainSize) { //Not worth a job
+			body(0, count);
+			return;
+		}
+
+		JobCounter counter;
+		for (size_t begin = 0; begin < count; begin += grainSize) {
+			size_t end = std::min(begin + grainSize, count);
+			run([&body, begin, end]() { body(begin, end); }, &counter);
+		}
+
+		wait(counter);
+	}
+
+	void JobSystem::pumpMainThread() {
+		std::deque<Job> jobs;
+		{
+			std::lock_guard<std::mutex> lock(pImpl->mainThreadMutex);
+			jobs.swap(pImpl->mainThreadJobs);
+		}
+
+		for (auto& job : jobs)
+			pImpl->execute(job, 0, false);
+	}
+
+	uint32_t JobSystem::getThreadCount() const {
+		return static_cast<uint32_t>(pImpl->queues.size());
+	}
+
+	uint32_t JobSystem::getCurrentThreadIndex() const {
+		return pImpl->getThreadIndex();
+	}
+
+	std::vector<WorkerStats> JobSystem::getStats() const {
+		double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - pImpl->statsStart).count();
+		std::vector<WorkerStats> stats;
+
+		for (const auto& queue : pImpl->queues) {
+			WorkerStats stat;
+			stat.jobsExecuted = queue->jobsExecuted.load();
+			stat.jobsStolen = queue->jobsStolen.load();
+			stat.busySeconds = queue->busyNanoseconds.load() / 1e9;
+			stat.utilization = wallSeconds > 0.0 ? std::min(stat.busySeconds / wallSeconds, 1.0) : 0.0;
+			stats.push_back(stat);
+		}
+
+		return stats;
+	}
+
+	void JobSystem::resetStats() {
+		for (auto& queue : pImpl->queues) {
+			queue->jobsExecuted = 0;
+			queue->jobsStolen = 0;
+			queue->busyNanoseconds = 0;
+		}
+
+		pImpl->statsStart = std::chrono::steady_clock::now();
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Cinder {
+	enum class JobAffinity : uint8_t {
+		eAny,
+		eMainThread //SDL and anything else that must stay on the thread that created the window
+	};
+
+	class JobCounter { //Counts unfinished jobs, other jobs can be made to wait on it reaching zero
+	public:
+		bool isDone() const {
+			return pending.load(std::memory_order_acquire) == 0;
+		}
+
+	private:
+		friend class JobSystem;
+
+		struct Continuation {
+			std::function<void()> function;
+			JobCounter* counter;
+			JobAffinity affinity;
+		};
+
+		std::atomic<uint32_t> pending{ 0 };
+		std::mutex continuationsMutex;
+		std::vector<Continuation> continuations;
+		std::exception_ptr error; //First exception thrown by one of its jobs, rethrown by JobSystem::wait
+	};
+
+	struct WorkerStats {
+		uint64_t jobsExecuted = 0;
+		uint64_t jobsStolen = 0; //Taken from another thread's deque
+		double busySeconds = 0.0;
+		double utilization = 0.0; //Busy time over wall time since the last resetStats
+	};
+
+	class JobSystem { //Work-stealing scheduler, every worker owns a deque and steals from the others' when it runs dry
+	public:
+		JobSystem(uint32_t workerCount = 0); //0 picks hardware_concurrency - 1, the main thread is always slot 0
+		~JobSystem();
+
+		void run(const std::function<void()>& job, JobCounter* counter = nullptr, JobAffinity affinity = JobAffinity::eAny);
+		void runAfter(JobCounter& dependency, const std::function<void()>& job, JobCounter* counter = nullptr, JobAffinity affinity = JobAffinity::eAny); //Queued once dependency reaches zero
+
+		void wait(JobCounter& counter); //Runs other jobs while waiting instead of blocking
+		void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& body); //Blocks until every range is done, the caller takes ranges too
+
+		void pumpMainThread(); //Runs queued eMainThread jobs, call once per main loop iteration
+
+		uint32_t getThreadCount() const; //Workers plus the main thread
+		uint32_t getCurrentThreadIndex() const; //0 on the main thread, UINT32_MAX on threads the system doesn't own
+
+		std::vector<WorkerStats> getStats() const; //Indexed like getCurrentThreadIndex
+		void resetStats();
+
+	private:
+		struct impl;
+		const std::unique_ptr<impl> pImpl;
+	};
+}
@@ -1,53 +1,180 @@
-//#include "vld.h"
-#include "VulkanCore.h"
-#include "Input.h"
-#include <SDL2/SDL_timer.h>
-#include <iostream>
-
-using namespace Cinder;
-
-int main(int argc, char* argv[]) {
-	auto vulkanCore = std::make_unique<VulkanCore>();
-
-	// Time Logic //
-	bool notN = false;
-	bool firstLoop = true;
-
-	const float timestep = 1000 / 144.0f; //TODO Change denominator to refresh rate of display
-	int timeLast = 0;
-	int timeCurrent = 0;
-	float deltaTime = 0.0f;
-	float accumulatedTime = 0.0f;
-	//            //
-
-	bool active = true; //Set this out here so we can control it from other classes with a pointer if needed
-	auto inputCore = std::make_unique<InputCore>(&active);
-
-	while (active) {
-		
-		// Game Loop Time Logic //
-		if (!notN) {
-			timeLast = SDL_GetTicks();
-			notN = !notN;
-			continue;
-		} else {
-			if (!firstLoop)
-				timeLast = timeCurrent;
-
-			timeCurrent = SDL_GetTicks();
-			deltaTime = (timeCurrent - timeLast) / 1000.0f;
-			accumulatedTime += deltaTime * 1000;
-			firstLoop = false; //idk if this needs to be set every time...
-		}
-		//                      //
-
-		while (accumulatedTime >= timestep) {
-			inputCore->tick();
-			accumulatedTime -= timestep;
-		}
-	}
-
-	std::cout << std::endl;
-
-	return 1;
-}
+//#include "vld.h"
+#include "VulkanCore.h"
+#include "Input.h"
+#include "JobSystem.h"
+#include "Tracer.h"
+#include "Camera.h"
+#include "FrameSnapshot.h"
+#include "RenderThread.h"
+#include "VulkanOffscreenTarget.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace Cinder;
+
+#ifndef CINDER_BENCHMARK //Benchmark.cpp has its own main
+int main(int argc, char* argv[]) {
+	CINDER_TRACE_THREAD_NAME("Main");
+	auto jobSystem = std::make_unique<JobSystem>(); //Before anything that might queue work, the constructing thread becomes the main thread
+	bool headless = false; //CI machines, no display and possibly only lavapipe
+	PresentPolicy presentPolicy = PresentPolicy::eLowLatency; //F10 cycles through them at runtime
+	uint64_t maxFrames = 0; //Exit once this many frames have rendered, 0 runs until quit
+	std::string screenshotPath, referencePath; //Headless only, the last frame is written to screenshotPath and compared against referencePath
+
+	for (int i = 1; i != argc; i++) {
+		std::string arg = argv[i];
+
+		if (arg == "--headless")
+			headless = true;
+		else if (arg == "--present=low-latency")
+			presentPolicy = PresentPolicy::eLowLatency;
+		else if (arg == "--present=max-throughput")
+			presentPolicy = PresentPolicy::eMaxThroughput;
+		else if (arg == "--present=power-saving")
+			presentPolicy = PresentPolicy::ePowerSaving;
+		else if (arg == "--frames" && i + 1 != argc)
+			maxFrames = std::strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--screenshot" && i + 1 != argc)
+			screenshotPath = argv[++i];
+		else if (arg == "--reference" && i + 1 != argc)
+			referencePath = argv[++i];
+		else
+			std::cerr << "Unknown argument " << arg << std::endl;
+	}
+
+	auto vulkanCore = headless ? std::make_unique<VulkanCore>(1920, 1080) : std::make_unique<VulkanCore>();
+	vulkanCore->setJobSystem(jobSystem.get());
+	vulkanCore->setPresentPolicy(presentPolicy); //Before initVulkan so the first swapchain is already right
+	vulkanCore->initVulkan();
+
+	bool captureLastFrame = !screenshotPath.empty() || !referencePath.empty();
+	if (captureLastFrame && !headless) {
+		std::cerr << "--screenshot and --reference need --headless, ignoring them" << std::endl;
+		captureLastFrame = false;
+	}
+
+	vulkanCore->setReadbackEnabled(captureLastFrame); //Before the render thread starts reading it
+
+	bool active = true; //Set this out here so we can control it from other classes with a pointer if needed
+	auto inputCore = std::make_unique<InputCore>(&active, vulkanCore.get());
+	auto renderThread = std::make_unique<RenderThread>(vulkanCore.get(), inputCore.get()); //Owns VulkanCore from here, this thread pumps SDL events and simulates
+
+	// Time Logic //
+	using Clock = std::chrono::steady_clock;
+
+	const std::chrono::nanoseconds simulationStep(1000000000 / 120); //Fixed, independent of how fast frames are rendered
+	const std::chrono::nanoseconds maxFrameTime = std::chrono::milliseconds(250); //A breakpoint or a hitch shouldn't queue hundreds of steps
+	const float stepSeconds = std::chrono::duration<float>(simulationStep).count();
+
+	Clock::time_point timeLast = Clock::now();
+	std::chrono::nanoseconds accumulatedTime(0);
+	uint64_t simulationSteps = 0;
+	//            //
+
+	Camera previousCamera, currentCamera;
+	std::vector<PointLight> lights;
+	std::vector<ShadowLight> shadowLights;
+
+	while (active) {
+		
+		// Game Loop Time Logic //
+		Clock::time_point timeCurrent = Clock::now();
+		accumulatedTime += std::min<std::chrono::nanoseconds>(timeCurrent - timeLast, maxFrameTime);
+		timeLast = timeCurrent;
+		//                      //
+
+		jobSystem->pumpMainThread();
+		renderThread->rethrowIfFailed();
+		inputCore->poll();
+
+		if (maxFrames != 0 && renderThread->getLatencyStats().frames >= maxFrames)
+			active = false;
+
+		Clock::time_point inputPolled;
+		int64_t mouseTotalX = 0, mouseTotalY = 0;
+		bool stepped = false;
+
+		while (accumulatedTime >= simulationStep) {
+			previousCamera = currentCamera;
+			inputPolled = Clock::now();
+			const InputState& input = inputCore->tick();
+			inputCore->driveCamera(currentCamera);
+			currentCamera.step(stepSeconds);
+			mouseTotalX = input.mouseTotalX;
+			mouseTotalY = input.mouseTotalY;
+
+			accumulatedTime -= simulationStep;
+			simulationSteps++;
+			stepped = true;
+		}
+
+		if (stepped) {
+			FrameSnapshot& snapshot = renderThread->beginSnapshot();
+			snapshot.simulationStep = simulationSteps;
+			snapshot.published = Clock::now();
+			snapshot.step = simulationStep;
+			snapshot.inputPolled = inputPolled;
+			snapshot.previousCamera = previousCamera;
+			snapshot.camera = currentCamera;
+			snapshot.mouseTotalX = mouseTotalX;
+			snapshot.mouseTotalY = mouseTotalY;
+			snapshot.lights = lights;
+			snapshot.shadowLights = shadowLights;
+			snapshot.refreshRate = headless ? 0 : vulkanCore->getDisplayRefreshRate(); //Asked every step, the window can move to another monitor
+			snapshot.window = vulkanCore->queryWindowState();
+			renderThread->publishSnapshot();
+		}
+
+		inputCore->waitForEvents(timeCurrent + (simulationStep - accumulatedTime)); //Until the next step is due or input arrives, so it's drained while the render thread can still use it
+	}
+
+	LatencyStats latency = renderThread->getLatencyStats();
+	renderThread.reset(); //Joined before vulkanCore is destroyed
+	std::cout << "Input to present latency over the last " << std::min<uint64_t>(latency.frames, RenderThread::LATENCY_WINDOW) << " frames: " << latency.averageMs << " ms average, " << latency.maxMs << " ms max" << std::endl;
+
+	std::cout << std::endl;
+
+	int exitCode = 0;
+	if (captureLastFrame) { //The render thread has joined, VulkanCore is back on this thread
+		std::vector<uint8_t> rgba;
+		vk::Extent2D extent = vulkanCore->getSwapchainExtent();
+
+		if (!vulkanCore->readbackLastFrame(rgba)) {
+			std::cerr << "No frame was rendered to read back" << std::endl;
+			return 1;
+		}
+
+		if (!screenshotPath.empty())
+			VulkanOffscreenTarget::writePPM(screenshotPath, rgba, extent);
+
+		if (!referencePath.empty()) {
+			std::vector<uint8_t> reference;
+			vk::Extent2D referenceExtent;
+			const uint8_t tolerance = 8; //Out of 255, room for rounding differences between drivers
+			const double maxDifferingFraction = 0.001;
+
+			if (!VulkanOffscreenTarget::readPPM(referencePath, reference, referenceExtent)) { //First run on a new machine or after an intended change, the caller commits it
+				VulkanOffscreenTarget::writePPM(referencePath, rgba, extent);
+				std::cout << "No reference image at " << referencePath << ", wrote this run's last frame there" << std::endl;
+			}
+			else if (referenceExtent != extent) {
+				std::cerr << "Reference image is " << referenceExtent.width << "x" << referenceExtent.height << ", the frame is " << extent.width << "x" << extent.height << std::endl;
+				exitCode = 1;
+			}
+			else {
+				double differing = VulkanOffscreenTarget::compareImages(rgba, reference, tolerance);
+				std::cout << "Reference comparison: " << differing * 100.0 << "% of pixels differ" << std::endl;
+
+				if (differing > maxDifferingFraction)
+					exitCode = 1;
+			}
+		}
+	}
+
+	return exitCode;
+}
+#endif
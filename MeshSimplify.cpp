@@ -0,0 +1,203 @@
+#include "MeshSimplify.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace CinderVk {
+	namespace MeshSimplify {
+		namespace {
+			struct CellKey {
+				int32_t x, y, z;
+				uint32_t normalBucket; //Dominant normal axis and sign, stops hard edges and back to back faces from welding
+
+				bool operator==(const CellKey& other) const {
+					return x == other.x && y == other.y && z == other.z && normalBucket == other.normalBucket;
+				}
+			};
+
+			struct CellKeyHash {
+				size_t operator()(const CellKey& key) const {
+					uint64_t h = static_cast<uint32_t>(key.x) * 0x9E3779B97F4A7C15ull;
+					h ^= (static_cast<uint32_t>(key.y) + 0x7F4A7C15ull + (h << 6) + (h >> 2)) * 0xBF58476D1CE4E5B9ull;
+					h ^= (static_cast<uint32_t>(key.z) + 0x94D049BBull + (h << 6) + (h >> 2)) * 0x94D049BB133111EBull;
+					return static_cast<size_t>(h ^ key.normalBucket);
+				}
+			};
+
+			struct TriangleKey {
+				std::array<uint32_t, 3> v;
+
+				bool operator==(const TriangleKey& other) const {
+					return v == other.v;
+				}
+			};
+
+			struct TriangleKeyHash {
+				size_t operator()(const TriangleKey& key) const {
+					uint64_t h = key.v[0] * 0x9E3779B97F4A7C15ull;
+					h ^= key.v[1] + 0x9E3779B9ull + (h << 6) + (h >> 2);
+					h ^= key.v[2] + 0x9E3779B9ull + (h << 6) + (h >> 2);
+					return static_cast<size_t>(h);
+				}
+			};
+
+			uint32_t getNormalBucket(const glm::vec3& normal) {
+				glm::vec3 a = glm::abs(normal);
+				uint32_t axis = (a.x >= a.y && a.x >= a.z) ? 0 : (a.y >= a.z ? 1 : 2);
+				return axis * 2 + (normal[axis] < 0.0f ? 1 : 0);
+			}
+
+			TriangleKey makeTriangleKey(uint32_t a, uint32_t b, uint32_t c) { //Rotated so the smallest index leads, winding is kept
+				if (b < a && b < c)
+					return { { b, c, a } };
+				if (c < a && c < b)
+					return { { c, a, b } };
+				return { { a, b, c } };
+			}
+		}
+
+		BoundingSphere computeBoundingSphere(const std::vector<Vertex>& verts) { //Box centre then the furthest vertex, a little loose but cheap and stable
+			BoundingSphere sphere{};
+			if (verts.empty())
+				return sphere;
+
+			glm::vec3 minPos = verts[0].pos, maxPos = verts[0].pos;
+			for (const auto& vert : verts) {
+				minPos = glm::min(minPos, vert.pos);
+				maxPos = glm::max(maxPos, vert.pos);
+			}
+
+			sphere.centre = (minPos + maxPos) * 0.5f;
+			for (const auto& vert : verts)
+				sphere.radius = std::max(sphere.radius, glm::length(vert.pos - sphere.centre));
+
+			return sphere;
+		}
+
+		std::vector<uint32_t> simplifyByClustering(const std::vector<Vertex>& verts, const std::vector<uint32_t>& indices, float cellSize, float& error) {
+			std::unordered_set<uint32_t> used(indices.begin(), indices.end()); //Only vertices this level still references
+			std::unordered_map<CellKey, std::vector<uint32_t>, CellKeyHash> cells;
+			cells.reserve(used.size());
+
+			float invCellSize = 1.0f / cellSize;
+			for (uint32_t index : used) {
+				const Vertex& vert = verts[index];
+				glm::vec3 cell = glm::floor(vert.pos * invCellSize);
+
+				CellKey key{ static_cast<int32_t>(cell.x), static_cast<int32_t>(cell.y), static_cast<int32_t>(cell.z), getNormalBucket(vert.normal) };
+				cells[key].push_back(index);
+			}
+
+			std::vector<uint32_t> remap(verts.size(), UINT32_MAX);
+			error = 0.0f;
+
+			for (auto& cell : cells) { //The vertex nearest the cell's average represents it, keeping its attributes
+				std::vector<uint32_t>& members = cell.second;
+				glm::vec3 average(0.0f);
+
+				for (uint32_t index : members)
+					average += verts[index].pos;
+				average /= static_cast<float>(members.size());
+
+				uint32_t representative = members[0];
+				float bestDistance = INFINITY;
+				for (uint32_t index : members) {
+					float distance = glm::length(verts[index].pos - average);
+					if (distance < bestDistance || (distance == bestDistance && index < representative)) { //Ties go to the lowest index so cooking is deterministic
+						bestDistance = distance;
+						representative = index;
+					}
+				}
+
+				for (uint32_t index : members) {
+					remap[index] = representative;
+					error = std::max(error, glm::length(verts[index].pos - verts[representative].pos));
+				}
+			}
+
+			std::vector<uint32_t> simplified;
+			std::unordered_set<TriangleKey, TriangleKeyHash> seen;
+			simplified.reserve(indices.size());
+
+			for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+				uint32_t a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+
+				if (a == b || b == c || a == c) //Collapsed into a line or point
+					continue;
+
+				if (!seen.insert(makeTriangleKey(a, b, c)).second)
+					continue;
+
+				simplified.push_back(a);
+				simplified.push_back(b);
+				simplified.push_back(c);
+			}
+
+			return simplified;
+		}
+
+		std::vector<MeshLod> generateLodChain(const std::vector<Vertex>& verts, std::vector<uint32_t>& indices, const LodOptions& options) {
+			CINDER_TRACE_SCOPE("MeshSimplify::generateLodChain");
+			std::vector<MeshLod> lods;
+			lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+
+			BoundingSphere sphere = computeBoundingSphere(verts);
+			uint32_t maxLods = std::min(options.maxLods, MAX_MESH_LODS);
+
+			if (sphere.radius <= 0.0f)
+				return lods;
+
+			float cellSize = sphere.radius / 64.0f;
+			std::vector<uint32_t> previous = indices;
+
+			while (lods.size() < maxLods && previous.size() / 3 > options.minTriangles) {
+				size_t targetIndexCount = static_cast<size_t>(previous.size() * (1.0f - options.minReduction));
+				std::vector<uint32_t> simplified;
+				float error = 0.0f;
+
+				while (cellSize < sphere.radius) { //Grow the cells until this level is worth its memory
+					simplified = simplifyByClustering(verts, previous, cellSize, error);
+					cellSize *= 2.0f;
+
+					if (simplified.size() <= targetIndexCount)
+						break;
+				}
+
+				if (simplified.empty() || simplified.size() > targetIndexCount)
+					break;
+
+				lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(simplified.size()), error + lods.back().error }); //Clustered from the previous level, so errors add up
+				indices.insert(indices.end(), simplified.begin(), simplified.end());
+				previous = std::move(simplified);
+			}
+
+			return lods;
+		}
+
+		uint32_t selectLod(const std::vector<MeshLod>& lods, float errorScale, const BoundingSphere& worldBounds, const glm::vec3& cameraPosition,
+			float projectionScale, float screenHeight, float maxPixelError, uint32_t currentLod) {
+			if (lods.size() < 2)
+				return 0;
+
+			float distance = glm::length(worldBounds.centre - cameraPosition) - worldBounds.radius; //Nearest point of the bounding sphere
+			if (distance <= 0.0f)
+				return 0;
+
+			float pixelsPerUnit = errorScale * std::abs(projectionScale) * screenHeight * 0.5f / distance;
+
+			uint32_t target = 0; //Coarsest level whose error stays under maxPixelError
+			while (target + 1 < lods.size() && lods[target + 1].error * pixelsPerUnit <= maxPixelError)
+				target++;
+
+			if (target > currentLod) { //Only drop detail once comfortably inside the coarser level's budget, stops popping back and forth on the boundary
+				while (target > currentLod && lods[target].error * pixelsPerUnit > maxPixelError * 0.75f)
+					target--;
+			}
+
+			return std::min(target, static_cast<uint32_t>(lods.size()) - 1);
+		}
+	}
+}
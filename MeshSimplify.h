@@ -0,0 +1,37 @@
+#pragma once
+#include "Vertex.h"
+#include "glm/glm.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace CinderVk {
+	constexpr uint32_t MAX_MESH_LODS = 6;
+
+	struct MeshLod { //A range of the model's shared index buffer, all LODs index the same vertex buffer
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		float error = 0.0f; //Worst case object space distance from the full detail surface
+	};
+
+	struct BoundingSphere {
+		glm::vec3 centre = glm::vec3(0.0f);
+		float radius = 0.0f;
+	};
+
+	namespace MeshSimplify {
+		struct LodOptions {
+			uint32_t maxLods = 4; //Including LOD 0, capped at MAX_MESH_LODS
+			float minReduction = 0.3f; //Stop once a level removes less than this fraction of the previous level's triangles
+			uint32_t minTriangles = 64; //No point simplifying below this
+		};
+
+		BoundingSphere computeBoundingSphere(const std::vector<Vertex>& verts);
+
+		std::vector<uint32_t> simplifyByClustering(const std::vector<Vertex>& verts, const std::vector<uint32_t>& indices, float cellSize, float& error); //Vertex clustering, representatives stay existing vertices so no new vertices are added
+
+		std::vector<MeshLod> generateLodChain(const std::vector<Vertex>& verts, std::vector<uint32_t>& indices, const LodOptions& options = {}); //Appends every coarser level to indices, LOD 0 is the original range
+
+		uint32_t selectLod(const std::vector<MeshLod>& lods, float errorScale, const BoundingSphere& worldBounds, const glm::vec3& cameraPosition,
+			float projectionScale, float screenHeight, float maxPixelError, uint32_t currentLod); //errorScale takes object space errors to world space, hysteresis against currentLod
+	}
+}
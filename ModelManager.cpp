@@ -1,5 +1,5 @@
-#include "ModelManager.h"
-
-
-
-
+#include "ModelManager.h"
+
+
+
+
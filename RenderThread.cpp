@@ -0,0 +1,157 @@
+#include "RenderThread.h"
+#include "FrameSnapshot.h"
+#include "VulkanCore.h"
+#include "Input.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace Cinder {
+	struct RenderThread::impl {
+		CinderVk::VulkanCore* core;
+		const InputCore* input;
+		TripleBuffer<FrameSnapshot> snapshots;
+		const FrameSnapshot* rendering = nullptr; //Render thread only, the snapshot tick is drawing
+
+		std::atomic<bool> stopping{ false };
+		std::atomic<bool> failed{ false };
+		std::exception_ptr error;
+
+		mutable std::mutex latencyMutex;
+		std::array<uint64_t, LATENCY_WINDOW> latencies{}; //Nanoseconds, ring indexed by frame count
+		uint64_t renderedFrames = 0;
+
+		std::thread thread;
+
+		impl(CinderVk::VulkanCore* coreRef, const InputCore* inputRef) : core(coreRef), input(inputRef) {
+			core->setBeforeRecordCallback([this]() { updateCamera(); });
+			thread = std::thread([this]() { run(); });
+		}
+
+		~impl() {
+			stopping.store(true, std::memory_order_relaxed);
+			if (thread.joinable())
+				thread.join();
+
+			core->setBeforeRecordCallback(nullptr);
+		}
+
+		void run() {
+			CINDER_TRACE_THREAD_NAME("Render");
+			std::chrono::steady_clock::time_point nextPresent = std::chrono::steady_clock::now();
+
+			try {
+				while (!stopping.load(std::memory_order_relaxed)) {
+					bool fresh = snapshots.consume();
+					const FrameSnapshot& snapshot = snapshots.getReadBuffer();
+
+					if (snapshot.simulationStep == 0) { //Nothing simulated yet
+						std::this_thread::sleep_for(std::chrono::milliseconds(1));
+						continue;
+					}
+
+					renderFrame(snapshot, fresh);
+					pace(snapshot.refreshRate, nextPresent);
+				}
+			}
+			catch (...) {
+				error = std::current_exception();
+				failed.store(true, std::memory_order_release);
+			}
+		}
+
+		void renderFrame(const FrameSnapshot& snapshot, bool fresh) {
+			CINDER_TRACE_SCOPE("RenderThread::renderFrame");
+
+			if (fresh) { //Unchanged between steps, not worth copying every frame
+				core->setLights(snapshot.lights);
+				core->setShadowLights(snapshot.shadowLights);
+			}
+
+			core->setWindowState(snapshot.window);
+
+			rendering = &snapshot;
+			core->tick(); //Calls updateCamera once it's about to record
+			rendering = nullptr;
+
+			uint64_t latency = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - snapshot.inputPolled).count()); //tick returns once present is queued, scanout comes after
+			std::lock_guard<std::mutex> lock(latencyMutex);
+			latencies[renderedFrames % LATENCY_WINDOW] = latency;
+			renderedFrames++;
+		}
+
+		void updateCamera() {
+			if (!rendering)
+				return;
+
+			const FrameSnapshot& snapshot = *rendering;
+			float alpha = std::min(std::chrono::duration<float>(std::chrono::steady_clock::now() - snapshot.published) / snapshot.step, 1.0f); //Rendered up to one step behind the simulation, held at the newest step if it stalls
+			Camera camera = Camera::interpolate(snapshot.previousCamera, snapshot.camera, alpha);
+
+			if (input) { //Look isn't interpolated, the newest step's orientation plus whatever the mouse did since
+				camera.yaw = snapshot.camera.yaw;
+				camera.pitch = snapshot.camera.pitch;
+				input->applyPendingLook(camera, snapshot.mouseTotalX, snapshot.mouseTotalY);
+			}
+
+			uint32_t width = core->getSwapchainExtentWidth(), height = core->getSwapchainExtentHeight();
+			float aspect = height ? static_cast<float>(width) / static_cast<float>(height) : 1.0f;
+			core->setCamera(camera.getView(), camera.getProjection(aspect), camera.zNear, camera.zFar);
+		}
+
+		void pace(uint32_t refreshRate, std::chrono::steady_clock::time_point& nextPresent) { //Sleeps instead of spinning, so the CPU doesn't run ahead and queue frames FIFO would only block on later
+			CinderVk::PresentPolicy policy = core->getPresentPolicy();
+			if (!refreshRate || policy == CinderVk::PresentPolicy::eMaxThroughput)
+				return;
+
+			const std::chrono::nanoseconds presentPeriod(policy == CinderVk::PresentPolicy::ePowerSaving ? 2000000000 / refreshRate : 1000000000 / refreshRate); //Every other vblank when saving power
+			nextPresent += presentPeriod;
+
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (nextPresent + presentPeriod < now) //More than a frame behind, don't try to catch up by skipping the sleep several times
+				nextPresent = now;
+			else
+				std::this_thread::sleep_until(nextPresent);
+		}
+	};
+
+	RenderThread::RenderThread(CinderVk::VulkanCore* core, const InputCore* input) : pImpl(std::make_unique<impl>(core, input)) {}
+	RenderThread::~RenderThread() {}
+
+	FrameSnapshot& RenderThread::beginSnapshot() {
+		return pImpl->snapshots.getWriteBuffer();
+	}
+
+	void RenderThread::publishSnapshot() {
+		pImpl->snapshots.publish();
+	}
+
+	void RenderThread::rethrowIfFailed() {
+		if (pImpl->failed.load(std::memory_order_acquire))
+			std::rethrow_exception(pImpl->error);
+	}
+
+	LatencyStats RenderThread::getLatencyStats() const {
+		std::lock_guard<std::mutex> lock(pImpl->latencyMutex);
+
+		LatencyStats stats;
+		stats.frames = pImpl->renderedFrames;
+
+		uint64_t count = std::min<uint64_t>(pImpl->renderedFrames, LATENCY_WINDOW);
+		if (count == 0)
+			return stats;
+
+		uint64_t total = 0, longest = 0;
+		for (uint64_t i = 0; i != count; i++) {
+			total += pImpl->latencies[i];
+			longest = std::max(longest, pImpl->latencies[i]);
+		}
+
+		stats.averageMs = total / static_cast<double>(count) / 1000000.0;
+		stats.maxMs = longest / 1000000.0;
+		return stats;
+	}
+}
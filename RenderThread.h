@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+
+namespace CinderVk {
+	class VulkanCore;
+}
+
+namespace Cinder {
+	struct FrameSnapshot;
+	class InputCore;
+
+	struct LatencyStats { //Input to present, over the last LATENCY_WINDOW rendered frames
+		double averageMs = 0.0;
+		double maxMs = 0.0;
+		uint64_t frames = 0; //Rendered since the thread started
+	};
+
+	class RenderThread { //Renders the newest published snapshot on its own thread while the simulation carries on, VulkanCore belongs to it between construction and destruction
+	public:
+		static constexpr uint32_t LATENCY_WINDOW = 128;
+
+		RenderThread(CinderVk::VulkanCore* core, const InputCore* input = nullptr); //After initVulkan, on the thread that created the window. With input, mouse look is sampled right before recording
+		~RenderThread(); //Joins, before the VulkanCore is destroyed
+
+		FrameSnapshot& beginSnapshot(); //Simulation thread only, fill every field then publishSnapshot
+		void publishSnapshot();
+
+		void rethrowIfFailed(); //Simulation thread, the render thread stops at its first exception and it is rethrown here
+		LatencyStats getLatencyStats() const;
+
+	private:
+		struct impl;
+		const std::unique_ptr<impl> pImpl;
+	};
+}
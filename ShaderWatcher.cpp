@@ -0,0 +1,277 @@
+#include "ShaderWatcher.h"
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <spawn.h>
+#include <sys/wait.h>
+extern char** environ;
+#endif
+
+namespace CinderVk {
+	struct ShaderWatcher::impl {
+		const std::filesystem::path directory;
+		const std::string compilerCommand;
+		const std::chrono::milliseconds settleTime{ 100 }; //Editors save in several writes, wait for quiet before compiling
+
+		std::atomic<bool> running{ true };
+		std::mutex changedMutex;
+		std::vector<std::string> changedShaders;
+		std::thread watchThread;
+
+#ifdef __linux__
+		int inotifyFd = -1;
+#else
+		std::unordered_map<std::string, std::filesystem::file_time_type> lastWriteTimes;
+#endif
+
+		impl(const std::string& dir, const std::string& compiler) : directory(dir), compilerCommand(compiler) {
+#ifdef __linux__
+			inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+			if (inotifyFd < 0 || inotify_add_watch(inotifyFd, directory.string().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+				throw std::runtime_error("Failed to watch the shader directory: " + directory.string());
+#else
+			scanDirectory(); //Record the starting times so nothing is reported on the first scan
+#endif
+			watchThread = std::thread([this]() { watchLoop(); });
+		}
+
+		~impl() {
+			running = false;
+			watchThread.join();
+
+#ifdef __linux__
+			close(inotifyFd);
+#endif
+		}
+
+		static bool isShaderSource(const std::filesystem::path& path) {
+			static const std::set<std::string> extensions = { ".vert", ".frag", ".comp", ".geom", ".tesc", ".tese" };
+			return extensions.count(path.extension().string()) != 0;
+		}
+
+		static std::vector<std::filesystem::path> readIncludes(const std::filesystem::path& path) { //#include "file" lines, resolved against the including file's directory like glslc does
+			std::vector<std::filesystem::path> includes;
+			std::ifstream file(path);
+			std::string line;
+
+			while (std::getline(file, line)) {
+				size_t start = line.find_first_not_of(" \t");
+				if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+					continue;
+
+				size_t open = line.find_first_of("\"<", start + 8);
+				if (open == std::string::npos)
+					continue;
+
+				size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+				if (close != std::string::npos)
+					includes.push_back((path.parent_path() / line.substr(open + 1, close - open - 1)).lexically_normal());
+			}
+
+			return includes;
+		}
+
+		static bool includesFile(const std::filesystem::path& sourcePath, const std::filesystem::path& includePath) { //Follows nested includes, each file is read once
+			std::set<std::filesystem::path> visited;
+			std::vector<std::filesystem::path> toRead = { sourcePath };
+
+			while (!toRead.empty()) {
+				std::filesystem::path current = toRead.back();
+				toRead.pop_back();
+
+				for (const auto& include : readIncludes(current)) {
+					if (include == includePath)
+						return true;
+
+					if (visited.insert(include).second)
+						toRead.push_back(include);
+				}
+			}
+
+			return false;
+		}
+
+		std::vector<std::filesystem::path> findDependentShaders(const std::filesystem::path& includePath) { //Re-read on every change, so edits to the include lines themselves are always picked up
+			std::vector<std::filesystem::path> dependents;
+			std::error_code error;
+
+			for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+				if (entry.is_regular_file() && isShaderSource(entry.path()) && includesFile(entry.path().lexically_normal(), includePath.lexically_normal()))
+					dependents.push_back(entry.path());
+			}
+
+			return dependents;
+		}
+
+		void watchLoop() {
+			std::set<std::string> pendingFiles;
+
+			while (running) {
+				bool sawEvent = waitForChanges(pendingFiles);
+
+				if (!sawEvent && !pendingFiles.empty()) { //A quiet period after some writes, handle them as one batch
+					std::set<std::filesystem::path> toCompile; //A shader and an include it uses saved together compile once
+
+					for (const auto& fileName : pendingFiles)
+						handleChangedFile(directory / fileName, toCompile);
+
+					for (const auto& sourcePath : toCompile)
+						compileShader(sourcePath);
+
+					pendingFiles.clear();
+				}
+			}
+		}
+
+#ifdef __linux__
+		bool waitForChanges(std::set<std::string>& pendingFiles) {
+			pollfd pfd{ inotifyFd, POLLIN, 0 };
+
+			if (poll(&pfd, 1, static_cast<int>(settleTime.count())) <= 0)
+				return false;
+
+			alignas(inotify_event) char buffer[4096];
+			ssize_t length;
+
+			while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+				for (char* ptr = buffer; ptr < buffer + length;) {
+					const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+
+					if (event->len > 0)
+						pendingFiles.insert(event->name);
+
+					ptr += sizeof(inotify_event) + event->len;
+				}
+			}
+
+			return true;
+		}
+#else
+		bool waitForChanges(std::set<std::string>& pendingFiles) { //No inotify, compare modification times
+			std::this_thread::sleep_for(settleTime);
+
+			std::vector<std::string> modified = scanDirectory();
+			pendingFiles.insert(modified.begin(), modified.end());
+
+			return !modified.empty();
+		}
+
+		std::vector<std::string> scanDirectory() {
+			std::vector<std::string> modified;
+			std::error_code error;
+
+			for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+				if (!entry.is_regular_file())
+					continue;
+
+				std::string fileName = entry.path().filename().string();
+				auto writeTime = entry.last_write_time(error);
+				auto it = lastWriteTimes.find(fileName);
+
+				if (it == lastWriteTimes.end() || it->second != writeTime) {
+					if (it != lastWriteTimes.end())
+						modified.push_back(fileName);
+
+					lastWriteTimes[fileName] = writeTime;
+				}
+			}
+
+			return modified;
+		}
+#endif
+
+		void handleChangedFile(const std::filesystem::path& path, std::set<std::filesystem::path>& toCompile) {
+			if (path.extension() == ".spv") {
+				std::lock_guard<std::mutex> lock(changedMutex);
+				changedShaders.push_back(path.string());
+			}
+			else if (isShaderSource(path)) {
+				toCompile.insert(path);
+			}
+			else if (path.extension() != ".tmp") { //Possibly an include, e.g. clusteredLights.glsl, rebuild every stage that pulls it in
+				for (const auto& sourcePath : findDependentShaders(path))
+					toCompile.insert(sourcePath);
+			}
+		}
+
+		bool runCompiler(const std::string& sourcePath, const std::string& outputPath) { //Runs the compiler directly with an argument list, file names never pass through a shell
+#if defined(_WIN32)
+			std::string quotedSource = "\"" + sourcePath + "\""; //_spawnvp joins the arguments into one command line, paths can't contain quotes on Windows
+			std::string quotedOutput = "\"" + outputPath + "\"";
+			const char* argv[] = { compilerCommand.c_str(), quotedSource.c_str(), "-o", quotedOutput.c_str(), nullptr };
+
+			return _spawnvp(_P_WAIT, compilerCommand.c_str(), argv) == 0;
+#else
+			std::vector<std::string> args = { compilerCommand, sourcePath, "-o", outputPath };
+			std::vector<char*> argv;
+			for (auto& arg : args)
+				argv.push_back(arg.data());
+			argv.push_back(nullptr);
+
+			pid_t pid;
+			if (posix_spawnp(&pid, compilerCommand.c_str(), nullptr, nullptr, argv.data(), environ) != 0)
+				return false;
+
+			int status = 0;
+			while (waitpid(pid, &status, 0) < 0) {
+				if (errno != EINTR)
+					return false;
+			}
+
+			return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#endif
+		}
+
+		void compileShader(const std::filesystem::path& sourcePath) { //vertexShader.vert -> vertexShader.spv, the rename is picked up as a SPIR-V change
+			std::filesystem::path outputPath = sourcePath;
+			outputPath.replace_extension(".spv");
+			std::filesystem::path tempPath = outputPath.string() + ".tmp";
+
+			if (!runCompiler(sourcePath.string(), tempPath.string())) {
+				std::cerr << "Shader compile failed, keeping the previous SPIR-V: " << sourcePath.string() << std::endl;
+				std::remove(tempPath.string().c_str());
+				return;
+			}
+
+			std::error_code error;
+			std::filesystem::rename(tempPath, outputPath, error); //Atomic, readers never see a half written module
+
+			if (error)
+				std::cerr << "Failed to replace " << outputPath.string() << ": " << error.message() << std::endl;
+		}
+	};
+
+	ShaderWatcher::ShaderWatcher(const std::string& directory, const std::string& compilerCommand) : pImpl(std::make_unique<impl>(directory, compilerCommand)) {}
+	ShaderWatcher::~ShaderWatcher() {}
+}
+
+namespace CinderVk {
+	std::vector<std::string> ShaderWatcher::takeChangedShaders() {
+		std::lock_guard<std::mutex> lock(pImpl->changedMutex);
+
+		std::vector<std::string> changed;
+		changed.swap(pImpl->changedShaders);
+
+		return changed;
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace CinderVk {
+	class ShaderWatcher { //Watches a directory on a background thread, recompiles changed GLSL (and the stages including a changed file) and reports SPIR-V ready to reload
+	public:
+		ShaderWatcher(const std::string& directory = ".", const std::string& compilerCommand = "glslc"); //compilerCommand is a single executable, looked up on PATH and run as <compiler> <source> -o <output>
+		~ShaderWatcher();
+
+		std::vector<std::string> takeChangedShaders(); //SPIR-V paths written since the last call, poll once per frame
+	private:
+		struct impl;
+		const std::unique_ptr<impl> pImpl;
+	};
+}
@@ -0,0 +1,397 @@
+#include "TextureDecode.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+namespace CinderVk {
+	namespace TextureDecode {
+		namespace {
+			struct StagingTarget { //stb_image has no decode-into-buffer call, so its allocator hands out the staging slice instead
+				uint8_t* pointer = nullptr;
+				size_t size = 0; //The image in the file's own channel count
+				size_t capacity = 0; //Up to the end of the image's staging slice
+				bool claimed = false;
+			};
+
+			thread_local StagingTarget stagingTarget;
+
+			void* stagingMalloc(size_t size) { //The first live allocation of the decoded size is the output image, or one byte more for stbi__malloc_mad3's JPEG output
+				if (stagingTarget.pointer && !stagingTarget.claimed && (size == stagingTarget.size || size == stagingTarget.size + 1) && size <= stagingTarget.capacity) {
+					stagingTarget.claimed = true;
+					return stagingTarget.pointer;
+				}
+
+				return std::malloc(size);
+			}
+
+			void stagingFree(void* pointer) {
+				if (pointer && pointer == stagingTarget.pointer) {
+					stagingTarget.claimed = false; //A same sized scratch buffer got there first, the real output can still claim it
+					return;
+				}
+
+				std::free(pointer);
+			}
+
+			void* stagingRealloc(void* pointer, size_t size) {
+				if (!pointer || pointer != stagingTarget.pointer)
+					return std::realloc(pointer, size);
+
+				if (size <= stagingTarget.capacity)
+					return pointer;
+
+				void* grown = std::malloc(size);
+				if (grown) {
+					memcpy(grown, pointer, stagingTarget.size);
+					stagingTarget.claimed = false;
+				}
+
+				return grown;
+			}
+		}
+	}
+}
+
+#define STBI_MALLOC(size) CinderVk::TextureDecode::stagingMalloc(size)
+#define STBI_REALLOC(pointer, size) CinderVk::TextureDecode::stagingRealloc(pointer, size)
+#define STBI_FREE(pointer) CinderVk::TextureDecode::stagingFree(pointer)
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CINDER_DECODE_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#define CINDER_DECODE_SSSE3
+#include <tmmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CINDER_DECODE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace CinderVk {
+	namespace TextureDecode {
+		namespace {
+			uint32_t resolveThreadCount(uint32_t requested, size_t jobCount) {
+				uint32_t threads = requested != 0 ? requested : std::max(1u, std::thread::hardware_concurrency());
+				return static_cast<uint32_t>(std::min<size_t>(threads, std::max<size_t>(jobCount, 1)));
+			}
+
+			void runParallel(size_t jobCount, uint32_t threadCount, const std::function<void(size_t)>& job) { //Workers pull the next image index until none are left
+				std::atomic<size_t> nextJob{ 0 };
+				std::exception_ptr firstError = nullptr;
+				std::atomic<bool> failed{ false };
+
+				auto worker = [&]() {
+					for (size_t i = nextJob++; i < jobCount && !failed; i = nextJob++) {
+						try {
+							job(i);
+						}
+						catch (...) {
+							if (!failed.exchange(true))
+								firstError = std::current_exception();
+						}
+					}
+				};
+
+				std::vector<std::thread> workers;
+				for (uint32_t t = 1; t < threadCount; t++)
+					workers.emplace_back(worker);
+
+				worker(); //The calling thread does its share too
+
+				for (auto& thread : workers)
+					thread.join();
+
+				if (firstError)
+					std::rethrow_exception(firstError);
+			}
+
+			struct SrgbTables {
+				float toLinear[256];
+				uint8_t toSrgb[4096]; //Indexed by linear value * 4095
+
+				SrgbTables() {
+					for (int i = 0; i != 256; i++) {
+						float c = i / 255.0f;
+						toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+					}
+
+					for (int i = 0; i != 4096; i++) {
+						float l = i / 4095.0f;
+						float s = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+						toSrgb[i] = static_cast<uint8_t>(std::clamp(s * 255.0f + 0.5f, 0.0f, 255.0f));
+					}
+				}
+			};
+
+			const SrgbTables& getSrgbTables() {
+				static const SrgbTables tables;
+				return tables;
+			}
+
+			inline uint8_t mulDiv255(uint32_t c, uint32_t a) { //Exact round(c * a / 255)
+				uint32_t x = c * a + 128;
+				return static_cast<uint8_t>((x + (x >> 8)) >> 8);
+			}
+
+			void decodeImage(const ImageInfo& info, uint8_t* dst, const DecodeOptions& options) {
+				size_t pixelCount = static_cast<size_t>(info.width) * static_cast<size_t>(info.height);
+				uint8_t* packed = dst + pixelCount * (4 - info.channels); //Native channels land at the end of the slice, then expand forwards in place
+
+				stagingTarget = { packed, pixelCount * info.channels, info.getStagingSize() - pixelCount * (4 - info.channels), false };
+				int width, height, channels;
+				stbi_uc* pixels = stbi_load(info.path.c_str(), &width, &height, &channels, 0);
+				stagingTarget = {};
+
+				if (!pixels)
+					throw std::runtime_error("Failed to load the texture image of: " + info.path);
+
+				if (width != info.width || height != info.height || channels != info.channels) {
+					if (pixels != packed)
+						stbi_image_free(pixels);
+
+					throw std::runtime_error("Texture image changed after its header was read: " + info.path);
+				}
+
+				if (pixels != packed) { //Formats stb_image converts after decoding, e.g. 16 bit PNGs, still cost a copy
+					expandToRGBA(pixels, dst, pixelCount, channels);
+					stbi_image_free(pixels);
+				}
+				else if (channels != 4)
+					expandToRGBA(packed, dst, pixelCount, channels); //Every write stays behind the reads it depends on
+
+				if (options.premultiplyAlpha && (channels == 2 || channels == 4)) {
+					if (options.srgb)
+						premultiplyAlphaSrgb(dst, pixelCount);
+					else
+						premultiplyAlphaLinear(dst, pixelCount);
+				}
+			}
+		}
+
+		std::vector<ImageInfo> queryImages(const std::vector<std::string>& paths, size_t offsetAlignment) {
+			CINDER_TRACE_SCOPE("TextureDecode::queryImages");
+			std::vector<ImageInfo> images(paths.size());
+			size_t offset = 0;
+
+			for (size_t i = 0; i != paths.size(); i++) {
+				ImageInfo& info = images[i];
+				info.path = paths[i];
+
+				if (!stbi_info(info.path.c_str(), &info.width, &info.height, &info.channels))
+					throw std::runtime_error("Failed to read the texture header of: " + info.path);
+
+				offset = (offset + offsetAlignment - 1) / offsetAlignment * offsetAlignment;
+				info.stagingOffset = offset;
+				offset += info.getStagingSize();
+			}
+
+			return images;
+		}
+
+		size_t getTotalStagingSize(const std::vector<ImageInfo>& images) {
+			if (images.empty())
+				return 0;
+
+			return images.back().stagingOffset + images.back().getStagingSize();
+		}
+
+		void decodeInto(const std::vector<ImageInfo>& images, uint8_t* staging, const DecodeOptions& options) {
+			CINDER_TRACE_SCOPE("TextureDecode::decodeInto");
+			runParallel(images.size(), resolveThreadCount(options.threadCount, images.size()), [&](size_t i) {
+				CINDER_TRACE_SCOPE("TextureDecode::decodeImage");
+				decodeImage(images[i], staging + images[i].stagingOffset, options);
+			});
+		}
+
+		void expandToRGBA(const uint8_t* src, uint8_t* dst, size_t pixelCount, int srcChannels) {
+			switch (srcChannels) {
+			case 4:
+				memcpy(dst, src, pixelCount * 4);
+				break;
+			case 3:
+				expandRGBToRGBA(src, dst, pixelCount);
+				break;
+			case 2:
+				for (size_t i = 0; i != pixelCount; i++) {
+					dst[i * 4 + 0] = dst[i * 4 + 1] = dst[i * 4 + 2] = src[i * 2];
+					dst[i * 4 + 3] = src[i * 2 + 1];
+				}
+				break;
+			case 1:
+				for (size_t i = 0; i != pixelCount; i++) {
+					dst[i * 4 + 0] = dst[i * 4 + 1] = dst[i * 4 + 2] = src[i];
+					dst[i * 4 + 3] = 255;
+				}
+				break;
+			default:
+				throw std::invalid_argument("Unsupported texture channel count.");
+			}
+		}
+
+		void expandRGBToRGBA(const uint8_t* src, uint8_t* dst, size_t pixelCount) {
+			size_t i = 0;
+
+#if defined(CINDER_DECODE_SSSE3)
+			const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+			const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+			for (; i + 16 <= pixelCount; i += 16) { //48 bytes in, 64 bytes out
+				const uint8_t* s = src + i * 3;
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+				__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+
+				__m128i* d = reinterpret_cast<__m128i*>(dst + i * 4);
+				_mm_storeu_si128(d + 0, _mm_or_si128(_mm_shuffle_epi8(a, shuffle), alpha));
+				_mm_storeu_si128(d + 1, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), shuffle), alpha));
+				_mm_storeu_si128(d + 2, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), shuffle), alpha));
+				_mm_storeu_si128(d + 3, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(c, 4), shuffle), alpha));
+			}
+#elif defined(CINDER_DECODE_NEON)
+			for (; i + 16 <= pixelCount; i += 16) {
+				uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+				uint8x16x4_t rgba;
+				rgba.val[0] = rgb.val[0];
+				rgba.val[1] = rgb.val[1];
+				rgba.val[2] = rgb.val[2];
+				rgba.val[3] = vdupq_n_u8(255);
+				vst4q_u8(dst + i * 4, rgba);
+			}
+#endif
+
+			for (; i != pixelCount; i++) {
+				dst[i * 4 + 0] = src[i * 3 + 0];
+				dst[i * 4 + 1] = src[i * 3 + 1];
+				dst[i * 4 + 2] = src[i * 3 + 2];
+				dst[i * 4 + 3] = 255;
+			}
+		}
+
+		void premultiplyAlphaLinear(uint8_t* rgba, size_t pixelCount) {
+			size_t i = 0;
+
+#if defined(CINDER_DECODE_SSE2)
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i bias = _mm_set1_epi16(128);
+			const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+			for (; i + 4 <= pixelCount; i += 4) {
+				__m128i* p = reinterpret_cast<__m128i*>(rgba + i * 4);
+				__m128i px = _mm_loadu_si128(p);
+
+				__m128i lo = _mm_unpacklo_epi8(px, zero);
+				__m128i hi = _mm_unpackhi_epi8(px, zero);
+				__m128i alphaLo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+				__m128i alphaHi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+				lo = _mm_add_epi16(_mm_mullo_epi16(lo, alphaLo), bias);
+				hi = _mm_add_epi16(_mm_mullo_epi16(hi, alphaHi), bias);
+				lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+				hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+				__m128i result = _mm_packus_epi16(lo, hi);
+				_mm_storeu_si128(p, _mm_or_si128(_mm_andnot_si128(alphaMask, result), _mm_and_si128(px, alphaMask)));
+			}
+#endif
+
+			for (; i != pixelCount; i++) {
+				uint8_t* p = rgba + i * 4;
+				p[0] = mulDiv255(p[0], p[3]);
+				p[1] = mulDiv255(p[1], p[3]);
+				p[2] = mulDiv255(p[2], p[3]);
+			}
+		}
+
+		void premultiplyAlphaSrgb(uint8_t* rgba, size_t pixelCount) { //Decode to linear, scale by alpha, re-encode so dark fringes don't appear on blended edges
+			const SrgbTables& tables = getSrgbTables();
+			size_t i = 0;
+
+#if defined(CINDER_DECODE_SSE2)
+			const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+			const __m128 alphaScale = _mm_set1_ps(4095.0f / 255.0f);
+			const __m128 half = _mm_set1_ps(0.5f);
+
+			for (; i + 4 <= pixelCount; i += 4) { //Four pixels a channel per register. SSE2 has no gather, so only the table lookups stay scalar
+				uint8_t* p = rgba + i * 4;
+				__m128i px = _mm_loadu_si128(reinterpret_cast<__m128i*>(p));
+				__m128i alpha = _mm_and_si128(px, alphaMask);
+
+				if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alphaMask)) == 0xFFFF) //Opaque, the common case, left as is
+					continue;
+
+				if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, _mm_setzero_si128())) == 0xFFFF) { //Fully transparent premultiplies to zero
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_setzero_si128());
+					continue;
+				}
+
+				__m128 a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(px, 24)), alphaScale);
+				alignas(16) int32_t index[3][4];
+
+				for (int c = 0; c != 3; c++) {
+					__m128 linear = _mm_setr_ps(tables.toLinear[p[c]], tables.toLinear[p[4 + c]], tables.toLinear[p[8 + c]], tables.toLinear[p[12 + c]]);
+					_mm_store_si128(reinterpret_cast<__m128i*>(index[c]), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(linear, a), half))); //Same operations as the scalar loop, so the results match it exactly
+				}
+
+				for (int k = 0; k != 4; k++) {
+					if (p[k * 4 + 3] == 255)
+						continue;
+
+					for (int c = 0; c != 3; c++)
+						p[k * 4 + c] = tables.toSrgb[index[c][k]];
+				}
+			}
+#endif
+
+			for (; i != pixelCount; i++) {
+				uint8_t* p = rgba + i * 4;
+
+				if (p[3] == 255)
+					continue;
+
+				float alpha = p[3] * (4095.0f / 255.0f);
+				for (int c = 0; c != 3; c++)
+					p[c] = tables.toSrgb[static_cast<int>(tables.toLinear[p[c]] * alpha + 0.5f)];
+			}
+		}
+
+		std::vector<BenchmarkResult> benchmarkDecode(const std::vector<std::string>& paths, const std::vector<uint32_t>& threadCounts, uint32_t iterations) {
+			std::vector<ImageInfo> images = queryImages(paths);
+			std::vector<uint8_t> staging(getTotalStagingSize(images));
+			std::vector<BenchmarkResult> results;
+
+			size_t decodedBytes = 0;
+			for (const auto& image : images)
+				decodedBytes += image.getDecodedSize();
+
+			decodeInto(images, staging.data(), { 1 }); //Warm the file cache so the first thread count isn't measuring the disk
+
+			for (uint32_t threadCount : threadCounts) {
+				DecodeOptions options{};
+				options.threadCount = threadCount;
+
+				auto start = std::chrono::steady_clock::now();
+				for (uint32_t i = 0; i != iterations; i++)
+					decodeInto(images, staging.data(), options);
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+				results.push_back({ resolveThreadCount(threadCount, images.size()), seconds / iterations, (decodedBytes * iterations) / (seconds * 1024.0 * 1024.0) });
+			}
+
+			return results;
+		}
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace CinderVk {
+	namespace TextureDecode {
+		struct ImageInfo { //Filled from the file header only, before any pixel data is decoded
+			std::string path;
+			int width = 0;
+			int height = 0;
+			int channels = 0; //Channels stored in the file, output is always RGBA8
+			size_t stagingOffset = 0; //Where this image's RGBA8 pixels start inside the shared staging block
+
+			size_t getDecodedSize() const {
+				return static_cast<size_t>(width) * static_cast<size_t>(height) * 4;
+			}
+
+			size_t getStagingSize() const { //One byte of slack past the pixels, stb_image allocates its JPEG output a byte larger than the image
+				return getDecodedSize() + 1;
+			}
+		};
+
+		struct DecodeOptions {
+			uint32_t threadCount = 0; //0 picks std::thread::hardware_concurrency()
+			bool premultiplyAlpha = false;
+			bool srgb = true; //Premultiply in linear space for sRGB encoded maps
+		};
+
+		struct BenchmarkResult {
+			uint32_t threadCount;
+			double seconds;
+			double megabytesPerSecond; //Decoded RGBA8 bytes per second
+		};
+
+		std::vector<ImageInfo> queryImages(const std::vector<std::string>& paths, size_t offsetAlignment = 16);
+		size_t getTotalStagingSize(const std::vector<ImageInfo>& images);
+
+		void decodeInto(const std::vector<ImageInfo>& images, uint8_t* staging, const DecodeOptions& options = {});
+
+		void expandToRGBA(const uint8_t* src, uint8_t* dst, size_t pixelCount, int srcChannels);
+		void expandRGBToRGBA(const uint8_t* src, uint8_t* dst, size_t pixelCount);
+		void premultiplyAlphaLinear(uint8_t* rgba, size_t pixelCount);
+		void premultiplyAlphaSrgb(uint8_t* rgba, size_t pixelCount);
+
+		std::vector<BenchmarkResult> benchmarkDecode(const std::vector<std::string>& paths, const std::vector<uint32_t>& threadCounts = { 1, 4, 0 }, uint32_t iterations = 3); //0 is all hardware threads
+	}
+}
@@ -0,0 +1,183 @@
+#include "Tracer.h"
+
+#ifdef CINDER_TRACING
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace Cinder {
+	namespace Tracer {
+		namespace {
+			struct TraceEvent { //Relaxed atomics so a dump racing the owning thread reads stale values instead of undefined ones
+				std::atomic<const char*> name{ nullptr };
+				std::atomic<uint64_t> start{ 0 };
+				std::atomic<uint64_t> end{ 0 };
+			};
+
+			struct ThreadBuffer {
+				uint32_t id;
+				std::string name; //Guarded by registryMutex
+				std::atomic<uint64_t> written{ 0 }; //Total ever recorded, the ring index is this modulo EVENTS_PER_THREAD
+				std::array<TraceEvent, EVENTS_PER_THREAD> events;
+			};
+
+			struct GpuEvent {
+				std::string name;
+				uint64_t start, end;
+			};
+
+			std::mutex registryMutex;
+			std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers; //Never freed, a thread that exits still shows up in the next dump
+			std::unordered_set<std::string> internedNames;
+			std::deque<GpuEvent> gpuEvents; //Newest GPU_EVENTS, also guarded by registryMutex
+
+			thread_local ThreadBuffer* currentBuffer = nullptr;
+
+			ThreadBuffer& getThreadBuffer() {
+				if (!currentBuffer) {
+					std::lock_guard<std::mutex> lock(registryMutex);
+					threadBuffers.push_back(std::make_unique<ThreadBuffer>());
+					currentBuffer = threadBuffers.back().get();
+					currentBuffer->id = static_cast<uint32_t>(threadBuffers.size() - 1);
+					currentBuffer->name = currentBuffer->id == 0 ? "Main" : "Thread " + std::to_string(currentBuffer->id); //The first thread to trace is almost always main
+				}
+
+				return *currentBuffer;
+			}
+
+			void writeEscaped(std::ostream& out, const std::string& text) {
+				for (char c : text) {
+					if (c == '"' || c == '\\')
+						out << '\\' << c;
+					else if (static_cast<unsigned char>(c) >= 0x20)
+						out << c;
+				}
+			}
+
+			void writeEvent(std::ostream& out, bool& first, const std::string& name, uint32_t pid, uint32_t tid, uint64_t startNs, uint64_t endNs, uint64_t originNs) {
+				out << (first ? "\n" : ",\n") << "{\"name\":\"";
+				writeEscaped(out, name);
+				out << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << tid
+					<< ",\"ts\":" << (startNs - originNs) / 1000.0 << ",\"dur\":" << (endNs - startNs) / 1000.0 << "}"; //Microseconds
+				first = false;
+			}
+
+			void writeMetadata(std::ostream& out, bool& first, const char* kind, uint32_t pid, uint32_t tid, const std::string& name) {
+				out << (first ? "\n" : ",\n") << "{\"name\":\"" << kind << "\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid << ",\"args\":{\"name\":\"";
+				writeEscaped(out, name);
+				out << "\"}}";
+				first = false;
+			}
+		}
+
+		uint64_t now() {
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+		}
+
+		void record(const char* name, uint64_t startNs, uint64_t endNs) {
+			ThreadBuffer& buffer = getThreadBuffer();
+			uint64_t index = buffer.written.load(std::memory_order_relaxed);
+			TraceEvent& event = buffer.events[index % EVENTS_PER_THREAD];
+
+			event.name.store(name, std::memory_order_relaxed);
+			event.start.store(startNs, std::memory_order_relaxed);
+			event.end.store(endNs, std::memory_order_relaxed);
+			buffer.written.store(index + 1, std::memory_order_release);
+		}
+
+		void recordGpuEvent(const std::string& name, uint64_t startNs, uint64_t endNs) {
+			std::lock_guard<std::mutex> lock(registryMutex);
+			gpuEvents.push_back({ name, startNs, endNs });
+
+			if (gpuEvents.size() > GPU_EVENTS)
+				gpuEvents.pop_front();
+		}
+
+		const char* intern(const std::string& name) {
+			std::lock_guard<std::mutex> lock(registryMutex);
+			return internedNames.insert(name).first->c_str(); //Node based, the pointer stays valid as the set grows
+		}
+
+		void setThreadName(const std::string& name) {
+			ThreadBuffer& buffer = getThreadBuffer();
+			std::lock_guard<std::mutex> lock(registryMutex);
+			buffer.name = name;
+		}
+
+		bool writeChromeTrace(const std::string& path) {
+			struct CopiedEvent {
+				const char* name;
+				uint64_t start, end;
+				uint32_t tid;
+			};
+
+			std::vector<CopiedEvent> cpuEvents;
+			std::vector<std::pair<uint32_t, std::string>> threadNames;
+			std::vector<GpuEvent> gpuCopy;
+
+			{
+				std::lock_guard<std::mutex> lock(registryMutex); //Keeps threads from registering, the owners keep recording
+
+				for (const auto& buffer : threadBuffers) {
+					uint64_t end = buffer->written.load(std::memory_order_acquire);
+					uint64_t begin = end > EVENTS_PER_THREAD ? end - EVENTS_PER_THREAD : 0;
+					size_t firstCopied = cpuEvents.size();
+
+					for (uint64_t i = begin; i != end; i++) {
+						const TraceEvent& event = buffer->events[i % EVENTS_PER_THREAD];
+						cpuEvents.push_back({ event.name.load(std::memory_order_relaxed), event.start.load(std::memory_order_relaxed), event.end.load(std::memory_order_relaxed), buffer->id });
+					}
+
+					uint64_t lapped = buffer->written.load(std::memory_order_acquire) + 1; //Anything the owner lapped while we copied may be half new, half old, plus the slot it may be writing now
+					if (lapped > begin + EVENTS_PER_THREAD) {
+						size_t stale = static_cast<size_t>(std::min(lapped - begin - EVENTS_PER_THREAD, end - begin));
+						cpuEvents.erase(cpuEvents.begin() + firstCopied, cpuEvents.begin() + firstCopied + stale);
+					}
+
+					threadNames.push_back({ buffer->id, buffer->name });
+				}
+
+				gpuCopy.assign(gpuEvents.begin(), gpuEvents.end());
+			}
+
+			uint64_t origin = UINT64_MAX;
+			for (const auto& event : cpuEvents)
+				origin = std::min(origin, event.start);
+			for (const auto& event : gpuCopy)
+				origin = std::min(origin, event.start);
+
+			std::ofstream file(path);
+			if (!file)
+				return false;
+
+			bool first = true;
+			file << std::fixed;
+			file.precision(3);
+			file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+			writeMetadata(file, first, "process_name", 1, 0, "CPU");
+			writeMetadata(file, first, "process_name", 2, 0, "GPU");
+			writeMetadata(file, first, "thread_name", 2, 0, "Graphics queue");
+
+			for (const auto& thread : threadNames)
+				writeMetadata(file, first, "thread_name", 1, thread.first, thread.second);
+
+			for (const auto& event : cpuEvents)
+				writeEvent(file, first, event.name, 1, event.tid, event.start, event.end, origin);
+
+			for (const auto& event : gpuCopy)
+				writeEvent(file, first, event.name, 2, 0, event.start, event.end, origin);
+
+			file << "\n]}\n";
+			return static_cast<bool>(file);
+		}
+	}
+}
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+//On in debug builds, define CINDER_TRACING to keep it in a release build. Without it every macro below expands to nothing
+#if !defined(NDEBUG) && !defined(CINDER_TRACING)
+#define CINDER_TRACING
+#endif
+
+#ifdef CINDER_TRACING
+#define CINDER_TRACE_CONCAT_INNER(a, b) a##b
+#define CINDER_TRACE_CONCAT(a, b) CINDER_TRACE_CONCAT_INNER(a, b)
+#define CINDER_TRACE_SCOPE(name) Cinder::TraceScope CINDER_TRACE_CONCAT(traceScope, __COUNTER__)(name) //name must be a string literal, only the pointer is kept
+#define CINDER_TRACE_SCOPE_DYNAMIC(name) Cinder::TraceScope CINDER_TRACE_CONCAT(traceScope, __COUNTER__)(Cinder::Tracer::intern(name)) //Any std::string, costs a locked lookup
+#define CINDER_TRACE_THREAD_NAME(name) Cinder::Tracer::setThreadName(name)
+#define CINDER_TRACE_DUMP(path) Cinder::Tracer::writeChromeTrace(path)
+#else
+#define CINDER_TRACE_SCOPE(name)
+#define CINDER_TRACE_SCOPE_DYNAMIC(name)
+#define CINDER_TRACE_THREAD_NAME(name)
+#define CINDER_TRACE_DUMP(path)
+#endif
+
+#ifdef CINDER_TRACING
+namespace Cinder {
+	namespace Tracer { //Per-thread ring buffers of completed scopes, the newest EVENTS_PER_THREAD of each thread survive until a dump
+		constexpr uint32_t EVENTS_PER_THREAD = 1 << 16;
+		constexpr uint32_t GPU_EVENTS = 1 << 14;
+
+		uint64_t now(); //Nanoseconds on steady_clock, the clock every CPU and GPU event is placed on
+
+		void record(const char* name, uint64_t startNs, uint64_t endNs); //Lock-free, the calling thread's buffer only
+		void recordGpuEvent(const std::string& name, uint64_t startNs, uint64_t endNs); //Locked, once per scope per frame from the GPU profiler
+		const char* intern(const std::string& name); //Stable pointer for names that don't outlive their scope, e.g. render graph passes
+
+		void setThreadName(const std::string& name); //Shown on the thread's track
+		bool writeChromeTrace(const std::string& path); //chrome://tracing and ui.perfetto.dev both open it, false if the file couldn't be written
+	}
+
+	class TraceScope {
+	public:
+		TraceScope(const char* scopeName) : name(scopeName), start(Tracer::now()) {}
+
+		~TraceScope() {
+			Tracer::record(name, start, Tracer::now());
+		}
+
+	private:
+		const char* name;
+		uint64_t start;
+	};
+}
+#endif
@@ -1,66 +1,87 @@
-#pragma once
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
-#include <glm/glm.hpp>
-#include <vulkan/vulkan.hpp>
-#include <array>
-
-namespace CinderVk {
-	struct Vertex {
-		glm::vec3 pos;
-		glm::vec3 colour;
-		glm::vec2 texCoord;
-		glm::vec3 normal;
-
-		static vk::VertexInputBindingDescription getBindingDescription() {
-			vk::VertexInputBindingDescription bindingDescription{};
-
-			bindingDescription.binding = 0;
-			bindingDescription.stride = sizeof(Vertex);
-			bindingDescription.inputRate = vk::VertexInputRate::eVertex;
-
-			return bindingDescription;
-		}
-
-		static std::array<vk::VertexInputAttributeDescription, 4> getAttributeDescriptions() {
-			std::array<vk::VertexInputAttributeDescription, 4> attributeDescriptions{};
-
-			attributeDescriptions[0].binding = 0;
-			attributeDescriptions[0].location = 0;
-			attributeDescriptions[0].format = vk::Format::eR32G32B32Sfloat;
-			attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-			attributeDescriptions[1].binding = 0;
-			attributeDescriptions[1].location = 1;
-			attributeDescriptions[1].format = vk::Format::eR32G32B32Sfloat;
-			attributeDescriptions[1].offset = offsetof(Vertex, colour);
-
-			attributeDescriptions[2].binding = 0;
-			attributeDescriptions[2].location = 2;
-			attributeDescriptions[2].format = vk::Format::eR32G32Sfloat;
-			attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
-
-			attributeDescriptions[3].binding = 0;
-			attributeDescriptions[3].location = 3;
-			attributeDescriptions[3].format = vk::Format::eR32G32B32Sfloat;
-			attributeDescriptions[3].offset = offsetof(Vertex, normal);
-
-			return attributeDescriptions;
-		}
-
-		bool operator==(const Vertex& other) const {
-			return pos == other.pos && colour == other.colour && texCoord == other.texCoord;
-		}
-
-	};
-}
-
-namespace std {
-	template<> struct hash<CinderVk::Vertex> {
-		size_t operator()(CinderVk::Vertex const& vertex) const {
-			return ((hash<glm::vec3>()(vertex.pos) ^
-				(hash<glm::vec3>()(vertex.colour) << 1)) >> 1) ^
-				(hash < glm::vec2>()(vertex.texCoord) << 1);
-		}
-	};
+#pragma once
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+#include <array>
+
+namespace CinderVk {
+	struct Vertex {
+		glm::vec3 pos;
+		glm::vec3 colour;
+		glm::vec2 texCoord;
+		glm::vec3 normal;
+
+		static vk::VertexInputBindingDescription getBindingDescription() {
+			vk::VertexInputBindingDescription bindingDescription{};
+
+			bindingDescription.binding = 0;
+			bindingDescription.stride = sizeof(Vertex);
+			bindingDescription.inputRate = vk::VertexInputRate::eVertex;
+
+			return bindingDescription;
+		}
+
+		static std::array<vk::VertexInputAttributeDescription, 4> getAttributeDescriptions() {
+			std::array<vk::VertexInputAttributeDescription, 4> attributeDescriptions{};
+
+			attributeDescriptions[0].binding = 0;
+			attributeDescriptions[0].location = 0;
+			attributeDescriptions[0].format = vk::Format::eR32G32B32Sfloat;
+			attributeDescriptions[0].offset = offsetof(Vertex, pos);
+
+			attributeDescriptions[1].binding = 0;
+			attributeDescriptions[1].location = 1;
+			attributeDescriptions[1].format = vk::Format::eR32G32B32Sfloat;
+			attributeDescriptions[1].offset = offsetof(Vertex, colour);
+
+			attributeDescriptions[2].binding = 0;
+			attributeDescriptions[2].location = 2;
+			attributeDescriptions[2].format = vk::Format::eR32G32Sfloat;
+			attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
+
+			attributeDescriptions[3].binding = 0;
+			attributeDescriptions[3].location = 3;
+			attributeDescriptions[3].format = vk::Format::eR32G32B32Sfloat;
+			attributeDescriptions[3].offset = offsetof(Vertex, normal);
+
+			return attributeDescriptions;
+		}
+
+		static vk::VertexInputBindingDescription getPositionBindingDescription() { //Position-only stream for depth-only passes
+			vk::VertexInputBindingDescription bindingDescription{};
+
+			bindingDescription.binding = 0;
+			bindingDescription.stride = sizeof(glm::vec3);
+			bindingDescription.inputRate = vk::VertexInputRate::eVertex;
+
+			return bindingDescription;
+		}
+
+		static vk::VertexInputAttributeDescription getPositionAttributeDescription() { //Same location as pos above, so vertex shaders share the input declaration
+			vk::VertexInputAttributeDescription attributeDescription{};
+
+			attributeDescription.binding = 0;
+			attributeDescription.location = 0;
+			attributeDescription.format = vk::Format::eR32G32B32Sfloat;
+			attributeDescription.offset = 0;
+
+			return attributeDescription;
+		}
+
+		bool operator==(const Vertex& other) const {
+			return pos == other.pos && colour == other.colour && texCoord == other.texCoord;
+		}
+
+	};
+}
+
+namespace std {
+	template<> struct hash<CinderVk::Vertex> {
+		size_t operator()(CinderVk::Vertex const& vertex) const {
+			return ((hash<glm::vec3>()(vertex.pos) ^
+				(hash<glm::vec3>()(vertex.colour) << 1)) >> 1) ^
+				(hash < glm::vec2>()(vertex.texCoord) << 1);
+		}
+	};
 }
\ No newline at end of file
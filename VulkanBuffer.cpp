@@ -1,96 +1,188 @@
-#include "VulkanBuffer.h"
-
-namespace CinderVk {
-	void vulkanMapMemory(vk::Device& device, vk::DeviceMemory memory, vk::DeviceSize offset, vk::DeviceSize size, vk::MemoryMapFlags flags, void** pdata) {
-		device.mapMemory(memory, offset, size, flags, pdata);
-	}
-
-	void vulkanUnmapMemory(vk::Device& device, vk::DeviceMemory memory) {
-		device.unmapMemory(memory);
-	}
-
-	void vulkanDestroyBuffer(vk::Device& device, vk::Buffer buffer) {
-		device.destroyBuffer(buffer, nullptr);
-	}
-
-	void vulkanFreeMemory(vk::Device& device, vk::DeviceMemory bufferMemory) {
-		device.freeMemory(bufferMemory, nullptr);
-	}
-
-	vk::CommandBuffer beginSingleTimeCommands(vk::CommandPool& commandPool, vk::Device& device) {
-		vk::CommandBufferAllocateInfo allocInfo{};
-		allocInfo.level = vk::CommandBufferLevel::ePrimary;
-		allocInfo.commandPool = commandPool;
-		allocInfo.commandBufferCount = 1;
-
-		vk::CommandBuffer commandBuffer;
-		device.allocateCommandBuffers(&allocInfo, &commandBuffer);
-
-		vk::CommandBufferBeginInfo beginInfo{};
-		beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
-
-		commandBuffer.begin(&beginInfo);
-
-		return commandBuffer;
-	}
-
-	void endSingleTimeCommands(vk::CommandBuffer commandBuffer, vk::Queue& graphicsQueue, vk::Device& device, vk::CommandPool& commandPool) {
-		commandBuffer.end();
-
-		vk::SubmitInfo submitInfo{};
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &commandBuffer;
-		graphicsQueue.submit(1, &submitInfo, nullptr);
-		graphicsQueue.waitIdle();
-
-		device.freeCommandBuffers(commandPool, 1, &commandBuffer);
-	}
-
-	uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties, vk::PhysicalDevice& physicalDevice) {
-		vk::PhysicalDeviceMemoryProperties memProperties;
-		physicalDevice.getMemoryProperties(&memProperties);
-
-		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-			if ((typeFilter & (1 << i) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)) {
-				return i;
-			}
-		}
-
-		throw std::runtime_error("Failed to find a suitable memory type");
-	}
-
-	void copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size, vk::CommandPool& commandPool, vk::Device& device, vk::Queue& graphicsQueue) {
-		vk::CommandBuffer commandBuffer = beginSingleTimeCommands(commandPool, device);
-
-		vk::BufferCopy copyRegion{};
-		copyRegion.size = size;
-		commandBuffer.copyBuffer(srcBuffer, dstBuffer, 1, &copyRegion);
-
-		endSingleTimeCommands(commandBuffer, graphicsQueue, device, commandPool);
-	}
-
-	void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer& buffer, vk::DeviceMemory& bufferMemory, vk::Device& device, vk::PhysicalDevice physicalDevice) {
-		vk::BufferCreateInfo bufferInfo{};
-		bufferInfo.size = size;
-		bufferInfo.usage = usage;
-		bufferInfo.sharingMode = vk::SharingMode::eExclusive;
-
-		if (device.createBuffer(&bufferInfo, nullptr, &buffer) != vk::Result::eSuccess) {
-			throw std::runtime_error("Failed to create buffer");
-		}
-
-		vk::MemoryRequirements memRequirements;
-		device.getBufferMemoryRequirements(buffer, &memRequirements);
-
-		vk::MemoryAllocateInfo allocInfo{};
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties, physicalDevice);
-
-		if (device.allocateMemory(&allocInfo, nullptr, &bufferMemory) != vk::Result::eSuccess) {
-			throw std::runtime_error("Failed to allocate buffer memory");
-		}
-
-		device.bindBufferMemory(buffer, bufferMemory, 0);
-	}
-
+#include "VulkanBuffer.h"
+#include "VulkanTimeline.h"
+#include <mutex>
+#include <unordered_map>
+
+namespace CinderVk {
+	namespace {
+		struct TrackedAllocation {
+			vk::DeviceSize size;
+			uint32_t heapIndex;
+			MemoryCategory category;
+		};
+
+		std::mutex trackingMutex; //Allocations come from loader threads too
+		std::unordered_map<VkDeviceMemory, TrackedAllocation> trackedAllocations;
+		TrackedMemory trackedTotals;
+	}
+
+	void trackDeviceMemory(vk::DeviceMemory memory, vk::DeviceSize size, uint32_t memoryTypeIndex, MemoryCategory category, vk::PhysicalDevice& physicalDevice) {
+		uint32_t heapIndex = physicalDevice.getMemoryProperties().memoryTypes[memoryTypeIndex].heapIndex;
+		size_t categoryIndex = static_cast<size_t>(category);
+
+		std::lock_guard<std::mutex> lock(trackingMutex);
+		trackedAllocations[memory] = { size, heapIndex, category };
+
+		if (trackedTotals.heapBytes.size() <= heapIndex)
+			trackedTotals.heapBytes.resize(heapIndex + 1, 0);
+
+		trackedTotals.heapBytes[heapIndex] += size;
+		trackedTotals.categoryBytes[categoryIndex] += size;
+		trackedTotals.categoryAllocations[categoryIndex]++;
+		trackedTotals.allocationCount++;
+	}
+
+	TrackedMemory getTrackedMemory() {
+		std::lock_guard<std::mutex> lock(trackingMutex);
+		return trackedTotals;
+	}
+
+	MemoryCategory categorizeBuffer(vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties) {
+		if (usage & vk::BufferUsageFlagBits::eVertexBuffer)
+			return MemoryCategory::eVertex;
+
+		if (usage & vk::BufferUsageFlagBits::eIndexBuffer)
+			return MemoryCategory::eIndex;
+
+		if (usage & vk::BufferUsageFlagBits::eUniformBuffer)
+			return MemoryCategory::eUniform;
+
+		if (usage == vk::BufferUsageFlags(vk::BufferUsageFlagBits::eTransferSrc) && (properties & vk::MemoryPropertyFlagBits::eHostVisible))
+			return MemoryCategory::eStaging;
+
+		return MemoryCategory::eOther;
+	}
+
+	MemoryCategory categorizeImage(vk::ImageUsageFlags usage) {
+		if (usage & (vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eDepthStencilAttachment))
+			return MemoryCategory::eAttachment;
+
+		return MemoryCategory::eTexture;
+	}
+
+	void vulkanMapMemory(vk::Device& device, vk::DeviceMemory memory, vk::DeviceSize offset, vk::DeviceSize size, vk::MemoryMapFlags flags, void** pdata) {
+		device.mapMemory(memory, offset, size, flags, pdata);
+	}
+
+	void vulkanUnmapMemory(vk::Device& device, vk::DeviceMemory memory) {
+		device.unmapMemory(memory);
+	}
+
+	void vulkanDestroyBuffer(vk::Device& device, vk::Buffer buffer) {
+		device.destroyBuffer(buffer, nullptr);
+	}
+
+	void vulkanFreeMemory(vk::Device& device, vk::DeviceMemory bufferMemory) {
+		if (bufferMemory) {
+			std::lock_guard<std::mutex> lock(trackingMutex);
+			auto it = trackedAllocations.find(bufferMemory);
+
+			if (it != trackedAllocations.end()) {
+				size_t categoryIndex = static_cast<size_t>(it->second.category);
+
+				trackedTotals.heapBytes[it->second.heapIndex] -= it->second.size;
+				trackedTotals.categoryBytes[categoryIndex] -= it->second.size;
+				trackedTotals.categoryAllocations[categoryIndex]--;
+				trackedTotals.allocationCount--;
+				trackedAllocations.erase(it);
+			}
+		}
+
+		device.freeMemory(bufferMemory, nullptr);
+	}
+
+	vk::CommandBuffer beginSingleTimeCommands(vk::CommandPool& commandPool, vk::Device& device) {
+		vk::CommandBufferAllocateInfo allocInfo{};
+		allocInfo.level = vk::CommandBufferLevel::ePrimary;
+		allocInfo.commandPool = commandPool;
+		allocInfo.commandBufferCount = 1;
+
+		vk::CommandBuffer commandBuffer;
+		device.allocateCommandBuffers(&allocInfo, &commandBuffer);
+
+		vk::CommandBufferBeginInfo beginInfo{};
+		beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+
+		commandBuffer.begin(&beginInfo);
+
+		return commandBuffer;
+	}
+
+	void endSingleTimeCommands(vk::CommandBuffer commandBuffer, vk::Queue& graphicsQueue, vk::Device& device, vk::CommandPool& commandPool) {
+		commandBuffer.end();
+
+		vk::SubmitInfo submitInfo{};
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		graphicsQueue.submit(1, &submitInfo, nullptr);
+		graphicsQueue.waitIdle();
+
+		device.freeCommandBuffers(commandPool, 1, &commandBuffer);
+	}
+
+	void endSingleTimeCommands(vk::CommandBuffer commandBuffer, vk::Queue& graphicsQueue, vk::Device& device, vk::CommandPool& commandPool, VulkanTimeline* timeline) {
+		if (!timeline) { //Before the core has a timeline
+			endSingleTimeCommands(commandBuffer, graphicsQueue, device, commandPool);
+			return;
+		}
+
+		commandBuffer.end();
+
+		TimelineSubmitInfo submitInfo{};
+		submitInfo.commandBuffers = { commandBuffer };
+
+		timeline->wait(timeline->submit(graphicsQueue, submitInfo));
+
+		device.freeCommandBuffers(commandPool, 1, &commandBuffer);
+	}
+
+	uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties, vk::PhysicalDevice& physicalDevice) {
+		vk::PhysicalDeviceMemoryProperties memProperties;
+		physicalDevice.getMemoryProperties(&memProperties);
+
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+			if ((typeFilter & (1 << i) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)) {
+				return i;
+			}
+		}
+
+		throw std::runtime_error("Failed to find a suitable memory type");
+	}
+
+	void copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size, vk::CommandPool& commandPool, vk::Device& device, vk::Queue& graphicsQueue, VulkanTimeline* timeline) {
+		vk::CommandBuffer commandBuffer = beginSingleTimeCommands(commandPool, device);
+
+		vk::BufferCopy copyRegion{};
+		copyRegion.size = size;
+		commandBuffer.copyBuffer(srcBuffer, dstBuffer, 1, &copyRegion);
+
+		endSingleTimeCommands(commandBuffer, graphicsQueue, device, commandPool, timeline);
+	}
+
+	void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer& buffer, vk::DeviceMemory& bufferMemory, vk::Device& device, vk::PhysicalDevice physicalDevice) {
+		vk::BufferCreateInfo bufferInfo{};
+		bufferInfo.size = size;
+		bufferInfo.usage = usage;
+		bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+
+		if (device.createBuffer(&bufferInfo, nullptr, &buffer) != vk::Result::eSuccess) {
+			throw std::runtime_error("Failed to create buffer");
+		}
+
+		vk::MemoryRequirements memRequirements;
+		device.getBufferMemoryRequirements(buffer, &memRequirements);
+
+		vk::MemoryAllocateInfo allocInfo{};
+		allocInfo.allocationSize = memRequirements.size;
+		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties, physicalDevice);
+
+		if (device.allocateMemory(&allocInfo, nullptr, &bufferMemory) != vk::Result::eSuccess) {
+			throw std::runtime_error("Failed to allocate buffer memory");
+		}
+
+		trackDeviceMemory(bufferMemory, allocInfo.allocationSize, allocInfo.memoryTypeIndex, categorizeBuffer(usage, properties), physicalDevice);
+
+		device.bindBufferMemory(buffer, bufferMemory, 0);
+	}
+
 }
\ No newline at end of file
@@ -1,24 +1,53 @@
-#pragma once
-#include "vulkan/vulkan.hpp"
-
-namespace CinderVk {
-	void vulkanMapMemory(vk::Device& device, vk::DeviceMemory memory, vk::DeviceSize offset, vk::DeviceSize size, vk::MemoryMapFlags flags, void** pdata);
-
-	void vulkanUnmapMemory(vk::Device& device, vk::DeviceMemory memory);
-
-	void vulkanDestroyBuffer(vk::Device& device, vk::Buffer buffer);
-
-	void vulkanFreeMemory(vk::Device& device, vk::DeviceMemory bufferMemory);
-
-	vk::CommandBuffer beginSingleTimeCommands(vk::CommandPool& commandPool, vk::Device& device);
-
-	void endSingleTimeCommands(vk::CommandBuffer commandBuffer, vk::Queue& graphicsQueue, vk::Device& device, vk::CommandPool& commandPool);
-
-	uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties, vk::PhysicalDevice& physicalDevice);
-
-	void copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size, vk::CommandPool& commandPool, vk::Device& device, vk::Queue& graphicsQueue);
-
-	void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer& buffer, vk::DeviceMemory& bufferMemory, vk::Device& device, vk::PhysicalDevice physicalDevice);
-}
-
-
+#pragma once
+#include "vulkan/vulkan.hpp"
+#include <array>
+#include <vector>
+
+namespace CinderVk {
+	class VulkanTimeline;
+
+	enum class MemoryCategory : uint8_t {
+		eVertex,
+		eIndex,
+		eTexture,
+		eStaging,
+		eUniform,
+		eAttachment, //Render targets and render graph transients
+		eOther, //Storage and readback buffers
+		eCount
+	};
+
+	struct TrackedMemory { //Every vk::DeviceMemory the engine allocated and hasn't freed yet
+		std::array<vk::DeviceSize, static_cast<size_t>(MemoryCategory::eCount)> categoryBytes{};
+		std::array<uint32_t, static_cast<size_t>(MemoryCategory::eCount)> categoryAllocations{};
+		std::vector<vk::DeviceSize> heapBytes; //Indexed by memory heap
+		uint32_t allocationCount = 0;
+	};
+
+	void trackDeviceMemory(vk::DeviceMemory memory, vk::DeviceSize size, uint32_t memoryTypeIndex, MemoryCategory category, vk::PhysicalDevice& physicalDevice); //Call after every allocateMemory
+	TrackedMemory getTrackedMemory();
+	MemoryCategory categorizeBuffer(vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties);
+	MemoryCategory categorizeImage(vk::ImageUsageFlags usage);
+
+	void vulkanMapMemory(vk::Device& device, vk::DeviceMemory memory, vk::DeviceSize offset, vk::DeviceSize size, vk::MemoryMapFlags flags, void** pdata);
+
+	void vulkanUnmapMemory(vk::Device& device, vk::DeviceMemory memory);
+
+	void vulkanDestroyBuffer(vk::Device& device, vk::Buffer buffer);
+
+	void vulkanFreeMemory(vk::Device& device, vk::DeviceMemory bufferMemory); //Use instead of freeMemory so the memory stats stay right
+
+	vk::CommandBuffer beginSingleTimeCommands(vk::CommandPool& commandPool, vk::Device& device);
+
+	void endSingleTimeCommands(vk::CommandBuffer commandBuffer, vk::Queue& graphicsQueue, vk::Device& device, vk::CommandPool& commandPool);
+
+	void endSingleTimeCommands(vk::CommandBuffer commandBuffer, vk::Queue& graphicsQueue, vk::Device& device, vk::CommandPool& commandPool, VulkanTimeline* timeline); //Waits for this submission only so frames in flight keep running, idles the queue if timeline is null
+
+	uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties, vk::PhysicalDevice& physicalDevice);
+
+	void copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size, vk::CommandPool& commandPool, vk::Device& device, vk::Queue& graphicsQueue, VulkanTimeline* timeline = nullptr);
+
+	void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer& buffer, vk::DeviceMemory& bufferMemory, vk::Device& device, vk::PhysicalDevice physicalDevice);
+}
+
+
@@ -0,0 +1,286 @@
+#pragma once
+#include "VulkanWrapper.h"
+#include "VulkanHelper.h"
+#include "VulkanBuffer.h"
+#include "VulkanRenderGraph.h"
+#include "glm/glm.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+namespace CinderVk {
+	constexpr uint32_t CLUSTER_COUNT_X = 16; //Keep in sync with clusteredLights.glsl
+	constexpr uint32_t CLUSTER_COUNT_Y = 9;
+	constexpr uint32_t CLUSTER_COUNT_Z = 24;
+	constexpr uint32_t CLUSTER_COUNT = CLUSTER_COUNT_X * CLUSTER_COUNT_Y * CLUSTER_COUNT_Z;
+	constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 256;
+
+	struct PointLight { //std430, matches clusteredLights.glsl
+		glm::vec4 positionRadius; //World space position, influence radius in w
+		glm::vec4 colour;
+	};
+
+	struct ClusteredLightingResources { //What the shading pass reads, bindings 6 to 8 of VulkanDescriptorSetLayout
+		RenderGraphResource pointLights;
+		RenderGraphResource clusterGrid;
+		RenderGraphResource clusterLightIndices;
+	};
+
+	class VulkanClusteredLighting : VulkanWrapper { //Bins point lights into a froxel grid on the GPU each frame, fragments then loop over their cluster's lights only
+	public:
+		VulkanClusteredLighting(VulkanCore* coreRef) : VulkanWrapper(coreRef) {
+			init();
+		}
+
+		void setLights(const std::vector<PointLight>& pointLights) { //Uploaded by the next addPasses
+			lights = pointLights;
+		}
+
+		void setCamera(const glm::mat4& view, const glm::mat4& projection, float zNear, float zFar) {
+			params.view = view;
+			params.inverseProjection = glm::inverse(projection);
+			params.zNear = zNear;
+			params.zFar = zFar;
+		}
+
+		ClusteredLightingResources addPasses(VulkanRenderGraph& graph, uint32_t frameIndex, vk::Extent2D extent) { //frameIndex's previous submission must have retired
+			FrameResources& frame = frames[frameIndex];
+			uploadLights(frame);
+
+			params.screenSize = glm::vec2(static_cast<float>(extent.width), static_cast<float>(extent.height));
+			params.lightCount = static_cast<uint32_t>(lights.size());
+			memcpy(frame.paramsMapped, &params, sizeof(ClusterParams));
+
+			ClusteredLightingResources resources{};
+			resources.pointLights = graph.importBuffer("pointLights", frame.lightBuffer, frame.lightCapacity * sizeof(PointLight));
+			resources.clusterGrid = graph.createBuffer("clusterGrid", CLUSTER_GRID_HEADER_SIZE + CLUSTER_COUNT * 2 * sizeof(uint32_t));
+			resources.clusterLightIndices = graph.createBuffer("clusterLightIndices", CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER * sizeof(uint32_t));
+
+			graph.addPass("clusterLights", [&](RenderGraphPassBuilder& builder) {
+				builder.read(resources.pointLights, ResourceUsage::eShaderRead, vk::PipelineStageFlagBits::eComputeShader);
+				builder.write(resources.clusterGrid, ResourceUsage::eShaderWrite);
+				builder.write(resources.clusterLightIndices, ResourceUsage::eShaderWrite);
+			}, [this, &graph, resources, frameIndex](vk::CommandBuffer& commandBuffer) {
+				updateDescriptorSet(frameIndex, graph.getBuffer(resources.clusterGrid), graph.getBuffer(resources.clusterLightIndices)); //Transients are only placed once the graph compiles
+
+				commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+				commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, 1, &frames[frameIndex].descriptorSet, 0, nullptr);
+				commandBuffer.dispatch(1, 1, CLUSTER_COUNT_Z);
+			});
+
+			return resources;
+		}
+
+		void writeShadingDescriptors(VulkanRenderGraph& graph, const ClusteredLightingResources& resources, vk::DescriptorSet set) { //Bindings 6 to 8 of VulkanDescriptorSetLayout, after graph.compile placed the transients
+			std::array<vk::DescriptorBufferInfo, 3> bufferInfos = {
+				vk::DescriptorBufferInfo(graph.getBuffer(resources.pointLights), 0, VK_WHOLE_SIZE),
+				vk::DescriptorBufferInfo(graph.getBuffer(resources.clusterGrid), 0, VK_WHOLE_SIZE),
+				vk::DescriptorBufferInfo(graph.getBuffer(resources.clusterLightIndices), 0, VK_WHOLE_SIZE)
+			};
+
+			std::array<vk::WriteDescriptorSet, 3> writes{};
+			for (uint32_t i = 0; i != writes.size(); i++) {
+				writes[i].dstSet = set;
+				writes[i].dstBinding = 6 + i;
+				writes[i].descriptorCount = 1;
+				writes[i].descriptorType = vk::DescriptorType::eStorageBuffer;
+				writes[i].pBufferInfo = &bufferInfos[i];
+			}
+
+			getCorePtr()->getLogicalDevicePtr()->updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+		}
+
+		~VulkanClusteredLighting() {
+			cleanup();
+		}
+
+	private:
+		static constexpr vk::DeviceSize CLUSTER_GRID_HEADER_SIZE = 2 * sizeof(glm::vec4);
+
+		struct ClusterParams { //std140, matches clusterLights.comp
+			glm::mat4 view = glm::mat4(1.0f);
+			glm::mat4 inverseProjection = glm::mat4(1.0f);
+			glm::vec2 screenSize = glm::vec2(1.0f);
+			float zNear = 0.1f;
+			float zFar = 1000.0f;
+			uint32_t lightCount = 0;
+			uint32_t padding[3] = {};
+		};
+
+		struct FrameResources { //One per frame in flight so the CPU never writes what the GPU is reading
+			vk::Buffer paramsBuffer;
+			vk::DeviceMemory paramsMemory;
+			void* paramsMapped = nullptr;
+
+			vk::Buffer lightBuffer;
+			vk::DeviceMemory lightMemory;
+			void* lightMapped = nullptr;
+			size_t lightCapacity = 0;
+
+			vk::DescriptorSet descriptorSet;
+		};
+
+		std::vector<PointLight> lights;
+		ClusterParams params;
+		std::array<FrameResources, MAX_FRAMES_IN_FLIGHT> frames;
+
+		vk::DescriptorSetLayout descriptorSetLayout;
+		vk::DescriptorPool descriptorPool;
+		vk::PipelineLayout pipelineLayout;
+		vk::Pipeline pipeline;
+
+		void init() {
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+			std::vector<char> shaderCode = Helper::readFile("clusterLights.spv"); //First, so a missing shader throws before anything needs freeing
+
+			std::array<vk::DescriptorSetLayoutBinding, 4> bindings{};
+			for (uint32_t i = 0; i != bindings.size(); i++) {
+				bindings[i].binding = i;
+				bindings[i].descriptorType = i == 0 ? vk::DescriptorType::eUniformBuffer : vk::DescriptorType::eStorageBuffer;
+				bindings[i].descriptorCount = 1;
+				bindings[i].stageFlags = vk::ShaderStageFlagBits::eCompute;
+			}
+
+			vk::DescriptorSetLayoutCreateInfo layoutInfo{};
+			layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+			layoutInfo.pBindings = bindings.data();
+
+			if (device->createDescriptorSetLayout(&layoutInfo, nullptr, &descriptorSetLayout) != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to create the light culling descriptor set layout.");
+
+			std::array<vk::DescriptorPoolSize, 2> poolSizes = {
+				vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, MAX_FRAMES_IN_FLIGHT),
+				vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 3 * MAX_FRAMES_IN_FLIGHT)
+			};
+
+			vk::DescriptorPoolCreateInfo poolInfo{};
+			poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+			poolInfo.pPoolSizes = poolSizes.data();
+			poolInfo.maxSets = MAX_FRAMES_IN_FLIGHT;
+
+			if (device->createDescriptorPool(&poolInfo, nullptr, &descriptorPool) != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to create the light culling descriptor pool.");
+
+			std::array<vk::DescriptorSetLayout, MAX_FRAMES_IN_FLIGHT> setLayouts;
+			setLayouts.fill(descriptorSetLayout);
+			std::array<vk::DescriptorSet, MAX_FRAMES_IN_FLIGHT> descriptorSets;
+
+			vk::DescriptorSetAllocateInfo allocInfo{};
+			allocInfo.descriptorPool = descriptorPool;
+			allocInfo.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
+			allocInfo.pSetLayouts = setLayouts.data();
+
+			if (device->allocateDescriptorSets(&allocInfo, descriptorSets.data()) != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to allocate the light culling descriptor sets.");
+
+			for (uint32_t i = 0; i != MAX_FRAMES_IN_FLIGHT; i++) {
+				FrameResources& frame = frames[i];
+				frame.descriptorSet = descriptorSets[i];
+
+				createBuffer(sizeof(ClusterParams), vk::BufferUsageFlagBits::eUniformBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+					frame.paramsBuffer, frame.paramsMemory, *device, *getCorePtr()->getPhysicalDevicePtr());
+				vulkanMapMemory(*device, frame.paramsMemory, 0, sizeof(ClusterParams), vk::MemoryMapFlagBits{}, &frame.paramsMapped);
+
+				uploadLights(frame); //Never bind a null light buffer, even with no lights
+			}
+
+			createPipeline(shaderCode);
+		}
+
+		void cleanup() {
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+
+			for (auto& frame : frames) {
+				device->destroyBuffer(frame.paramsBuffer, nullptr);
+				vulkanFreeMemory(*device, frame.paramsMemory);
+				device->destroyBuffer(frame.lightBuffer, nullptr);
+				vulkanFreeMemory(*device, frame.lightMemory);
+			}
+
+			device->destroyPipeline(pipeline, nullptr);
+			device->destroyPipelineLayout(pipelineLayout, nullptr);
+			device->destroyDescriptorPool(descriptorPool, nullptr);
+			device->destroyDescriptorSetLayout(descriptorSetLayout, nullptr);
+		}
+
+		void createPipeline(const std::vector<char>& shaderCode) {
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+
+			vk::PipelineLayoutCreateInfo pipelineLayoutInfo{};
+			pipelineLayoutInfo.setLayoutCount = 1;
+			pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+
+			if (device->createPipelineLayout(&pipelineLayoutInfo, nullptr, &pipelineLayout) != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to create the light culling pipeline layout.");
+
+			vk::ShaderModuleCreateInfo moduleInfo{};
+			moduleInfo.codeSize = shaderCode.size();
+			moduleInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+
+			vk::ShaderModule shaderModule;
+			if (device->createShaderModule(&moduleInfo, nullptr, &shaderModule) != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to create the light culling shader module.");
+
+			vk::ComputePipelineCreateInfo pipelineInfo{};
+			pipelineInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+			pipelineInfo.stage.module = shaderModule;
+			pipelineInfo.stage.pName = "main";
+			pipelineInfo.layout = pipelineLayout;
+
+			vk::Result result = device->createComputePipelines(getCorePtr()->getPipelineCache(), 1, &pipelineInfo, nullptr, &pipeline);
+			device->destroyShaderModule(shaderModule, nullptr);
+
+			if (result != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to create the light culling pipeline.");
+		}
+
+		void uploadLights(FrameResources& frame) { //Lights change every frame, so they live in host visible memory and grow in powers of two
+			size_t required = std::max<size_t>(lights.size(), 1);
+
+			if (required > frame.lightCapacity) {
+				vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+
+				if (frame.lightBuffer) { //Last read by this frame slot's previous submission, which has retired
+					device->unmapMemory(frame.lightMemory);
+					device->destroyBuffer(frame.lightBuffer, nullptr);
+					vulkanFreeMemory(*device, frame.lightMemory);
+				}
+
+				size_t capacity = 64;
+				while (capacity < required)
+					capacity *= 2;
+
+				createBuffer(capacity * sizeof(PointLight), vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+					frame.lightBuffer, frame.lightMemory, *device, *getCorePtr()->getPhysicalDevicePtr());
+				vulkanMapMemory(*device, frame.lightMemory, 0, capacity * sizeof(PointLight), vk::MemoryMapFlagBits{}, &frame.lightMapped);
+				frame.lightCapacity = capacity;
+			}
+
+			if (!lights.empty())
+				memcpy(frame.lightMapped, lights.data(), lights.size() * sizeof(PointLight));
+		}
+
+		void updateDescriptorSet(uint32_t frameIndex, vk::Buffer clusterGrid, vk::Buffer clusterLightIndices) {
+			FrameResources& frame = frames[frameIndex];
+
+			std::array<vk::DescriptorBufferInfo, 4> bufferInfos = {
+				vk::DescriptorBufferInfo(frame.paramsBuffer, 0, sizeof(ClusterParams)),
+				vk::DescriptorBufferInfo(frame.lightBuffer, 0, VK_WHOLE_SIZE),
+				vk::DescriptorBufferInfo(clusterGrid, 0, VK_WHOLE_SIZE),
+				vk::DescriptorBufferInfo(clusterLightIndices, 0, VK_WHOLE_SIZE)
+			};
+
+			std::array<vk::WriteDescriptorSet, 4> writes{};
+			for (uint32_t i = 0; i != writes.size(); i++) {
+				writes[i].dstSet = frame.descriptorSet;
+				writes[i].dstBinding = i;
+				writes[i].descriptorCount = 1;
+				writes[i].descriptorType = i == 0 ? vk::DescriptorType::eUniformBuffer : vk::DescriptorType::eStorageBuffer;
+				writes[i].pBufferInfo = &bufferInfos[i];
+			}
+
+			getCorePtr()->getLogicalDevicePtr()->updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+		}
+	};
+}
@@ -1,450 +1,1098 @@
-#pragma once
-#include "VulkanCore.h"
-#include "VulkanHelper.h"
-#include "VulkanSwapchain.h"
-#include "VulkanRenderpass.h"
-#include "VulkanDescriptorSetLayout.h"
-#include "VulkanGraphicsPipeline.h"
-#include "VulkanTexture.h"
-#include "vulkan/vulkan.hpp"
-
-#define VMA_IMPLEMENTATION
-#include "vk_mem_alloc.h"
-
-#include "SDL2/SDL.h"
-#include "SDL2/SDL_vulkan.h"
-#include <iostream>
-#include <memory>
-#include <set>
-
-
-
-namespace CinderVk {
-	struct VulkanCore::impl { //All VulkanCore inner workings go in here
-
-		class VulkanModelManager {
-
-
-
-
-		};
-
-	public:
-		VulkanCore* parent;
-
-		SDL_Window* window = nullptr;
-		vk::SurfaceKHR surfaceKHR;
-		vk::UniqueInstance instance;
-		vk::PhysicalDevice physicalDevice;
-		vk::Device device;
-		vk::Queue graphicsQueue, presentQueue;
-		vk::CommandPool commandPool;
-		vk::Sampler textureSampler;
-		VmaAllocator allocator;
-
-		std::unique_ptr<vk::DispatchLoaderDynamic> dldiPtr = nullptr;
-		std::unique_ptr<VulkanSwapchain> swapchainPtr = nullptr;
-		std::unique_ptr<VulkanRenderpass> renderpassPtr = nullptr;
-		std::unique_ptr<VulkanDescriptorSetLayout> descriptorSetLayoutPtr = nullptr;
-		std::unique_ptr<VulkanGraphicsPipeline> graphicsPipelinePtr = nullptr;
-		std::unique_ptr<VulkanModelManager> modelManagerPtr = nullptr;
-		VkDebugUtilsMessengerEXT debugMessenger;
-
-		
-
-#ifdef NDEBUG
-		const bool enableValidationLayers = false;
-#else
-		const bool enableValidationLayers = true;
-#endif
-
-		const std::vector<const char*> validationLayers = {
-			"VK_LAYER_KHRONOS_validation"
-		};
-
-		const std::vector<const char*> deviceExtensions = {
-			VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-			VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME
-		};
-
-		const uint32_t VULKAN_VERSION = VK_API_VERSION_1_1;
-
-		~impl() {
-			cleanup();
-		}
-
-		impl(VulkanCore* _parent) : parent(_parent) {
-			initWindow();
-			//initVulkan();
-		}
-
-		const void initWindow() {
-			if (SDL_Init(SDL_INIT_VIDEO) != 0)
-				throw std::runtime_error("Failed to initialize SDL.");
-			
-			window = SDL_CreateWindow("Main Window", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 2560, 1440, SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
-		}
-
-		const void initVulkan() {
-			createInstance();
-
-			if (enableValidationLayers)
-				createDebugMessenger();
-
-			createSurface();
-			pickPhysicalDevice();
-			createLogicalDevice();
-			setupVmaAllocator();
-
-			swapchainPtr = std::make_unique<VulkanSwapchain>(parent);
-			renderpassPtr = std::make_unique<VulkanRenderpass>(parent);
-			descriptorSetLayoutPtr = std::make_unique<VulkanDescriptorSetLayout>(parent);
-			graphicsPipelinePtr = std::make_unique<VulkanGraphicsPipeline>(parent);
-
-			swapchainPtr->createDepthResourcesPublic();
-			swapchainPtr->createFramebuffersPublic();
-
-			createCommandPool();
-			createTextureSampler();
-
-			//loadModels();
-			//Load in a scene here
-
-
-			//Call these on scene change
-			//createUniformBuffers(); //each VulkanModel should manage their own
-			//Create uniform buffers should be done with push constants in every VulkanModel
-			//createLightingBuffer();
-			//createDescriptorPool();
-			//createDescriptorSets();
-			//createCommandBuffers();
-			//createSyncObjects();
-
-		}
-
-		const void createInstance() {
-			if (enableValidationLayers && ![&]() -> bool { //If validation layers are enabled but they are not supported, throw a runtime error.
-				auto availableLayers = vk::enumerateInstanceLayerProperties();
-
-				for (const char* layerName : validationLayers) {
-					bool layerFound = false;
-
-					for (const auto& layerProperties : availableLayers) {
-						if (strcmp(layerName, layerProperties.layerName) == 0) {
-							layerFound = true;
-							break;
-						}
-					}
-
-					if (!layerFound)
-						return false;
-				}
-
-				return true;
-			}()) throw std::runtime_error("Validation layers requested but not available.");
-
-			vk::ApplicationInfo applicationInfo("Cinder", 1, "Cinderkapsule", 1, VULKAN_VERSION); //1.1 for VMA atm
-
-			auto extensions = getRequiredExtensions();
-
-			vk::InstanceCreateInfo createInfo(
-				{},
-				&applicationInfo,
-				0, nullptr,
-				static_cast<uint32_t>(extensions.size()), extensions.data()
-			);
-
-			if (enableValidationLayers) {
-				vk::DebugUtilsMessengerCreateInfoEXT debugCreateInfo(vk::DebugUtilsMessengerCreateFlagsEXT(), 
-					vk::DebugUtilsMessageSeverityFlagsEXT(),
-					vk::DebugUtilsMessageTypeFlagsEXT(),
-					debugCallback, nullptr
-				);
-
-				createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
-				createInfo.ppEnabledLayerNames = validationLayers.data();
-
-				createInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)&debugCreateInfo;
-			}
-			else {
-				createInfo.enabledLayerCount = 0;
-				createInfo.pNext = nullptr;
-			}
-
-			try {
-				instance = vk::createInstanceUnique(createInfo, nullptr);
-				dldiPtr = std::make_unique<vk::DispatchLoaderDynamic>(*instance, vkGetInstanceProcAddr);
-			}
-			catch (vk::SystemError err) {
-				throw std::runtime_error("failed to create instance!");
-			}
-		}
-
-		const void createDebugMessenger() {
-			if (!enableValidationLayers) return; 
-
-			const vk::DebugUtilsMessengerCreateInfoEXT debugCreateInfo({}, vk::DebugUtilsMessageSeverityFlagBitsEXT::eError | vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning,
-				vk::DebugUtilsMessageTypeFlagBitsEXT::eGeneral | vk::DebugUtilsMessageTypeFlagBitsEXT::ePerformance | vk::DebugUtilsMessageTypeFlagBitsEXT::eValidation,
-				debugCallback, nullptr
-			);
-
-			debugMessenger = instance->createDebugUtilsMessengerEXT(debugCreateInfo, nullptr, *dldiPtr);
-		}
-
-		const void createCommandPool() {
-			Helper::QueueFamilyIndices queueFamilyIndices = Helper::findQueueFamilies(physicalDevice, surfaceKHR);
-
-			vk::CommandPoolCreateInfo poolInfo{};
-			poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-			poolInfo.flags = vk::CommandPoolCreateFlags();
-
-			if (device.createCommandPool(&poolInfo, nullptr, &commandPool) != vk::Result::eSuccess) {
-				throw std::runtime_error("Failed to create command pool.");
-			}
-		}
-
-		const void createTextureSampler() {
-			vk::SamplerCreateInfo samplerInfo{};
-			samplerInfo.magFilter = vk::Filter::eLinear;
-			samplerInfo.minFilter = vk::Filter::eLinear;
-			samplerInfo.addressModeU = vk::SamplerAddressMode::eRepeat;
-			samplerInfo.addressModeV = vk::SamplerAddressMode::eRepeat;
-			samplerInfo.addressModeW = vk::SamplerAddressMode::eRepeat;
-			samplerInfo.anisotropyEnable = VK_TRUE;
-			samplerInfo.maxAnisotropy = 16.0f;
-			samplerInfo.borderColor = vk::BorderColor::eIntOpaqueBlack;
-			samplerInfo.unnormalizedCoordinates = VK_FALSE;
-			samplerInfo.compareEnable = VK_FALSE;
-			samplerInfo.compareOp = vk::CompareOp::eAlways;
-			samplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
-			samplerInfo.mipLodBias = 0.0f;
-			samplerInfo.minLod = 0.0f;
-			samplerInfo.maxLod = 0.0f;
-
-			if (device.createSampler(&samplerInfo, nullptr, &textureSampler) != vk::Result::eSuccess) {
-				throw std::runtime_error("Failed to create texture sampler.");
-			}
-		}
-
-		void createSurface() {
-			SDL_bool r = SDL_Vulkan_CreateSurface(window, VkInstance(instance.get()), reinterpret_cast<VkSurfaceKHR*>(&surfaceKHR));
-			if (r != SDL_TRUE)
-				throw std::runtime_error("Failed to create Vulkan surface on the SDL window.");
-		}
-
-		const void createLogicalDevice() {
-			Helper::QueueFamilyIndices indices = Helper::findQueueFamilies(physicalDevice, surfaceKHR);
-
-			std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
-			std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
-
-			float queuePriority = 1.0f;
-			for (uint32_t queueFamily : uniqueQueueFamilies) {
-				vk::DeviceQueueCreateInfo queueCreateInfo({}, queueFamily, 1, &queuePriority);
-				queueCreateInfos.push_back(queueCreateInfo);
-			}
-
-			vk::PhysicalDeviceFeatures deviceFeatures{};
-			deviceFeatures.samplerAnisotropy = VK_TRUE;
-			deviceFeatures.shaderUniformBufferArrayDynamicIndexing = VK_TRUE;
-
-			vk::PhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
-			indexingFeatures.pNext = nullptr;
-			indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
-			indexingFeatures.runtimeDescriptorArray = VK_TRUE;
-
-			vk::DeviceCreateInfo createInfo{};
-			createInfo.pQueueCreateInfos = queueCreateInfos.data();
-			createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
-			createInfo.pEnabledFeatures = &deviceFeatures;
-			createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-			createInfo.ppEnabledExtensionNames = deviceExtensions.data();
-
-			createInfo.pNext = &indexingFeatures;
-
-			if (enableValidationLayers) {
-				createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
-				createInfo.ppEnabledLayerNames = validationLayers.data();
-			} else createInfo.enabledLayerCount = 0;
-
-			device = physicalDevice.createDevice(createInfo);
-
-			if (device == VK_NULL_HANDLE) //Might need to be nullptr
-				throw std::runtime_error("Failed to create logical device.");
-
-			device.getQueue(indices.graphicsFamily.value(), 0, &graphicsQueue);
-			device.getQueue(indices.presentFamily.value(), 0, &presentQueue);
-		}
-
-		const void setupVmaAllocator() {
-			VmaAllocatorCreateInfo allocatorInfo{};
-			allocatorInfo.vulkanApiVersion = VULKAN_VERSION;
-			allocatorInfo.physicalDevice = physicalDevice;
-			allocatorInfo.device = device;
-			allocatorInfo.instance = *instance;
-			allocatorInfo.flags = {};
-
-			if (vmaCreateAllocator(&allocatorInfo, &allocator) != VK_SUCCESS)
-				throw std::runtime_error("VMA allocator could not be created.");
-		}
-
-		const void loadModels() {
-
-
-
-
-
-		}
-
-		const void drawFrame() {
-
-		}
-
-		const void cleanup() {
-			//device.waitIdle();
-
-			swapchainPtr.reset();
-			device.destroy(nullptr);
-			
-			if (enableValidationLayers)
-				instance->destroyDebugUtilsMessengerEXT(debugMessenger, nullptr, *dldiPtr);
-
-			
-			instance->destroySurfaceKHR(surfaceKHR, nullptr);
-			
-			SDL_DestroyWindow(window);
-			SDL_Quit();
-		}
-
-		static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
-			VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
-			VkDebugUtilsMessageTypeFlagsEXT messageType,
-			const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
-			void* pUserData
-		) {
-			std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
-			return VK_FALSE;
-		}
-
-		void pickPhysicalDevice() {
-			auto physicalDevices = instance->enumeratePhysicalDevices();
-
-			if (physicalDevices.empty()) throw std::runtime_error("Failed to find GPUs with Vulkan support.");
-
-			for (const auto& device : physicalDevices) {
-				if (isDeviceSuitable(device)) {
-					physicalDevice = device;
-					break;
-				}
-			}
-
-			if (physicalDevice == VK_NULL_HANDLE) throw std::runtime_error("Failed to find a suitable GPU.");
-		}
-
-		bool isDeviceSuitable(vk::PhysicalDevice device) {
-			Helper::QueueFamilyIndices indices = Helper::findQueueFamilies(device, surfaceKHR);
-
-			bool swapchainAdequate = false;
-			bool extensionsSupported = checkDeviceExtensionSupport(device);
-			
-			if (extensionsSupported) {
-				Helper::SwapchainSupportDetails swapchainSupport = Helper::querySwapchainSupport(device, surfaceKHR);
-				swapchainAdequate = !swapchainSupport.formats.empty() && !swapchainSupport.presentModes.empty();
-			}
-
-			VkPhysicalDeviceFeatures supportedFeatures = device.getFeatures();
-			
-			return indices.isComplete() && extensionsSupported && swapchainAdequate && supportedFeatures.samplerAnisotropy;
-		}
-
-		bool checkDeviceExtensionSupport(vk::PhysicalDevice device) {
-			auto availableExtensions = device.enumerateDeviceExtensionProperties();
-
-			std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
-
-			for (const auto& extension : availableExtensions)
-				requiredExtensions.erase(extension.extensionName);
-
-			return requiredExtensions.empty();
-		}
-
-		std::vector<const char*> getRequiredExtensions() { //Get the required extensions.
-			uint32_t sdlExtensionCount = 0;
-			const char** sdlExtensions = NULL;
-			SDL_Vulkan_GetInstanceExtensions(window, &sdlExtensionCount, sdlExtensions);
-			sdlExtensions = new const char* [sdlExtensionCount];
-
-			if (!SDL_Vulkan_GetInstanceExtensions(window, &sdlExtensionCount, sdlExtensions))
-				throw std::runtime_error("Failed to get SDL instance extensions for Vulkan.");
-
-			std::vector<const char*> extensions(sdlExtensions, sdlExtensions + sdlExtensionCount);
-			delete[] sdlExtensions;
-
-			if (enableValidationLayers)
-				extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
-
-			return extensions;
-		}
-
-		//void framebufferResizedSwitch();
-	};
-
-	VulkanCore::VulkanCore(void) : pImpl(std::make_unique<impl>(this)) {}
-	VulkanCore::~VulkanCore() {  }
-}
-
-namespace CinderVk {
-	const void VulkanCore::tick() {
-		//drawFrame();
-	}
-
-	const void framebufferResizedProc() {
-		//framebufferResizedSwitch()
-	}
-
-	vk::PhysicalDevice* VulkanCore::getPhysicalDevicePtr() const {
-		return &(pImpl->physicalDevice); //this returns nonsense
-	}
-
-	vk::Device* VulkanCore::getLogicalDevicePtr() const {
-		return &(pImpl->device); //same
-	}
-
-	vk::SurfaceKHR* VulkanCore::getSurfacePtr() const {
-		return &(pImpl->surfaceKHR); //make these members public or something?
-	}
-
-	SDL_Window** VulkanCore::getWindowPtrPtr() const {
-		return &(pImpl->window); 
-	}
-
-	vk::Format VulkanCore::getSwapchainImageFormat() const {
-		return pImpl->swapchainPtr->getSwapchainImageFormat();
-	}
-
-	uint32_t VulkanCore::getSwapchainExtentWidth() const {
-		return pImpl->swapchainPtr->getSwapchainExtentWidth();
-	}
-
-	uint32_t VulkanCore::getSwapchainExtentHeight() const {
-		return pImpl->swapchainPtr->getSwapchainExtentHeight();
-	}
-
-	vk::Extent2D VulkanCore::getSwapchainExtent() const {
-		return pImpl->swapchainPtr->getSwapchainExtent();
-	}
-
-	vk::DescriptorSetLayout VulkanCore::getDescriptorSetLayout() const {
-		return pImpl->descriptorSetLayoutPtr->getDescriptorSetLayout();
-	}
-
-	vk::RenderPass VulkanCore::getRenderPass() const {
-		return pImpl->renderpassPtr->getRenderPass();
-	}
-
-
-	void VulkanCore::initVulkan() {
-		pImpl->initVulkan();
-	}
-}
-
+#pragma once
+#include "VulkanCore.h"
+#include "VulkanHelper.h"
+#include "VulkanSwapchain.h"
+#include "VulkanRenderpass.h"
+#include "VulkanDescriptorSetLayout.h"
+#include "VulkanPipelineManager.h"
+#include "VulkanPipelineCache.h"
+#include "ShaderWatcher.h"
+#include "VulkanDeletionQueue.h"
+#include "VulkanTimeline.h"
+#include "VulkanRenderGraph.h"
+#include "VulkanClusteredLighting.h"
+#include "VulkanShadowCache.h"
+#include "VulkanParallelRecorder.h"
+#include "VulkanOffscreenTarget.h"
+#include "VulkanGpuProfiler.h"
+#include "VulkanMemoryStats.h"
+#include "DrawSort.h"
+#include "JobSystem.h"
+#include "Tracer.h"
+#include "VulkanTexture.h"
+#include "vulkan/vulkan.hpp"
+
+#define VMA_IMPLEMENTATION
+#include "vk_mem_alloc.h"
+
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_vulkan.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <set>
+
+
+
+namespace CinderVk {
+	struct VulkanCore::impl { //All VulkanCore inner workings go in here
+
+		class VulkanModelManager {
+
+
+
+
+		};
+
+	public:
+		VulkanCore* parent;
+
+		SDL_Window* window = nullptr;
+		vk::SurfaceKHR surfaceKHR;
+		vk::UniqueInstance instance;
+		vk::PhysicalDevice physicalDevice;
+		vk::Device device;
+		vk::Queue graphicsQueue, presentQueue;
+		vk::CommandPool commandPool;
+		std::vector<vk::CommandBuffer> commandBuffers; //One per frame in flight
+		std::vector<vk::Semaphore> imageAvailableSemaphores, renderFinishedSemaphores;
+		std::vector<uint64_t> frameTimelineValues; //Timeline value each frame slot was last submitted with
+		std::vector<uint64_t> imageTimelineValues; //Same, per swapchain image
+		vk::Sampler textureSampler;
+		vk::Format depthFormat;
+		VmaAllocator allocator;
+
+		std::unique_ptr<vk::DispatchLoaderDynamic> dldiPtr = nullptr;
+		std::unique_ptr<VulkanSwapchain> swapchainPtr = nullptr;
+		std::unique_ptr<VulkanOffscreenTarget> offscreenTargetPtr = nullptr; //Replaces the swapchain when headless
+		std::unique_ptr<VulkanRenderpass> renderpassPtr = nullptr;
+		std::unique_ptr<VulkanDescriptorSetLayout> descriptorSetLayoutPtr = nullptr;
+		std::unique_ptr<VulkanPipelineCache> pipelineCachePtr = nullptr;
+		std::unique_ptr<VulkanPipelineManager> pipelineManagerPtr = nullptr;
+		std::unique_ptr<VulkanModelManager> modelManagerPtr = nullptr;
+		std::unique_ptr<ShaderWatcher> shaderWatcherPtr = nullptr;
+		std::unique_ptr<VulkanTimeline> timelinePtr = nullptr;
+		std::unique_ptr<VulkanRenderGraph> renderGraphPtr = nullptr;
+		std::unique_ptr<VulkanClusteredLighting> clusteredLightingPtr = nullptr;
+		std::unique_ptr<VulkanShadowCache> shadowCachePtr = nullptr;
+		std::unique_ptr<VulkanParallelRecorder> parallelRecorderPtr = nullptr;
+		std::unique_ptr<VulkanGpuProfiler> gpuProfilerPtr = nullptr;
+		std::unique_ptr<VulkanMemoryStats> memoryStatsPtr = nullptr;
+		Cinder::JobSystem* jobSystem = nullptr; //Not owned
+		std::unique_ptr<VulkanDeletionQueue> deletionQueuePtr = std::make_unique<VulkanDeletionQueue>();
+		VkDebugUtilsMessengerEXT debugMessenger = VK_NULL_HANDLE;
+
+		std::chrono::steady_clock::time_point startTime; //For time-to-first-frame, cold vs warm pipeline cache
+		bool firstFrameReported = false;
+		std::function<void()> beforeRecord;
+		std::function<void(uint32_t)> afterGraphCompile;
+		ClusteredLightingResources frameLighting; //This frame's, for writeLightingDescriptors
+		uint32_t frameLightingIndex = 0;
+		std::atomic<bool> framebufferResized{ false }; //Set from the main thread on window resizes, read by the render thread
+		std::atomic<PresentPolicy> presentPolicy{ PresentPolicy::eLowLatency };
+		WindowState windowState; //The ticking thread's copy, recreateSwapchain never asks SDL itself
+		uint64_t frameNumber = 0;
+		uint64_t retiredFrameCount = 0; //Every frame numbered below this has finished on the GPU
+		bool timelineSemaphoresSupported = false;
+		bool pipelineStatisticsSupported = false;
+		bool memoryBudgetSupported = false;
+		std::atomic<bool> depthPrepassEnabled{ false }; //Set by the scene on the main thread
+		bool depthPrepassActive = false; //This frame, enabled and with a pipeline and draws to record
+		uint32_t mainPass = 0;
+
+		const bool headless;
+		const vk::Extent2D headlessExtent;
+		bool readbackEnabled = false;
+		uint32_t lastSubmittedFrameIndex = 0;
+		std::vector<DrawItem> mainPassDraws, drawSortScratch; //Sorted by key
+		std::function<void(DrawStateCache&, uint32_t)> recordMainPassDraw;
+		std::function<void(DrawStateCache&, uint32_t)> recordDepthPrepassDraw;
+
+#ifdef NDEBUG
+		const bool enableValidationLayers = false;
+		const bool enableShaderHotReload = false;
+#else
+		const bool enableValidationLayers = true;
+		const bool enableShaderHotReload = true;
+#endif
+
+		const std::vector<const char*> validationLayers = {
+			"VK_LAYER_KHRONOS_validation"
+		};
+
+		const std::vector<const char*> deviceExtensions = headless ? std::vector<const char*>{ VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME } :
+			std::vector<const char*>{ VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME };
+
+		const uint32_t VULKAN_VERSION = VK_API_VERSION_1_1;
+
+		~impl() {
+			cleanup();
+		}
+
+		impl(VulkanCore* _parent, bool isHeadless = false, vk::Extent2D extent = vk::Extent2D()) : parent(_parent), startTime(std::chrono::steady_clock::now()), headless(isHeadless), headlessExtent(extent) {
+			if (!headless)
+				initWindow();
+			//initVulkan();
+		}
+
+		const void initWindow() {
+			if (SDL_Init(SDL_INIT_VIDEO) != 0)
+				throw std::runtime_error("Failed to initialize SDL.");
+			
+			window = SDL_CreateWindow("Main Window", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 2560, 1440, SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
+		}
+
+		const void initVulkan() {
+			windowState = parent->queryWindowState(); //For the first swapchain, initVulkan runs on the main thread
+			createInstance();
+
+			if (enableValidationLayers)
+				createDebugMessenger();
+
+			if (!headless)
+				createSurface();
+
+			pickPhysicalDevice();
+			createLogicalDevice();
+			setupVmaAllocator();
+			memoryStatsPtr = std::make_unique<VulkanMemoryStats>(parent, allocator, memoryBudgetSupported);
+
+			timelinePtr = std::make_unique<VulkanTimeline>(parent, timelineSemaphoresSupported);
+
+			if (headless)
+				offscreenTargetPtr = std::make_unique<VulkanOffscreenTarget>(parent, headlessExtent);
+			else
+				swapchainPtr = std::make_unique<VulkanSwapchain>(parent, presentPolicy);
+
+			renderpassPtr = std::make_unique<VulkanRenderpass>(parent);
+			descriptorSetLayoutPtr = std::make_unique<VulkanDescriptorSetLayout>(parent);
+			pipelineCachePtr = std::make_unique<VulkanPipelineCache>(parent);
+
+			auto pipelineStart = std::chrono::steady_clock::now();
+			pipelineManagerPtr = std::make_unique<VulkanPipelineManager>(parent);
+			std::cout << "Graphics pipelines created in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pipelineStart).count()
+				<< " ms (" << (pipelineCachePtr->wasLoadedFromDisk() ? "warm" : "cold") << " pipeline cache)" << std::endl;
+
+			depthFormat = Helper::findDepthFormat(physicalDevice);
+			renderGraphPtr = std::make_unique<VulkanRenderGraph>(parent);
+			gpuProfilerPtr = std::make_unique<VulkanGpuProfiler>(parent, pipelineStatisticsSupported);
+			renderGraphPtr->setProfiler(gpuProfilerPtr.get());
+
+			clusteredLightingPtr = std::make_unique<VulkanClusteredLighting>(parent); //fragmentShader reads the cluster lists, there is nothing to fall back to
+
+			shadowCachePtr = std::make_unique<VulkanShadowCache>(parent);
+			parallelRecorderPtr = std::make_unique<VulkanParallelRecorder>(parent, jobSystem);
+
+			if (enableShaderHotReload) {
+				try {
+					shaderWatcherPtr = std::make_unique<ShaderWatcher>();
+				}
+				catch (const std::exception& e) { //Not worth failing startup over
+					std::cerr << "Shader hot reload disabled: " << e.what() << std::endl;
+				}
+			}
+
+			createCommandPool();
+			createTextureSampler();
+
+			//loadModels();
+			//Load in a scene here
+
+
+			//Call these on scene change
+			//createUniformBuffers(); //each VulkanModel should manage their own
+			//Create uniform buffers should be done with push constants in every VulkanModel
+			//createLightingBuffer();
+			//createDescriptorPool();
+			//createDescriptorSets();
+			createCommandBuffers();
+			createSyncObjects();
+
+		}
+
+		const void createInstance() {
+			if (enableValidationLayers && ![&]() -> bool { //If validation layers are enabled but they are not supported, throw a runtime error.
+				auto availableLayers = vk::enumerateInstanceLayerProperties();
+
+				for (const char* layerName : validationLayers) {
+					bool layerFound = false;
+
+					for (const auto& layerProperties : availableLayers) {
+						if (strcmp(layerName, layerProperties.layerName) == 0) {
+							layerFound = true;
+							break;
+						}
+					}
+
+					if (!layerFound)
+						return false;
+				}
+
+				return true;
+			}()) throw std::runtime_error("Validation layers requested but not available.");
+
+			vk::ApplicationInfo applicationInfo("Cinder", 1, "Cinderkapsule", 1, VULKAN_VERSION); //1.1 for VMA atm
+
+			auto extensions = getRequiredExtensions();
+
+			vk::InstanceCreateInfo createInfo(
+				{},
+				&applicationInfo,
+				0, nullptr,
+				static_cast<uint32_t>(extensions.size()), extensions.data()
+			);
+
+			if (enableValidationLayers) {
+				vk::DebugUtilsMessengerCreateInfoEXT debugCreateInfo(vk::DebugUtilsMessengerCreateFlagsEXT(), 
+					vk::DebugUtilsMessageSeverityFlagsEXT(),
+					vk::DebugUtilsMessageTypeFlagsEXT(),
+					debugCallback, nullptr
+				);
+
+				createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
+				createInfo.ppEnabledLayerNames = validationLayers.data();
+
+				createInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)&debugCreateInfo;
+			}
+			else {
+				createInfo.enabledLayerCount = 0;
+				createInfo.pNext = nullptr;
+			}
+
+			try {
+				instance = vk::createInstanceUnique(createInfo, nullptr);
+				dldiPtr = std::make_unique<vk::DispatchLoaderDynamic>(*instance, vkGetInstanceProcAddr);
+			}
+			catch (vk::SystemError err) {
+				throw std::runtime_error("failed to create instance!");
+			}
+		}
+
+		const void createDebugMessenger() {
+			if (!enableValidationLayers) return; 
+
+			const vk::DebugUtilsMessengerCreateInfoEXT debugCreateInfo({}, vk::DebugUtilsMessageSeverityFlagBitsEXT::eError | vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning,
+				vk::DebugUtilsMessageTypeFlagBitsEXT::eGeneral | vk::DebugUtilsMessageTypeFlagBitsEXT::ePerformance | vk::DebugUtilsMessageTypeFlagBitsEXT::eValidation,
+				debugCallback, nullptr
+			);
+
+			debugMessenger = instance->createDebugUtilsMessengerEXT(debugCreateInfo, nullptr, *dldiPtr);
+		}
+
+		const void createCommandPool() {
+			Helper::QueueFamilyIndices queueFamilyIndices = Helper::findQueueFamilies(physicalDevice, surfaceKHR);
+
+			vk::CommandPoolCreateInfo poolInfo{};
+			poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+			poolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+
+			if (device.createCommandPool(&poolInfo, nullptr, &commandPool) != vk::Result::eSuccess) {
+				throw std::runtime_error("Failed to create command pool.");
+			}
+		}
+
+		const void createCommandBuffers() {
+			commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+
+			vk::CommandBufferAllocateInfo allocInfo{};
+			allocInfo.commandPool = commandPool;
+			allocInfo.level = vk::CommandBufferLevel::ePrimary;
+			allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+
+			if (device.allocateCommandBuffers(&allocInfo, commandBuffers.data()) != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to allocate command buffers.");
+		}
+
+		const void createSyncObjects() {
+			imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+			renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+			frameTimelineValues.assign(MAX_FRAMES_IN_FLIGHT, 0); //0 is always complete
+			imageTimelineValues.assign(headless ? offscreenTargetPtr->getImageCount() : swapchainPtr->getImageCount(), 0);
+
+			vk::SemaphoreCreateInfo semaphoreInfo{};
+
+			for (size_t i = 0; i != MAX_FRAMES_IN_FLIGHT; i++) {
+				if (device.createSemaphore(&semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != vk::Result::eSuccess ||
+					device.createSemaphore(&semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != vk::Result::eSuccess)
+					throw std::runtime_error("Failed to create frame synchronisation objects.");
+			}
+		}
+
+		const void createTextureSampler() {
+			vk::SamplerCreateInfo samplerInfo{};
+			samplerInfo.magFilter = vk::Filter::eLinear;
+			samplerInfo.minFilter = vk::Filter::eLinear;
+			samplerInfo.addressModeU = vk::SamplerAddressMode::eRepeat;
+			samplerInfo.addressModeV = vk::SamplerAddressMode::eRepeat;
+			samplerInfo.addressModeW = vk::SamplerAddressMode::eRepeat;
+			samplerInfo.anisotropyEnable = VK_TRUE;
+			samplerInfo.maxAnisotropy = 16.0f;
+			samplerInfo.borderColor = vk::BorderColor::eIntOpaqueBlack;
+			samplerInfo.unnormalizedCoordinates = VK_FALSE;
+			samplerInfo.compareEnable = VK_FALSE;
+			samplerInfo.compareOp = vk::CompareOp::eAlways;
+			samplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
+			samplerInfo.mipLodBias = 0.0f;
+			samplerInfo.minLod = 0.0f;
+			samplerInfo.maxLod = 0.0f;
+
+			if (device.createSampler(&samplerInfo, nullptr, &textureSampler) != vk::Result::eSuccess) {
+				throw std::runtime_error("Failed to create texture sampler.");
+			}
+		}
+
+		void createSurface() {
+			SDL_bool r = SDL_Vulkan_CreateSurface(window, VkInstance(instance.get()), reinterpret_cast<VkSurfaceKHR*>(&surfaceKHR));
+			if (r != SDL_TRUE)
+				throw std::runtime_error("Failed to create Vulkan surface on the SDL window.");
+		}
+
+		const void createLogicalDevice() {
+			Helper::QueueFamilyIndices indices = Helper::findQueueFamilies(physicalDevice, surfaceKHR);
+
+			std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
+			std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+
+			float queuePriority = 1.0f;
+			for (uint32_t queueFamily : uniqueQueueFamilies) {
+				vk::DeviceQueueCreateInfo queueCreateInfo({}, queueFamily, 1, &queuePriority);
+				queueCreateInfos.push_back(queueCreateInfo);
+			}
+
+			vk::PhysicalDeviceFeatures deviceFeatures{};
+			deviceFeatures.samplerAnisotropy = VK_TRUE;
+			deviceFeatures.shaderUniformBufferArrayDynamicIndexing = VK_TRUE;
+
+			pipelineStatisticsSupported = physicalDevice.getFeatures().pipelineStatisticsQuery; //Optional, the GPU profiler records timestamps only without it
+			deviceFeatures.pipelineStatisticsQuery = pipelineStatisticsSupported;
+
+			vk::PhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+			indexingFeatures.pNext = nullptr;
+			indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+			indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+
+			std::vector<const char*> enabledExtensions = deviceExtensions;
+
+			memoryBudgetSupported = checkDeviceExtensionSupport(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+			if (memoryBudgetSupported) //Optional, real per-heap budgets for VulkanMemoryStats instead of estimates
+				enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+			vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures{};
+			timelineSemaphoresSupported = checkTimelineSemaphoreSupport(physicalDevice);
+
+			if (timelineSemaphoresSupported) { //Optional, VulkanTimeline falls back to fences without it
+				enabledExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+				timelineFeatures.timelineSemaphore = VK_TRUE;
+				indexingFeatures.pNext = &timelineFeatures;
+			}
+
+			vk::DeviceCreateInfo createInfo{};
+			createInfo.pQueueCreateInfos = queueCreateInfos.data();
+			createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+			createInfo.pEnabledFeatures = &deviceFeatures;
+			createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+			createInfo.ppEnabledExtensionNames = enabledExtensions.data();
+
+			createInfo.pNext = &indexingFeatures;
+
+			if (enableValidationLayers) {
+				createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
+				createInfo.ppEnabledLayerNames = validationLayers.data();
+			} else createInfo.enabledLayerCount = 0;
+
+			device = physicalDevice.createDevice(createInfo);
+
+			if (device == VK_NULL_HANDLE) //Might need to be nullptr
+				throw std::runtime_error("Failed to create logical device.");
+
+			device.getQueue(indices.graphicsFamily.value(), 0, &graphicsQueue);
+			device.getQueue(indices.presentFamily.value(), 0, &presentQueue);
+		}
+
+		const void setupVmaAllocator() {
+			VmaAllocatorCreateInfo allocatorInfo{};
+			allocatorInfo.vulkanApiVersion = VULKAN_VERSION;
+			allocatorInfo.physicalDevice = physicalDevice;
+			allocatorInfo.device = device;
+			allocatorInfo.instance = *instance;
+			allocatorInfo.flags = memoryBudgetSupported ? VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT : 0;
+
+			if (vmaCreateAllocator(&allocatorInfo, &allocator) != VK_SUCCESS)
+				throw std::runtime_error("VMA allocator could not be created.");
+		}
+
+		const void loadModels() {
+
+
+
+
+
+		}
+
+		const void recreateSwapchain() {
+			if (windowState.minimised) //Zero sized extent, try again once the window is restored
+				return;
+
+			framebufferResized = false;
+			{
+				auto queueLock = timelinePtr->lockQueues(); //Uploads on other threads submit to the same queues
+				device.waitIdle();
+			}
+
+			vk::Format oldFormat = swapchainPtr->getSwapchainImageFormat();
+			swapchainPtr->setPresentPolicy(presentPolicy);
+			swapchainPtr->recreate();
+
+			if (swapchainPtr->getSwapchainImageFormat() != oldFormat) { //Rare, e.g. moving to an HDR display, the render pass is no longer compatible
+				pipelineManagerPtr.reset();
+				renderpassPtr = std::make_unique<VulkanRenderpass>(parent);
+				pipelineManagerPtr = std::make_unique<VulkanPipelineManager>(parent);
+			}
+
+			renderGraphPtr->invalidateFramebuffers(); //Old swapchain views are gone, their handles may be reused
+			imageTimelineValues.assign(swapchainPtr->getImageCount(), 0);
+		}
+
+		const void buildRenderGraph(uint32_t frameIndex, uint32_t imageIndex) { //Rebuilt every frame, compile reuses memory, render passes and framebuffers while nothing changes
+			CINDER_TRACE_SCOPE("buildRenderGraph");
+			renderGraphPtr->reset();
+
+			vk::Extent2D extent = parent->getSwapchainExtent();
+
+			RenderGraphImageDesc backbufferDesc{};
+			backbufferDesc.format = parent->getSwapchainImageFormat();
+			backbufferDesc.extent = extent;
+			backbufferDesc.clearValue.color = vk::ClearColorValue(std::array<float, 4>{ 0.0f, 0.0f, 0.0f, 1.0f });
+
+			RenderGraphResource backbuffer;
+			if (headless) //Left ready to copy out, whether or not readback is on this frame
+				backbuffer = renderGraphPtr->importImage("backbuffer", offscreenTargetPtr->getImage(imageIndex), offscreenTargetPtr->getImageView(imageIndex),
+					backbufferDesc, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferSrcOptimal);
+			else
+				backbuffer = renderGraphPtr->importImage("backbuffer", swapchainPtr->getImage(imageIndex), swapchainPtr->getImageView(imageIndex),
+					backbufferDesc, vk::ImageLayout::eUndefined, vk::ImageLayout::ePresentSrcKHR);
+
+			RenderGraphImageDesc depthDesc{};
+			depthDesc.format = depthFormat;
+			depthDesc.extent = extent;
+			depthDesc.clearValue.depthStencil = vk::ClearDepthStencilValue(1.0f, 0);
+
+			RenderGraphResource depth = renderGraphPtr->createImage("depth", depthDesc);
+
+			ClusteredLightingResources lighting = clusteredLightingPtr->addPasses(*renderGraphPtr, frameIndex, extent);
+
+			RenderGraphResource shadowAtlas = shadowCachePtr->addPasses(*renderGraphPtr, frameIndex);
+
+			vk::Pipeline depthPrepassPipeline;
+			if (depthPrepassEnabled && recordDepthPrepassDraw && !pipelineManagerPtr->hasPipelineFailed(pipelineManagerPtr->getDepthPrepassKey())) {
+				try {
+					depthPrepassPipeline = pipelineManagerPtr->getPipeline(pipelineManagerPtr->getDepthPrepassKey());
+				}
+				catch (const std::exception& e) { //Failed keys aren't rebuilt until the shader changes, draw without the pre-pass meanwhile
+					std::cerr << "Depth pre-pass skipped: " << e.what() << std::endl;
+				}
+			}
+
+			depthPrepassActive = static_cast<bool>(depthPrepassPipeline);
+
+			if (depthPrepassActive) { //Opaque depth first, the main pass then shades each pixel once with eEqual and no depth writes
+				renderGraphPtr->addPass("depthPrepass", [&](RenderGraphPassBuilder& builder) {
+					builder.write(depth, ResourceUsage::eDepthAttachment, true);
+				}, [this, depthPrepassPipeline](vk::CommandBuffer& commandBuffer) {
+					DrawStateCache state(commandBuffer);
+					state.bindPipeline(depthPrepassPipeline); //Shared by every pre-pass draw, recordDepthPrepassDraw only binds buffers
+
+					for (const auto& draw : mainPassDraws)
+						recordDepthPrepassDraw(state, draw.drawIndex);
+				});
+			}
+
+			mainPass = renderGraphPtr->addPass("main", [&](RenderGraphPassBuilder& builder) {
+				builder.write(backbuffer, ResourceUsage::eColorAttachment, true);
+				builder.setSecondaryCommandBuffers();
+
+				if (depthPrepassActive)
+					builder.read(depth, ResourceUsage::eDepthAttachmentRead);
+				else
+					builder.write(depth, ResourceUsage::eDepthAttachment, true);
+
+				builder.read(lighting.pointLights, ResourceUsage::eShaderRead);
+				builder.read(lighting.clusterGrid, ResourceUsage::eShaderRead);
+				builder.read(lighting.clusterLightIndices, ResourceUsage::eShaderRead);
+
+				builder.read(shadowAtlas, ResourceUsage::eShaderRead);
+			}, [this, frameIndex](vk::CommandBuffer& commandBuffer) { //recordMainPassDraw picks its keys through getMainPassKey
+				parallelRecorderPtr->record(commandBuffer, frameIndex, renderGraphPtr->getPassRenderPass(mainPass), renderGraphPtr->getPassFramebuffer(mainPass),
+					renderGraphPtr->getPassExtent(mainPass), recordMainPassDraw ? mainPassDraws.size() : 0, [this](DrawStateCache& state, size_t begin, size_t end) {
+						for (size_t i = begin; i != end; i++)
+							recordMainPassDraw(state, mainPassDraws[i].drawIndex);
+					});
+			});
+
+			if (headless && readbackEnabled) {
+				renderGraphPtr->addPass("readback", [&](RenderGraphPassBuilder& builder) {
+					builder.read(backbuffer, ResourceUsage::eTransferSrc);
+					builder.setSideEffects();
+				}, [this, imageIndex, extent](vk::CommandBuffer& commandBuffer) {
+					vk::BufferImageCopy region{};
+					region.imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+					region.imageExtent = vk::Extent3D(extent.width, extent.height, 1);
+
+					vk::Buffer readbackBuffer = offscreenTargetPtr->getReadbackBuffer(imageIndex);
+					commandBuffer.copyImageToBuffer(offscreenTargetPtr->getImage(imageIndex), vk::ImageLayout::eTransferSrcOptimal, readbackBuffer, 1, &region);
+
+					vk::BufferMemoryBarrier hostBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, readbackBuffer, 0, VK_WHOLE_SIZE);
+					commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+				});
+			}
+
+			renderGraphPtr->compile();
+			frameLighting = lighting;
+			frameLightingIndex = frameIndex;
+
+			if (afterGraphCompile) { //Before any pass records, so descriptor sets the passes bind aren't updated mid command buffer
+				CINDER_TRACE_SCOPE("afterGraphCompile");
+				afterGraphCompile(frameIndex);
+			}
+		}
+
+		const void recordCommandBuffer(vk::CommandBuffer& commandBuffer, uint32_t frameIndex, uint32_t imageIndex) {
+			vk::CommandBufferBeginInfo beginInfo{};
+			beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+			commandBuffer.begin(&beginInfo);
+
+			gpuProfilerPtr->beginFrame(commandBuffer, frameIndex);
+			buildRenderGraph(frameIndex, imageIndex);
+
+			{
+				GpuScope frameScope(gpuProfilerPtr.get(), commandBuffer, "frame", false); //Statistics are left to the passes, they can't nest
+				renderGraphPtr->execute(commandBuffer);
+			}
+
+			commandBuffer.end();
+		}
+
+		const void drawFrame() {
+			if (!swapchainPtr && !offscreenTargetPtr) //initVulkan hasn't run
+				return;
+
+			if (framebufferResized || (swapchainPtr && swapchainPtr->getPresentPolicy() != presentPolicy))
+				recreateSwapchain();
+
+			if (shaderWatcherPtr) {
+				std::vector<std::string> changedShaders = shaderWatcherPtr->takeChangedShaders();
+
+				if (!changedShaders.empty())
+					pipelineManagerPtr->reloadShaders(changedShaders);
+			}
+
+			uint32_t frameIndex = frameNumber % MAX_FRAMES_IN_FLIGHT;
+
+			{
+				CINDER_TRACE_SCOPE("waitForFrameSlot");
+				if (!timelinePtr->wait(frameTimelineValues[frameIndex]))
+					throw std::runtime_error("Failed waiting on a frame's timeline value.");
+			}
+
+			retiredFrameCount = frameNumber >= MAX_FRAMES_IN_FLIGHT ? frameNumber - MAX_FRAMES_IN_FLIGHT + 1 : 0; //The value just waited on belonged to this frame
+			deletionQueuePtr->collect(retiredFrameCount);
+			memoryStatsPtr->update(frameNumber);
+
+			pipelineManagerPtr->update(frameNumber); //Frame boundary, reloaded pipelines swap in here
+
+			uint32_t imageIndex = frameIndex; //Headless has one image per frame slot
+			vk::Result result = vk::Result::eSuccess;
+
+			if (!headless) {
+				CINDER_TRACE_SCOPE("acquireNextImage");
+				result = device.acquireNextImageKHR(swapchainPtr->getSwapchain(), UINT64_MAX, imageAvailableSemaphores[frameIndex], nullptr, &imageIndex);
+
+				if (result == vk::Result::eErrorOutOfDateKHR) {
+					recreateSwapchain();
+					return;
+				}
+				else if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR)
+					throw std::runtime_error("Failed to acquire a swapchain image.");
+			}
+
+			timelinePtr->wait(imageTimelineValues[imageIndex]); //An earlier frame slot may still be rendering to this image
+
+			if (beforeRecord) { //Nothing left that can block, the latest point to sample the camera
+				CINDER_TRACE_SCOPE("beforeRecord");
+				beforeRecord();
+			}
+
+			{
+				CINDER_TRACE_SCOPE("recordCommandBuffer");
+				commandBuffers[frameIndex].reset(vk::CommandBufferResetFlags());
+				parallelRecorderPtr->beginFrame(frameIndex);
+				recordCommandBuffer(commandBuffers[frameIndex], frameIndex, imageIndex);
+			}
+
+			TimelineSubmitInfo submitInfo{};
+			submitInfo.commandBuffers = { commandBuffers[frameIndex] };
+
+			if (!headless) {
+				submitInfo.waitSemaphores = { imageAvailableSemaphores[frameIndex] };
+				submitInfo.waitStages = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
+				submitInfo.signalSemaphores = { renderFinishedSemaphores[frameIndex] };
+			}
+
+			{
+				CINDER_TRACE_SCOPE("submit");
+				frameTimelineValues[frameIndex] = timelinePtr->submit(graphicsQueue, submitInfo);
+			}
+
+			gpuProfilerPtr->markSubmitted(frameIndex);
+			imageTimelineValues[imageIndex] = frameTimelineValues[frameIndex];
+			lastSubmittedFrameIndex = frameIndex;
+
+			if (headless) {
+				finishFrame();
+				return;
+			}
+
+			vk::SwapchainKHR swapchain = swapchainPtr->getSwapchain();
+
+			vk::PresentInfoKHR presentInfo{};
+			presentInfo.waitSemaphoreCount = 1;
+			presentInfo.pWaitSemaphores = &renderFinishedSemaphores[frameIndex];
+			presentInfo.swapchainCount = 1;
+			presentInfo.pSwapchains = &swapchain;
+			presentInfo.pImageIndices = &imageIndex;
+
+			{
+				CINDER_TRACE_SCOPE("present");
+				auto queueLock = timelinePtr->lockQueues(); //The present queue may be the graphics queue uploads submit to
+				result = presentQueue.presentKHR(&presentInfo);
+			}
+
+			if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR)
+				framebufferResized = true;
+			else if (result != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to present the swapchain image.");
+
+			finishFrame();
+		}
+
+		const void finishFrame() {
+			if (!firstFrameReported && recordMainPassDraw && !mainPassDraws.empty()) { //A frame with nothing to draw binds no pipelines, it would only time startup
+				firstFrameReported = true;
+				std::cout << "Time to first frame: " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count()
+					<< " ms (" << (pipelineCachePtr && pipelineCachePtr->wasLoadedFromDisk() ? "warm" : "cold") << " pipeline cache)" << std::endl;
+			}
+
+			frameNumber++;
+		}
+
+		const void cleanup() {
+			if (device) { //Init may have failed before the device existed, nothing below it was created either
+				device.waitIdle();
+
+				shaderWatcherPtr.reset();
+				deletionQueuePtr->flush();
+
+				for (size_t i = 0; i != imageAvailableSemaphores.size(); i++) {
+					device.destroySemaphore(imageAvailableSemaphores[i], nullptr);
+					device.destroySemaphore(renderFinishedSemaphores[i], nullptr);
+				}
+
+				timelinePtr.reset();
+
+				device.destroyCommandPool(commandPool, nullptr);
+
+				parallelRecorderPtr.reset();
+				shadowCachePtr.reset();
+				clusteredLightingPtr.reset();
+				renderGraphPtr.reset();
+				gpuProfilerPtr.reset();
+				swapchainPtr.reset();
+				offscreenTargetPtr.reset();
+				pipelineManagerPtr.reset();
+				pipelineCachePtr.reset(); //Writes the cache back to disk
+				descriptorSetLayoutPtr.reset();
+				renderpassPtr.reset();
+				memoryStatsPtr.reset();
+				device.destroy(nullptr);
+			}
+
+			if (enableValidationLayers && debugMessenger != VK_NULL_HANDLE)
+				instance->destroyDebugUtilsMessengerEXT(debugMessenger, nullptr, *dldiPtr);
+
+			if (surfaceKHR)
+				instance->destroySurfaceKHR(surfaceKHR, nullptr);
+
+			if (!headless) {
+				SDL_DestroyWindow(window);
+				SDL_Quit();
+			}
+		}
+
+		static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
+			VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+			VkDebugUtilsMessageTypeFlagsEXT messageType,
+			const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
+			void* pUserData
+		) {
+			std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
+			return VK_FALSE;
+		}
+
+		void pickPhysicalDevice() {
+			auto physicalDevices = instance->enumeratePhysicalDevices();
+
+			if (physicalDevices.empty()) throw std::runtime_error("Failed to find GPUs with Vulkan support.");
+
+			for (const auto& device : physicalDevices) {
+				if (isDeviceSuitable(device)) {
+					physicalDevice = device;
+					break;
+				}
+			}
+
+			if (physicalDevice == VK_NULL_HANDLE) throw std::runtime_error("Failed to find a suitable GPU.");
+		}
+
+		bool isDeviceSuitable(vk::PhysicalDevice device) {
+			Helper::QueueFamilyIndices indices = Helper::findQueueFamilies(device, surfaceKHR);
+
+			bool swapchainAdequate = headless;
+			bool extensionsSupported = checkDeviceExtensionSupport(device);
+			
+			if (extensionsSupported && !headless) {
+				Helper::SwapchainSupportDetails swapchainSupport = Helper::querySwapchainSupport(device, surfaceKHR);
+				swapchainAdequate = !swapchainSupport.formats.empty() && !swapchainSupport.presentModes.empty();
+			}
+
+			VkPhysicalDeviceFeatures supportedFeatures = device.getFeatures();
+			
+			return indices.isComplete() && extensionsSupported && swapchainAdequate && supportedFeatures.samplerAnisotropy;
+		}
+
+		bool checkDeviceExtensionSupport(vk::PhysicalDevice device) {
+			auto availableExtensions = device.enumerateDeviceExtensionProperties();
+
+			std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+
+			for (const auto& extension : availableExtensions)
+				requiredExtensions.erase(extension.extensionName);
+
+			return requiredExtensions.empty();
+		}
+
+		bool checkDeviceExtensionSupport(vk::PhysicalDevice device, const char* extensionName) {
+			for (const auto& extension : device.enumerateDeviceExtensionProperties())
+				if (strcmp(extension.extensionName, extensionName) == 0)
+					return true;
+
+			return false;
+		}
+
+		bool checkTimelineSemaphoreSupport(vk::PhysicalDevice device) {
+			auto availableExtensions = device.enumerateDeviceExtensionProperties();
+
+			bool extensionFound = false;
+			for (const auto& extension : availableExtensions)
+				if (strcmp(extension.extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0)
+					extensionFound = true;
+
+			if (!extensionFound)
+				return false;
+
+			vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures{};
+			vk::PhysicalDeviceFeatures2 features2{};
+			features2.pNext = &timelineFeatures;
+			device.getFeatures2(&features2);
+
+			return timelineFeatures.timelineSemaphore;
+		}
+
+		std::vector<const char*> getRequiredExtensions() { //Get the required extensions.
+			if (headless) //No surface, no window system extensions
+				return enableValidationLayers ? std::vector<const char*>{ VK_EXT_DEBUG_UTILS_EXTENSION_NAME } : std::vector<const char*>{};
+
+			uint32_t sdlExtensionCount = 0;
+			const char** sdlExtensions = NULL;
+			SDL_Vulkan_GetInstanceExtensions(window, &sdlExtensionCount, sdlExtensions);
+			sdlExtensions = new const char* [sdlExtensionCount];
+
+			if (!SDL_Vulkan_GetInstanceExtensions(window, &sdlExtensionCount, sdlExtensions))
+				throw std::runtime_error("Failed to get SDL instance extensions for Vulkan.");
+
+			std::vector<const char*> extensions(sdlExtensions, sdlExtensions + sdlExtensionCount);
+			delete[] sdlExtensions;
+
+			if (enableValidationLayers)
+				extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+
+			return extensions;
+		}
+
+		//void framebufferResizedSwitch();
+	};
+
+	VulkanCore::VulkanCore(void) : pImpl(std::make_unique<impl>(this)) {}
+	VulkanCore::VulkanCore(uint32_t headlessWidth, uint32_t headlessHeight) : pImpl(std::make_unique<impl>(this, true, vk::Extent2D(headlessWidth, headlessHeight))) {}
+	VulkanCore::~VulkanCore() {  }
+}
+
+namespace CinderVk {
+	const void VulkanCore::tick() {
+		CINDER_TRACE_SCOPE("VulkanCore::tick");
+		pImpl->drawFrame();
+	}
+
+	const void VulkanCore::framebufferResizedSwitch() {
+		pImpl->framebufferResized = true;
+	}
+
+	vk::PhysicalDevice* VulkanCore::getPhysicalDevicePtr() const {
+		return &(pImpl->physicalDevice); //this returns nonsense
+	}
+
+	vk::Device* VulkanCore::getLogicalDevicePtr() const {
+		return &(pImpl->device); //same
+	}
+
+	vk::Queue* VulkanCore::getGraphicsQueuePtr() const {
+		return &(pImpl->graphicsQueue);
+	}
+
+	vk::CommandPool* VulkanCore::getCommandPoolPtr() const {
+		return &(pImpl->commandPool);
+	}
+
+	vk::SurfaceKHR* VulkanCore::getSurfacePtr() const {
+		return &(pImpl->surfaceKHR); //make these members public or something?
+	}
+
+	SDL_Window** VulkanCore::getWindowPtrPtr() const {
+		return &(pImpl->window); 
+	}
+
+	vk::Format VulkanCore::getSwapchainImageFormat() const {
+		if (pImpl->headless)
+			return pImpl->offscreenTargetPtr->getFormat();
+
+		return pImpl->swapchainPtr->getSwapchainImageFormat();
+	}
+
+	uint32_t VulkanCore::getSwapchainExtentWidth() const {
+		return getSwapchainExtent().width;
+	}
+
+	uint32_t VulkanCore::getSwapchainExtentHeight() const {
+		return getSwapchainExtent().height;
+	}
+
+	vk::Extent2D VulkanCore::getSwapchainExtent() const { //The offscreen target's when headless
+		if (pImpl->headless)
+			return pImpl->offscreenTargetPtr->getExtent();
+
+		return pImpl->swapchainPtr->getSwapchainExtent();
+	}
+
+	vk::DescriptorSetLayout VulkanCore::getDescriptorSetLayout() const {
+		return pImpl->descriptorSetLayoutPtr->getDescriptorSetLayout();
+	}
+
+	vk::RenderPass VulkanCore::getRenderPass() const {
+		return pImpl->renderpassPtr->getRenderPass();
+	}
+
+	vk::RenderPass VulkanCore::getDepthOnlyRenderPass() const {
+		return pImpl->renderpassPtr->getDepthOnlyRenderPass();
+	}
+
+	vk::PipelineCache VulkanCore::getPipelineCache() const {
+		return pImpl->pipelineCachePtr->getPipelineCache();
+	}
+
+	VulkanPipelineManager* VulkanCore::getPipelineManagerPtr() const {
+		return pImpl->pipelineManagerPtr.get();
+	}
+
+	uint64_t VulkanCore::getFrameNumber() const {
+		return pImpl->frameNumber;
+	}
+
+	uint64_t VulkanCore::getRetiredFrameCount() const {
+		return pImpl->retiredFrameCount;
+	}
+
+	uint64_t VulkanCore::getLastFrameTimelineValue() const {
+		return pImpl->frameTimelineValues[pImpl->lastSubmittedFrameIndex];
+	}
+
+	VulkanDeletionQueue* VulkanCore::getDeletionQueuePtr() const {
+		return pImpl->deletionQueuePtr.get();
+	}
+
+	VulkanTimeline* VulkanCore::getTimelinePtr() const {
+		return pImpl->timelinePtr.get();
+	}
+
+	VulkanRenderGraph* VulkanCore::getRenderGraphPtr() const {
+		return pImpl->renderGraphPtr.get();
+	}
+
+	VulkanClusteredLighting* VulkanCore::getClusteredLightingPtr() const {
+		return pImpl->clusteredLightingPtr.get();
+	}
+
+	VulkanShadowCache* VulkanCore::getShadowCachePtr() const {
+		return pImpl->shadowCachePtr.get();
+	}
+
+	VulkanParallelRecorder* VulkanCore::getParallelRecorderPtr() const {
+		return pImpl->parallelRecorderPtr.get();
+	}
+
+	VulkanMemoryStats* VulkanCore::getMemoryStatsPtr() const {
+		return pImpl->memoryStatsPtr.get();
+	}
+
+	VulkanGpuProfiler* VulkanCore::getGpuProfilerPtr() const {
+		return pImpl->gpuProfilerPtr.get();
+	}
+
+	void VulkanCore::setJobSystem(Cinder::JobSystem* jobs) {
+		pImpl->jobSystem = jobs;
+	}
+
+	void VulkanCore::setMainPassDraws(const std::vector<DrawItem>& draws, const std::function<void(DrawStateCache&, uint32_t)>& recordDraw, const std::function<void(DrawStateCache&, uint32_t)>& recordDepthDraw) {
+		pImpl->mainPassDraws = draws;
+		pImpl->recordMainPassDraw = recordDraw;
+		pImpl->recordDepthPrepassDraw = recordDepthDraw;
+		DrawSort::sort(pImpl->mainPassDraws, pImpl->drawSortScratch, pImpl->jobSystem);
+	}
+
+	void VulkanCore::setCamera(const glm::mat4& view, const glm::mat4& projection, float zNear, float zFar) {
+		if (pImpl->clusteredLightingPtr)
+			pImpl->clusteredLightingPtr->setCamera(view, projection, zNear, zFar);
+
+		if (pImpl->shadowCachePtr)
+			pImpl->shadowCachePtr->setCamera(view, projection);
+	}
+
+	void VulkanCore::setBeforeRecordCallback(const std::function<void()>& callback) {
+		pImpl->beforeRecord = callback;
+	}
+
+	void VulkanCore::setAfterGraphCompileCallback(const std::function<void(uint32_t)>& callback) {
+		pImpl->afterGraphCompile = callback;
+	}
+
+	void VulkanCore::writeLightingDescriptors(vk::DescriptorSet set) const {
+		pImpl->clusteredLightingPtr->writeShadingDescriptors(*pImpl->renderGraphPtr, pImpl->frameLighting, set);
+		pImpl->shadowCachePtr->writeShadingDescriptors(pImpl->frameLightingIndex, set);
+	}
+
+	void VulkanCore::setLights(const std::vector<PointLight>& lights) {
+		if (pImpl->clusteredLightingPtr)
+			pImpl->clusteredLightingPtr->setLights(lights);
+	}
+
+	void VulkanCore::setShadowLights(const std::vector<ShadowLight>& lights) {
+		if (pImpl->shadowCachePtr)
+			pImpl->shadowCachePtr->setLights(lights);
+	}
+
+	void VulkanCore::setShadowCasterCallback(const std::function<void(vk::CommandBuffer&, vk::PipelineLayout, bool)>& callback) {
+		if (pImpl->shadowCachePtr)
+			pImpl->shadowCachePtr->setCasterCallback(callback);
+	}
+
+	void VulkanCore::invalidateStaticShadows() {
+		if (pImpl->shadowCachePtr)
+			pImpl->shadowCachePtr->invalidateStatic();
+	}
+
+	void VulkanCore::setPresentPolicy(PresentPolicy policy) {
+		pImpl->presentPolicy = policy;
+	}
+
+	PresentPolicy VulkanCore::getPresentPolicy() const {
+		return pImpl->presentPolicy;
+	}
+
+	uint32_t VulkanCore::getDisplayRefreshRate() const {
+		SDL_DisplayMode mode{};
+		if (!pImpl->window || SDL_GetWindowDisplayMode(pImpl->window, &mode) != 0)
+			return 0;
+
+		return mode.refresh_rate > 0 ? static_cast<uint32_t>(mode.refresh_rate) : 0;
+	}
+
+	WindowState VulkanCore::queryWindowState() const {
+		WindowState state;
+		if (!pImpl->window)
+			return state;
+
+		int width, height;
+		SDL_Vulkan_GetDrawableSize(pImpl->window, &width, &height);
+
+		state.minimised = (SDL_GetWindowFlags(pImpl->window) & SDL_WINDOW_MINIMIZED) != 0;
+		state.drawableWidth = static_cast<uint32_t>(width);
+		state.drawableHeight = static_cast<uint32_t>(height);
+		return state;
+	}
+
+	void VulkanCore::setWindowState(const WindowState& state) {
+		pImpl->windowState = state;
+	}
+
+	const WindowState& VulkanCore::getWindowState() const {
+		return pImpl->windowState;
+	}
+
+	bool VulkanCore::isHeadless() const {
+		return pImpl->headless;
+	}
+
+	void VulkanCore::setReadbackEnabled(bool enabled) {
+		pImpl->readbackEnabled = enabled;
+	}
+
+	bool VulkanCore::readbackLastFrame(std::vector<uint8_t>& rgba) const {
+		if (!pImpl->headless || !pImpl->readbackEnabled || pImpl->frameNumber == 0)
+			return false;
+
+		uint32_t frameIndex = pImpl->lastSubmittedFrameIndex;
+		if (!pImpl->timelinePtr->wait(pImpl->frameTimelineValues[frameIndex]))
+			return false;
+
+		pImpl->offscreenTargetPtr->copyReadback(frameIndex, rgba);
+		return true;
+	}
+
+	void VulkanCore::setDepthPrepassEnabled(bool enabled) {
+		pImpl->depthPrepassEnabled = enabled;
+	}
+
+	bool VulkanCore::isDepthPrepassEnabled() const {
+		return pImpl->depthPrepassEnabled;
+	}
+
+	bool VulkanCore::isDepthPrepassActive() const {
+		return pImpl->depthPrepassActive;
+	}
+
+	PipelineStateKey VulkanCore::getMainPassKey(PipelineStateKey key) const {
+		if (!pImpl->depthPrepassActive)
+			return key;
+
+		if (key.blendMode == BlendMode::eOpaque)
+			return pImpl->pipelineManagerPtr->getAfterDepthPrepassKey(key);
+
+		key.depthWrite = false; //The depth attachment is read-only after the pre-pass
+		return key;
+	}
+
+
+	void VulkanCore::initVulkan() {
+		pImpl->initVulkan();
+	}
+}
+
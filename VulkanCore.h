@@ -1,49 +1,137 @@
-#pragma once
-#include <memory>
-#include <string>
-
-
-namespace vk {
-	class PhysicalDevice;
-	class Device;
-	class SurfaceKHR;
-	enum class Format;
-	class Extent2D;
-	class DescriptorSetLayout;
-	class RenderPass;
-}
-
-struct SDL_Window;
-
-
-namespace CinderVk {
-	class VulkanCore {
-	public:
-		
-		const void tick();
-		const void framebufferResizedSwitch(); //Needed for InputCore to interface with VulkanCore in future
-
-		vk::PhysicalDevice* getPhysicalDevicePtr() const;
-		vk::Device* getLogicalDevicePtr() const;
-		vk::SurfaceKHR* getSurfacePtr() const;
-		SDL_Window** getWindowPtrPtr() const;
-		vk::Format getSwapchainImageFormat() const;
-		uint32_t getSwapchainExtentWidth() const;
-		uint32_t getSwapchainExtentHeight() const;
-		vk::Extent2D getSwapchainExtent() const;
-		vk::DescriptorSetLayout getDescriptorSetLayout() const;
-		vk::RenderPass getRenderPass() const;
-
-
-		void initVulkan();
-
-		VulkanCore();
-		~VulkanCore();
-
-	private:
-		struct impl;
-		std::unique_ptr<impl> pImpl;
-	};
-}
-
-using namespace CinderVk;
+#pragma once
+#include "glm/glm.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace vk {
+	class PhysicalDevice;
+	class Device;
+	class SurfaceKHR;
+	enum class Format;
+	class Extent2D;
+	class DescriptorSetLayout;
+	class RenderPass;
+	class PipelineCache;
+	class PipelineLayout;
+	class CommandBuffer;
+	class Queue;
+	class CommandPool;
+}
+
+struct SDL_Window;
+
+namespace Cinder {
+	class JobSystem;
+}
+
+namespace CinderVk {
+	class VulkanPipelineManager;
+	class VulkanDeletionQueue;
+	class VulkanTimeline;
+	class VulkanRenderGraph;
+	class VulkanClusteredLighting;
+	class VulkanShadowCache;
+	class VulkanParallelRecorder;
+	class VulkanGpuProfiler;
+	class VulkanMemoryStats;
+	class DrawStateCache;
+	struct DrawItem;
+	struct PipelineStateKey;
+	struct PointLight;
+	struct ShadowLight;
+}
+
+
+namespace CinderVk {
+	constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+
+	enum class PresentPolicy : uint8_t {
+		eLowLatency, //FIFO with 2 images, paced to the display's refresh rate
+		eMaxThroughput, //Mailbox, or immediate without it, with 3 images and no pacing
+		ePowerSaving //FIFO with minImageCount + 1 images, paced to half the refresh rate
+	};
+
+	struct WindowState { //What swapchain recreation needs from SDL, asked for on the main thread and handed to whichever thread ticks
+		bool minimised = false;
+		uint32_t drawableWidth = 0, drawableHeight = 0; //Only used when the surface leaves the extent to the swapchain
+	};
+
+	class VulkanCore {
+	public:
+		
+		const void tick();
+		const void framebufferResizedSwitch(); //Any thread, the swapchain is recreated before the next frame
+
+		vk::PhysicalDevice* getPhysicalDevicePtr() const;
+		vk::Device* getLogicalDevicePtr() const;
+		vk::Queue* getGraphicsQueuePtr() const;
+		vk::CommandPool* getCommandPoolPtr() const; //For one-off uploads on the main thread
+		vk::SurfaceKHR* getSurfacePtr() const;
+		SDL_Window** getWindowPtrPtr() const;
+		vk::Format getSwapchainImageFormat() const;
+		uint32_t getSwapchainExtentWidth() const;
+		uint32_t getSwapchainExtentHeight() const;
+		vk::Extent2D getSwapchainExtent() const;
+		vk::DescriptorSetLayout getDescriptorSetLayout() const;
+		vk::RenderPass getRenderPass() const;
+		vk::RenderPass getDepthOnlyRenderPass() const;
+		vk::PipelineCache getPipelineCache() const;
+		VulkanPipelineManager* getPipelineManagerPtr() const;
+		uint64_t getFrameNumber() const;
+		uint64_t getRetiredFrameCount() const;
+		uint64_t getLastFrameTimelineValue() const; //What the last submitted frame signals on the timeline, 0 before the first
+		VulkanDeletionQueue* getDeletionQueuePtr() const;
+		VulkanTimeline* getTimelinePtr() const;
+		VulkanRenderGraph* getRenderGraphPtr() const;
+		VulkanClusteredLighting* getClusteredLightingPtr() const;
+		VulkanShadowCache* getShadowCachePtr() const;
+		VulkanParallelRecorder* getParallelRecorderPtr() const;
+		VulkanGpuProfiler* getGpuProfilerPtr() const; //A "frame" scope plus one per render graph pass
+		VulkanMemoryStats* getMemoryStatsPtr() const; //Logged every few thousand frames, warns near a heap's budget
+
+		void setJobSystem(Cinder::JobSystem* jobs); //Before initVulkan, the main pass is recorded in parallel on it
+		void setMainPassDraws(const std::vector<DrawItem>& draws, const std::function<void(DrawStateCache&, uint32_t)>& recordDraw,
+			const std::function<void(DrawStateCache&, uint32_t)>& recordDepthDraw = nullptr); //Sorted by key on the job system, recordDraw is called from several threads with each drawIndex. recordDepthDraw binds an opaque draw's position buffer for the pre-pass and skips transparent ones
+		PipelineStateKey getMainPassKey(PipelineStateKey key) const; //What recordDraw must bind this frame, eEqual without depth writes for opaque draws after the depth pre-pass
+
+		void setCamera(const glm::mat4& view, const glm::mat4& projection, float zNear, float zFar); //Once per rendered frame, already interpolated
+		void setBeforeRecordCallback(const std::function<void()>& callback); //Runs inside tick once acquire and the frame slot wait are done, right before recording
+		void setAfterGraphCompileCallback(const std::function<void(uint32_t)>& callback); //Runs inside tick with the frame slot once this frame's buffers are placed, before any pass records. The slot's previous submission has retired, update its descriptor sets here
+		void writeLightingDescriptors(vk::DescriptorSet set) const; //From the after graph compile callback, points bindings 6 to 10 at this frame's lights, cluster lists, shadow atlas and shadow tiles
+		void setLights(const std::vector<PointLight>& lights); //Copied, only needed when they change
+		void setShadowLights(const std::vector<ShadowLight>& lights); //Copied, shadow light i shadows point light i. Moving one re-renders its cached static tiles
+		void setShadowCasterCallback(const std::function<void(vk::CommandBuffer&, vk::PipelineLayout, bool)>& callback); //A ShadowCasterCallback, runs inside tick once per shadow tile. Static casters only when a light's cached tiles are invalid
+		void invalidateStaticShadows(); //Static casters changed, e.g. on scene load
+		void setPresentPolicy(PresentPolicy policy); //Any thread, the swapchain is recreated before the next frame
+		PresentPolicy getPresentPolicy() const;
+		uint32_t getDisplayRefreshRate() const; //Hz of the display the window is on, 0 when headless or unknown
+		WindowState queryWindowState() const; //Main thread only, SDL video calls belong there
+		void setWindowState(const WindowState& state); //From the thread that ticks, before tick
+		const WindowState& getWindowState() const;
+
+		bool isHeadless() const;
+		void setReadbackEnabled(bool enabled); //Headless only, copies every frame's colour into host memory
+		bool readbackLastFrame(std::vector<uint8_t>& rgba) const; //Waits for the last submitted frame, RGBA8 rows at getSwapchainExtent
+
+		void setDepthPrepassEnabled(bool enabled); //Per scene, pays off where PBR shading is overdraw bound
+		bool isDepthPrepassEnabled() const;
+		bool isDepthPrepassActive() const; //This frame's, from the record callbacks. False while enabled if the pre-pass pipeline failed or no recordDepthDraw was given
+
+
+		void initVulkan();
+
+		VulkanCore();
+		VulkanCore(uint32_t headlessWidth, uint32_t headlessHeight); //No window, surface or swapchain, frames render into offscreen images, e.g. under lavapipe in CI
+		~VulkanCore();
+
+	private:
+		struct impl;
+		std::unique_ptr<impl> pImpl;
+	};
+}
+
+using namespace CinderVk;
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace CinderVk {
+	class VulkanDeletionQueue { //Holds Vulkan objects until the GPU has retired the last frame that used them
+	public:
+		void push(uint64_t lastUsedValue, std::function<void()>&& deleter) { //lastUsedValue is the frame number the object was last recorded in
+			std::lock_guard<std::mutex> lock(queueMutex);
+			pending.emplace_back(lastUsedValue, std::move(deleter));
+		}
+
+		void collect(uint64_t retiredCount) { //Everything last used before retiredCount is done on the GPU, free it in one go
+			std::vector<std::function<void()>> ready;
+			{
+				std::lock_guard<std::mutex> lock(queueMutex);
+
+				size_t kept = 0;
+				for (size_t i = 0; i != pending.size(); i++) {
+					if (pending[i].first < retiredCount)
+						ready.push_back(std::move(pending[i].second));
+					else
+						pending[kept++] = std::move(pending[i]);
+				}
+
+				pending.resize(kept);
+			}
+
+			for (auto& deleter : ready) //Outside the lock, deleters may queue more work
+				deleter();
+		}
+
+		void flush() { //Device must be idle
+			collect(UINT64_MAX);
+		}
+
+		size_t size() {
+			std::lock_guard<std::mutex> lock(queueMutex);
+			return pending.size();
+		}
+
+	private:
+		std::mutex queueMutex;
+		std::vector<std::pair<uint64_t, std::function<void()>>> pending;
+	};
+}
@@ -0,0 +1,306 @@
+#pragma once
+#include "VulkanWrapper.h"
+#include "VulkanHelper.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace CinderVk {
+	struct GpuScopeStats {
+		std::string name;
+		double lastMs = 0.0; //Most recent frame that has come back, MAX_FRAMES_IN_FLIGHT behind the one being recorded
+		double averageMs = 0.0; //Over the last ROLLING_WINDOW frames the scope was recorded in
+		double vertexInvocations = 0.0; //Rolling averages too, zero without pipeline statistics or on nested scopes
+		double fragmentInvocations = 0.0;
+		double clippingPrimitives = 0.0;
+	};
+
+	class VulkanGpuProfiler : VulkanWrapper { //Named timestamp scopes in per-frame query pools, read back once the frame's slot comes round again so nothing waits on the GPU
+	public:
+		static constexpr uint32_t MAX_SCOPES_PER_FRAME = 64;
+		static constexpr uint32_t ROLLING_WINDOW = 64;
+
+		VulkanGpuProfiler(VulkanCore* coreRef, bool pipelineStatisticsSupported) : VulkanWrapper(coreRef), statisticsSupported(pipelineStatisticsSupported) {
+			init();
+		}
+
+		bool isEnabled() {
+			return enabled;
+		}
+
+		bool hasPipelineStatistics() {
+			return enabled && statisticsSupported && statisticsEnabled;
+		}
+
+		void setPipelineStatisticsEnabled(bool enable) { //Counters aren't free on every driver, timestamps alone are
+			statisticsEnabled = enable;
+		}
+
+		void beginFrame(vk::CommandBuffer& commandBuffer, uint32_t frameIndex) { //Outside any render pass, the slot's previous frame must have retired
+			if (!enabled)
+				return;
+
+			currentFrame = &frames[frameIndex];
+			collect(*currentFrame);
+
+			commandBuffer.resetQueryPool(currentFrame->timestamps, 0, MAX_SCOPES_PER_FRAME * 2);
+			if (currentFrame->statistics)
+				commandBuffer.resetQueryPool(currentFrame->statistics, 0, MAX_SCOPES_PER_FRAME);
+
+			currentFrame->scopes.clear();
+			activeStatisticsScope = UINT32_MAX;
+		}
+
+		uint32_t beginScope(vk::CommandBuffer& commandBuffer, const std::string& name, bool withStatistics = true) { //Returns the handle for endScope, scopes may nest
+			if (!enabled || !currentFrame || currentFrame->scopes.size() == MAX_SCOPES_PER_FRAME)
+				return UINT32_MAX;
+
+			uint32_t scope = static_cast<uint32_t>(currentFrame->scopes.size());
+			RecordedScope recorded{};
+			recorded.history = getHistoryIndex(name);
+			recorded.statistics = withStatistics && currentFrame->statistics && statisticsEnabled && activeStatisticsScope == UINT32_MAX; //Queries of one type can't overlap, inner scopes get timestamps only
+
+			commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, currentFrame->timestamps, scope * 2);
+
+			if (recorded.statistics) {
+				commandBuffer.beginQuery(currentFrame->statistics, scope, {});
+				activeStatisticsScope = scope;
+			}
+
+			currentFrame->scopes.push_back(recorded);
+			return scope;
+		}
+
+		void endScope(vk::CommandBuffer& commandBuffer, uint32_t scope) { //Same render pass instance, or lack of one, as beginScope
+			if (scope == UINT32_MAX || !currentFrame)
+				return;
+
+			if (currentFrame->scopes[scope].statistics) {
+				commandBuffer.endQuery(currentFrame->statistics, scope);
+				activeStatisticsScope = UINT32_MAX;
+			}
+
+			commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, currentFrame->timestamps, scope * 2 + 1);
+			currentFrame->scopes[scope].ended = true;
+		}
+
+		void markSubmitted(uint32_t frameIndex) { //Right after the frame's submit, anchors its timestamps to the CPU clock in traces
+			frames[frameIndex].submittedNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+		}
+
+		std::vector<GpuScopeStats> getScopeStats() { //First recorded first, scopes with no samples since resetScopeStats are left out
+			std::vector<GpuScopeStats> stats;
+			stats.reserve(histories.size());
+
+			for (const auto& history : histories)
+				if (history.samples)
+					stats.push_back(history.stats);
+
+			return stats;
+		}
+
+		void resetScopeStats() { //Empties every rolling window, e.g. between benchmark scenes so a pass one scene stopped recording doesn't linger
+			for (auto& history : histories) {
+				std::string name = history.stats.name;
+				history = ScopeHistory();
+				history.stats.name = name;
+			}
+		}
+
+		bool getScopeStats(const std::string& name, GpuScopeStats& stats) { //False until the scope has come back at least once
+			auto it = historyIndices.find(name);
+			if (it == historyIndices.end() || histories[it->second].samples == 0)
+				return false;
+
+			stats = histories[it->second].stats;
+			return true;
+		}
+
+		~VulkanGpuProfiler() {
+			cleanup();
+		}
+
+	private:
+		struct RecordedScope {
+			uint32_t history;
+			bool statistics;
+			bool ended = false;
+		};
+
+		struct FrameQueries {
+			vk::QueryPool timestamps; //Begin and end per scope
+			vk::QueryPool statistics; //Null without pipeline statistics support
+			std::vector<RecordedScope> scopes; //As recorded the last time this slot was used
+			uint64_t submittedNs = 0; //steady_clock, same base as Tracer::now
+		};
+
+		struct Sample {
+			double ms = 0.0;
+			std::array<uint64_t, 3> statistics{}; //Vertex invocations, clipping primitives, fragment invocations, the order results come back in
+		};
+
+		struct ScopeHistory {
+			GpuScopeStats stats;
+			std::array<Sample, ROLLING_WINDOW> window{};
+			uint32_t samples = 0;
+			uint32_t next = 0;
+		};
+
+		const vk::QueryPipelineStatisticFlags STATISTIC_FLAGS = vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations |
+			vk::QueryPipelineStatisticFlagBits::eClippingPrimitives | vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations;
+
+		bool enabled = false; //Off when the graphics queue has no timestamp bits
+		bool statisticsSupported;
+		bool statisticsEnabled = true;
+		double nanosecondsPerTick = 1.0;
+		uint64_t timestampMask = ~0ull;
+
+		std::array<FrameQueries, MAX_FRAMES_IN_FLIGHT> frames;
+		FrameQueries* currentFrame = nullptr;
+		uint32_t activeStatisticsScope = UINT32_MAX;
+
+		std::vector<ScopeHistory> histories;
+		std::unordered_map<std::string, uint32_t> historyIndices;
+
+		void init() {
+			vk::PhysicalDevice* physicalDevice = getCorePtr()->getPhysicalDevicePtr();
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+
+			Helper::QueueFamilyIndices indices = Helper::findQueueFamilies(*physicalDevice, *getCorePtr()->getSurfacePtr());
+			uint32_t validBits = physicalDevice->getQueueFamilyProperties()[indices.graphicsFamily.value()].timestampValidBits;
+
+			if (validBits == 0) //Scopes become no-ops, everything else keeps working
+				return;
+
+			enabled = true;
+			timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+			nanosecondsPerTick = physicalDevice->getProperties().limits.timestampPeriod;
+
+			for (auto& frame : frames) {
+				vk::QueryPoolCreateInfo timestampInfo({}, vk::QueryType::eTimestamp, MAX_SCOPES_PER_FRAME * 2);
+				if (device->createQueryPool(&timestampInfo, nullptr, &frame.timestamps) != vk::Result::eSuccess)
+					throw std::runtime_error("Failed to create timestamp query pool!");
+
+				if (statisticsSupported) {
+					vk::QueryPoolCreateInfo statisticsInfo({}, vk::QueryType::ePipelineStatistics, MAX_SCOPES_PER_FRAME, STATISTIC_FLAGS);
+					if (device->createQueryPool(&statisticsInfo, nullptr, &frame.statistics) != vk::Result::eSuccess)
+						throw std::runtime_error("Failed to create pipeline statistics query pool!");
+				}
+			}
+		}
+
+		uint32_t getHistoryIndex(const std::string& name) {
+			auto it = historyIndices.find(name);
+			if (it != historyIndices.end())
+				return it->second;
+
+			ScopeHistory history;
+			history.stats.name = name;
+			histories.push_back(history);
+
+			return historyIndices[name] = static_cast<uint32_t>(histories.size() - 1);
+		}
+
+		void collect(FrameQueries& frame) {
+			if (frame.scopes.empty())
+				return;
+
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+			uint32_t scopeCount = static_cast<uint32_t>(frame.scopes.size());
+
+			std::vector<uint64_t> timestamps(scopeCount * 2); //Never waited on, by now the frame's timeline value has been
+			vk::Result result = device->getQueryPoolResults(frame.timestamps, 0, scopeCount * 2, timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+
+			if (result != vk::Result::eSuccess && result != vk::Result::eNotReady) //The slot has retired, only scopes that never ended are still unavailable
+				return;
+
+			std::vector<uint64_t> statistics;
+			if (frame.statistics) {
+				statistics.resize(scopeCount * 3);
+				result = device->getQueryPoolResults(frame.statistics, 0, scopeCount, statistics.size() * sizeof(uint64_t), statistics.data(), sizeof(uint64_t) * 3, vk::QueryResultFlagBits::e64);
+
+				if (result != vk::Result::eSuccess && result != vk::Result::eNotReady) //Nested scopes leave queries unbegun, those read as not ready and are skipped below
+					statistics.clear();
+			}
+
+#ifdef CINDER_TRACING
+			uint64_t firstTick = timestamps[0]; //Scope 0 began first, the GPU can't have started it before the submit
+#endif
+
+			for (uint32_t scope = 0; scope != scopeCount; scope++) {
+				const RecordedScope& recorded = frame.scopes[scope];
+				if (!recorded.ended)
+					continue;
+
+#ifdef CINDER_TRACING
+				Cinder::Tracer::recordGpuEvent(histories[recorded.history].stats.name, frame.submittedNs + ticksToNanoseconds(timestamps[scope * 2] - firstTick),
+					frame.submittedNs + ticksToNanoseconds(timestamps[scope * 2 + 1] - firstTick));
+#endif
+
+				Sample sample;
+				sample.ms = ticksToNanoseconds(timestamps[scope * 2 + 1] - timestamps[scope * 2]) / 1e6;
+
+				if (recorded.statistics && !statistics.empty())
+					for (uint32_t i = 0; i != 3; i++)
+						sample.statistics[i] = statistics[scope * 3 + i];
+
+				addSample(histories[recorded.history], sample);
+			}
+		}
+
+		uint64_t ticksToNanoseconds(uint64_t ticks) {
+			return static_cast<uint64_t>(static_cast<double>(ticks & timestampMask) * nanosecondsPerTick);
+		}
+
+		void addSample(ScopeHistory& history, const Sample& sample) {
+			history.window[history.next] = sample;
+			history.next = (history.next + 1) % ROLLING_WINDOW;
+			history.samples = std::min(history.samples + 1, ROLLING_WINDOW);
+
+			Sample total;
+			for (uint32_t i = 0; i != history.samples; i++) {
+				total.ms += history.window[i].ms;
+				for (uint32_t j = 0; j != 3; j++)
+					total.statistics[j] += history.window[i].statistics[j];
+			}
+
+			double count = static_cast<double>(history.samples);
+			history.stats.lastMs = sample.ms;
+			history.stats.averageMs = total.ms / count;
+			history.stats.vertexInvocations = total.statistics[0] / count;
+			history.stats.clippingPrimitives = total.statistics[1] / count;
+			history.stats.fragmentInvocations = total.statistics[2] / count;
+		}
+
+		void cleanup() {
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+
+			for (auto& frame : frames) {
+				device->destroyQueryPool(frame.timestamps, nullptr);
+				device->destroyQueryPool(frame.statistics, nullptr);
+			}
+		}
+	};
+
+	class GpuScope { //Scope guard for VulkanGpuProfiler, the profiler may be null
+	public:
+		GpuScope(VulkanGpuProfiler* profilerPtr, vk::CommandBuffer& commandBufferRef, const std::string& name, bool withStatistics = true) : profiler(profilerPtr), commandBuffer(commandBufferRef) {
+			if (profiler)
+				scope = profiler->beginScope(commandBuffer, name, withStatistics);
+		}
+
+		~GpuScope() {
+			if (profiler)
+				profiler->endScope(commandBuffer, scope);
+		}
+
+	private:
+		VulkanGpuProfiler* profiler;
+		vk::CommandBuffer& commandBuffer;
+		uint32_t scope = UINT32_MAX;
+	};
+}
@@ -1,188 +1,226 @@
-#pragma once
-#include "VulkanWrapper.h"
-#include "VulkanHelper.h"
-#include "Vertex.h"
-#include <vector>
-
-namespace CinderVk {
-	class VulkanGraphicsPipeline : VulkanWrapper {
-	public:
-		VulkanGraphicsPipeline(VulkanCore* corePtr) : VulkanWrapper(corePtr) {
-			init();
-		}
-
-		~VulkanGraphicsPipeline() {
-			cleanup();
-		}
-
-	private:
-		std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
-		vk::PipelineLayout pipelineLayout;
-		vk::Pipeline graphicsPipeline;
-
-		void init() {
-			std::vector<char> vertexShaderCode = Helper::readFile("vertexShader.spv"); //TODO make these files again
-			std::vector<char> fragmentShaderCode = Helper::readFile("fragmentShader.spv");
-
-			vk::ShaderModule vertexShaderModule = createShaderModule(vertexShaderCode);
-			vk::ShaderModule fragmentShaderModule = createShaderModule(fragmentShaderCode);
-
-			addShaderStageInfo(vk::ShaderStageFlagBits::eVertex, vertexShaderModule);
-			addShaderStageInfo(vk::ShaderStageFlagBits::eFragment, fragmentShaderModule);
-
-			vk::PipelineVertexInputStateCreateInfo vertexInputInfo{};
-			
-			auto bindingDescription = Vertex::getBindingDescription();
-			auto attributeDescriptions = Vertex::getAttributeDescriptions();
-
-			vertexInputInfo.vertexBindingDescriptionCount = 1;
-			vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-			vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-			vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
-
-			vk::PipelineInputAssemblyStateCreateInfo inputAssembly{};
-			inputAssembly.topology = vk::PrimitiveTopology::eTriangleList; //could be fun to mess with
-			inputAssembly.primitiveRestartEnable = 0;
-
-			vk::Viewport viewport{};
-			viewport.x = 0.0f;
-			viewport.y = 0.0f;
-			viewport.width = (float) getCorePtr()->getSwapchainExtentWidth();
-			viewport.height = (float) getCorePtr()->getSwapchainExtentHeight();
-			viewport.minDepth = 0.0f;
-			viewport.maxDepth = 1.0f;
-
-			vk::Rect2D scissor{};
-			scissor.offset = vk::Offset2D(0, 0);
-			scissor.extent = getCorePtr()->getSwapchainExtent();
-
-			vk::PipelineViewportStateCreateInfo viewportState{};
-			viewportState.viewportCount = 1;
-			viewportState.pViewports = &viewport;
-			viewportState.scissorCount = 1;
-			viewportState.pScissors = &scissor;
-
-			vk::PipelineRasterizationStateCreateInfo rasterizer{};
-			rasterizer.depthClampEnable = 0;
-			rasterizer.rasterizerDiscardEnable = 0;
-			rasterizer.polygonMode = vk::PolygonMode::eFill;
-			rasterizer.lineWidth = 1.0f;
-			rasterizer.cullMode = vk::CullModeFlagBits::eNone;
-			rasterizer.frontFace = vk::FrontFace::eCounterClockwise;
-			rasterizer.depthBiasEnable = 0;
-			rasterizer.depthBiasConstantFactor = 0.0f;
-			rasterizer.depthBiasClamp = 0.0f;
-			rasterizer.depthBiasSlopeFactor = 0.0f;
-
-			vk::PipelineMultisampleStateCreateInfo multisampling{};
-			multisampling.sampleShadingEnable = 0;
-			multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
-			multisampling.minSampleShading = 1.0f;
-			multisampling.pSampleMask = nullptr;
-			multisampling.alphaToCoverageEnable = 0;
-			multisampling.alphaToOneEnable = 0;
-
-			vk::PipelineDepthStencilStateCreateInfo depthStencil{};
-			depthStencil.depthTestEnable = 1;
-			depthStencil.depthWriteEnable = 1;
-			depthStencil.depthCompareOp = vk::CompareOp::eLess;
-			depthStencil.depthBoundsTestEnable = 0;
-			depthStencil.minDepthBounds = 0.0f;
-			depthStencil.maxDepthBounds = 1.0f;
-			depthStencil.stencilTestEnable = 0;
-
-			vk::PipelineColorBlendAttachmentState colorBlendAttachment{};
-			colorBlendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR |
-				vk::ColorComponentFlagBits::eG |
-				vk::ColorComponentFlagBits::eB |
-				vk::ColorComponentFlagBits::eA;
-			colorBlendAttachment.blendEnable = 1;
-			colorBlendAttachment.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
-			colorBlendAttachment.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
-			colorBlendAttachment.colorBlendOp = vk::BlendOp::eAdd;
-			colorBlendAttachment.srcAlphaBlendFactor = vk::BlendFactor::eOne;
-			colorBlendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eZero;
-			colorBlendAttachment.alphaBlendOp = vk::BlendOp::eAdd;
-
-			vk::PipelineColorBlendStateCreateInfo colorBlending{};
-			colorBlending.logicOpEnable = 0;
-			colorBlending.logicOp = vk::LogicOp::eCopy;
-			colorBlending.attachmentCount = 1;
-			colorBlending.pAttachments = &colorBlendAttachment;
-			colorBlending.blendConstants[0] = 0.0f;
-			colorBlending.blendConstants[1] = 0.0f;
-			colorBlending.blendConstants[2] = 0.0f;
-			colorBlending.blendConstants[3] = 0.0f;
-
-			vk::PipelineLayoutCreateInfo pipelineLayoutInfo{};
-			pipelineLayoutInfo.setLayoutCount = 1;
-
-			vk::DescriptorSetLayout&& layouts = getCorePtr()->getDescriptorSetLayout();
-
-			pipelineLayoutInfo.pSetLayouts = &layouts;
-			pipelineLayoutInfo.pushConstantRangeCount = 0;
-			pipelineLayoutInfo.pPushConstantRanges = nullptr;
-
-			if (getCorePtr()->getLogicalDevicePtr()->createPipelineLayout(&pipelineLayoutInfo, nullptr, &pipelineLayout) != vk::Result::eSuccess) {
-				throw std::runtime_error("Failed to create the pipeline layout.");
-			}
-
-			vk::GraphicsPipelineCreateInfo pipelineInfo{};
-			pipelineInfo.stageCount = shaderStages.size();
-			pipelineInfo.pStages = shaderStages.data();
-			pipelineInfo.pVertexInputState = &vertexInputInfo;
-			pipelineInfo.pInputAssemblyState = &inputAssembly;
-			pipelineInfo.pViewportState = &viewportState;
-			pipelineInfo.pRasterizationState = &rasterizer;
-			pipelineInfo.pMultisampleState = &multisampling;
-			pipelineInfo.pDepthStencilState = &depthStencil;
-			pipelineInfo.pColorBlendState = &colorBlending;
-			pipelineInfo.pDynamicState = nullptr;
-
-			pipelineInfo.layout = pipelineLayout;
-			pipelineInfo.renderPass = getCorePtr()->getRenderPass();
-			pipelineInfo.subpass = 0;
-			pipelineInfo.basePipelineHandle = nullptr;
-			pipelineInfo.basePipelineIndex = -1;
-
-			if (getCorePtr()->getLogicalDevicePtr()->createGraphicsPipelines(nullptr, 1, &pipelineInfo, nullptr, &graphicsPipeline) != vk::Result::eSuccess) {
-				throw std::runtime_error("Failed to create graphics pipeline.");
-			}
-
-			getCorePtr()->getLogicalDevicePtr()->destroyShaderModule(fragmentShaderModule, nullptr);
-			getCorePtr()->getLogicalDevicePtr()->destroyShaderModule(vertexShaderModule, nullptr);
-		}
-
-		void cleanup() {
-			getCorePtr()->getLogicalDevicePtr()->destroyPipeline(graphicsPipeline, nullptr);
-			getCorePtr()->getLogicalDevicePtr()->destroyPipelineLayout(pipelineLayout, nullptr);
-		}
-
-		void addShaderStageInfo(vk::ShaderStageFlagBits flagBits, vk::ShaderModule shaderModule, const char* pName = "main") {
-			vk::PipelineShaderStageCreateInfo shaderStageInfo{};
-			shaderStageInfo.stage = flagBits;
-			shaderStageInfo.module = shaderModule;
-			shaderStageInfo.pName = pName;
-
-			shaderStages.push_back(shaderStageInfo);
-		}
-
-		vk::ShaderModule createShaderModule(const std::vector<char>& shaderCode) {
-			vk::ShaderModuleCreateInfo smCreateInfo{};
-
-			smCreateInfo.codeSize = shaderCode.size();
-			smCreateInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
-
-			vk::ShaderModule shaderModule;
-			if (getCorePtr()->getLogicalDevicePtr()->createShaderModule(&smCreateInfo, nullptr, &shaderModule) != vk::Result::eSuccess) {
-				throw std::runtime_error("Failed to create a shader module.");
-			}
-
-			return shaderModule;
-		}
-
-	};
-
-
-
+#pragma once
+#include "VulkanWrapper.h"
+#include "VulkanHelper.h"
+#include "VulkanPipelineState.h"
+#include "Vertex.h"
+#include <array>
+#include <string>
+#include <vector>
+
+namespace CinderVk {
+	class VulkanGraphicsPipeline : VulkanWrapper { //One pipeline built from a PipelineStateKey, VulkanPipelineManager owns and deduplicates these
+	public:
+		VulkanGraphicsPipeline(VulkanCore* corePtr, const PipelineStateKey& key, const std::string& vertexPath, const std::string& fragmentPath, vk::PipelineLayout layout) :
+			VulkanWrapper(corePtr), stateKey(key), vertexShaderPath(vertexPath), fragmentShaderPath(fragmentPath), pipelineLayout(layout) {
+			init();
+		}
+
+		vk::Pipeline getPipeline() {
+			return graphicsPipeline;
+		}
+
+		const PipelineStateKey& getStateKey() {
+			return stateKey;
+		}
+
+		~VulkanGraphicsPipeline() {
+			cleanup();
+		}
+
+	private:
+		PipelineStateKey stateKey;
+		std::string vertexShaderPath;
+		std::string fragmentShaderPath;
+
+		std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
+		vk::PipelineLayout pipelineLayout; //Shared, owned by VulkanPipelineManager
+		vk::Pipeline graphicsPipeline;
+
+		void init() {
+			std::vector<char> vertexShaderCode = Helper::readFile(vertexShaderPath);
+			vk::ShaderModule vertexShaderModule = createShaderModule(vertexShaderCode);
+			vk::ShaderModule fragmentShaderModule = nullptr;
+
+			if (!stateKey.depthOnly) { //Depth-only pipelines rasterise without a fragment stage
+				try {
+					std::vector<char> fragmentShaderCode = Helper::readFile(fragmentShaderPath);
+					fragmentShaderModule = createShaderModule(fragmentShaderCode);
+				}
+				catch (...) {
+					getCorePtr()->getLogicalDevicePtr()->destroyShaderModule(vertexShaderModule, nullptr);
+					throw;
+				}
+			}
+
+			std::array<VkBool32, MATERIAL_FEATURE_COUNT + 1> featureConstants{};
+			std::array<vk::SpecializationMapEntry, MATERIAL_FEATURE_COUNT + 1> featureEntries{};
+
+			for (uint32_t i = 0; i != MATERIAL_FEATURE_COUNT; i++) { //constant_id i toggles the i-th PBR map
+				featureConstants[i] = (stateKey.materialFeatures & materialFeatureBit(static_cast<MaterialFeature>(i))) != 0;
+				featureEntries[i] = vk::SpecializationMapEntry(i, i * sizeof(VkBool32), sizeof(VkBool32));
+			}
+
+			featureConstants[MATERIAL_SPECIALIZED_CONSTANT_ID] = VK_TRUE; //Stops the shader reading the push constant
+			featureEntries[MATERIAL_SPECIALIZED_CONSTANT_ID] = vk::SpecializationMapEntry(MATERIAL_SPECIALIZED_CONSTANT_ID, MATERIAL_SPECIALIZED_CONSTANT_ID * sizeof(VkBool32), sizeof(VkBool32));
+
+			vk::SpecializationInfo fragmentSpecialization{};
+			fragmentSpecialization.mapEntryCount = static_cast<uint32_t>(featureEntries.size());
+			fragmentSpecialization.pMapEntries = featureEntries.data();
+			fragmentSpecialization.dataSize = sizeof(featureConstants);
+			fragmentSpecialization.pData = featureConstants.data();
+
+			addShaderStageInfo(vk::ShaderStageFlagBits::eVertex, vertexShaderModule);
+
+			if (fragmentShaderModule)
+				addShaderStageInfo(vk::ShaderStageFlagBits::eFragment, fragmentShaderModule, stateKey.specialized ? &fragmentSpecialization : nullptr);
+
+			vk::PipelineVertexInputStateCreateInfo vertexInputInfo{};
+			
+			auto bindingDescription = Vertex::getBindingDescription();
+			auto attributeDescriptions = Vertex::getAttributeDescriptions();
+			auto positionBindingDescription = Vertex::getPositionBindingDescription();
+			auto positionAttributeDescription = Vertex::getPositionAttributeDescription();
+
+			vertexInputInfo.vertexBindingDescriptionCount = 1;
+
+			if (stateKey.vertexLayout == VertexLayout::ePositionOnly) {
+				vertexInputInfo.vertexAttributeDescriptionCount = 1;
+				vertexInputInfo.pVertexBindingDescriptions = &positionBindingDescription;
+				vertexInputInfo.pVertexAttributeDescriptions = &positionAttributeDescription;
+			}
+			else {
+				vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+				vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+				vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+			}
+
+			vk::PipelineInputAssemblyStateCreateInfo inputAssembly{};
+			inputAssembly.topology = vk::PrimitiveTopology::eTriangleList; //could be fun to mess with
+			inputAssembly.primitiveRestartEnable = 0;
+
+			vk::PipelineViewportStateCreateInfo viewportState{}; //Viewport and scissor are dynamic so swapchain resizes don't need new pipelines
+			viewportState.viewportCount = 1;
+			viewportState.pViewports = nullptr;
+			viewportState.scissorCount = 1;
+			viewportState.pScissors = nullptr;
+
+			std::array<vk::DynamicState, 2> dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+
+			vk::PipelineDynamicStateCreateInfo dynamicState{};
+			dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+			dynamicState.pDynamicStates = dynamicStates.data();
+
+			vk::PipelineRasterizationStateCreateInfo rasterizer{};
+			rasterizer.depthClampEnable = 0;
+			rasterizer.rasterizerDiscardEnable = 0;
+			rasterizer.polygonMode = vk::PolygonMode::eFill;
+			rasterizer.lineWidth = 1.0f;
+			rasterizer.cullMode = stateKey.cullMode;
+			rasterizer.frontFace = vk::FrontFace::eCounterClockwise;
+			rasterizer.depthBiasEnable = 0;
+			rasterizer.depthBiasConstantFactor = 0.0f;
+			rasterizer.depthBiasClamp = 0.0f;
+			rasterizer.depthBiasSlopeFactor = 0.0f;
+
+			vk::PipelineMultisampleStateCreateInfo multisampling{};
+			multisampling.sampleShadingEnable = 0;
+			multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
+			multisampling.minSampleShading = 1.0f;
+			multisampling.pSampleMask = nullptr;
+			multisampling.alphaToCoverageEnable = 0;
+			multisampling.alphaToOneEnable = 0;
+
+			vk::PipelineDepthStencilStateCreateInfo depthStencil{};
+			depthStencil.depthTestEnable = stateKey.depthTest;
+			depthStencil.depthWriteEnable = stateKey.depthWrite;
+			depthStencil.depthCompareOp = stateKey.depthCompareOp;
+			depthStencil.depthBoundsTestEnable = 0;
+			depthStencil.minDepthBounds = 0.0f;
+			depthStencil.maxDepthBounds = 1.0f;
+			depthStencil.stencilTestEnable = 0;
+
+			vk::PipelineColorBlendAttachmentState colorBlendAttachment{};
+			colorBlendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR |
+				vk::ColorComponentFlagBits::eG |
+				vk::ColorComponentFlagBits::eB |
+				vk::ColorComponentFlagBits::eA;
+			colorBlendAttachment.blendEnable = stateKey.blendMode != BlendMode::eOpaque;
+			colorBlendAttachment.srcColorBlendFactor = stateKey.blendMode == BlendMode::eAdditive ? vk::BlendFactor::eOne : vk::BlendFactor::eSrcAlpha;
+			colorBlendAttachment.dstColorBlendFactor = stateKey.blendMode == BlendMode::eAdditive ? vk::BlendFactor::eOne : vk::BlendFactor::eOneMinusSrcAlpha;
+			colorBlendAttachment.colorBlendOp = vk::BlendOp::eAdd;
+			colorBlendAttachment.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+			colorBlendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eZero;
+			colorBlendAttachment.alphaBlendOp = vk::BlendOp::eAdd;
+
+			vk::PipelineColorBlendStateCreateInfo colorBlending{};
+			colorBlending.logicOpEnable = 0;
+			colorBlending.logicOp = vk::LogicOp::eCopy;
+			colorBlending.attachmentCount = stateKey.depthOnly ? 0 : 1;
+			colorBlending.pAttachments = &colorBlendAttachment;
+			colorBlending.blendConstants[0] = 0.0f;
+			colorBlending.blendConstants[1] = 0.0f;
+			colorBlending.blendConstants[2] = 0.0f;
+			colorBlending.blendConstants[3] = 0.0f;
+
+			vk::GraphicsPipelineCreateInfo pipelineInfo{};
+			pipelineInfo.stageCount = shaderStages.size();
+			pipelineInfo.pStages = shaderStages.data();
+			pipelineInfo.pVertexInputState = &vertexInputInfo;
+			pipelineInfo.pInputAssemblyState = &inputAssembly;
+			pipelineInfo.pViewportState = &viewportState;
+			pipelineInfo.pRasterizationState = &rasterizer;
+			pipelineInfo.pMultisampleState = &multisampling;
+			pipelineInfo.pDepthStencilState = &depthStencil;
+			pipelineInfo.pColorBlendState = &colorBlending;
+			pipelineInfo.pDynamicState = &dynamicState;
+
+			pipelineInfo.layout = pipelineLayout;
+			pipelineInfo.renderPass = stateKey.renderPass;
+			pipelineInfo.subpass = 0;
+			pipelineInfo.basePipelineHandle = nullptr;
+			pipelineInfo.basePipelineIndex = -1;
+
+			vk::Result result = getCorePtr()->getLogicalDevicePtr()->createGraphicsPipelines(getCorePtr()->getPipelineCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline);
+
+			if (fragmentShaderModule)
+				getCorePtr()->getLogicalDevicePtr()->destroyShaderModule(fragmentShaderModule, nullptr);
+
+			getCorePtr()->getLogicalDevicePtr()->destroyShaderModule(vertexShaderModule, nullptr);
+
+			if (result != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to create graphics pipeline.");
+		}
+
+		void cleanup() {
+			getCorePtr()->getLogicalDevicePtr()->destroyPipeline(graphicsPipeline, nullptr);
+		}
+
+		void addShaderStageInfo(vk::ShaderStageFlagBits flagBits, vk::ShaderModule shaderModule, const vk::SpecializationInfo* specializationInfo = nullptr, const char* pName = "main") {
+			vk::PipelineShaderStageCreateInfo shaderStageInfo{};
+			shaderStageInfo.stage = flagBits;
+			shaderStageInfo.module = shaderModule;
+			shaderStageInfo.pName = pName;
+			shaderStageInfo.pSpecializationInfo = specializationInfo; //Must outlive createGraphicsPipelines
+
+			shaderStages.push_back(shaderStageInfo);
+		}
+
+		vk::ShaderModule createShaderModule(const std::vector<char>& shaderCode) {
+			vk::ShaderModuleCreateInfo smCreateInfo{};
+
+			smCreateInfo.codeSize = shaderCode.size();
+			smCreateInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+
+			vk::ShaderModule shaderModule;
+			if (getCorePtr()->getLogicalDevicePtr()->createShaderModule(&smCreateInfo, nullptr, &shaderModule) != vk::Result::eSuccess) {
+				throw std::runtime_error("Failed to create a shader module.");
+			}
+
+			return shaderModule;
+		}
+
+	};
+
+
+
 }
\ No newline at end of file
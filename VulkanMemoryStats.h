@@ -0,0 +1,193 @@
+#pragma once
+#include "VulkanWrapper.h"
+#include "VulkanBuffer.h"
+#include "vk_mem_alloc.h"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace CinderVk {
+	struct MemoryHeapStats {
+		vk::DeviceSize size = 0;
+		vk::DeviceSize budget = 0; //What the driver says this process can use before things start getting evicted or failing
+		vk::DeviceSize usage = 0; //Whole process with VK_EXT_memory_budget, only what the engine tracked without it
+		vk::DeviceSize trackedBytes = 0; //Allocated through the engine's helpers
+		bool deviceLocal = false;
+	};
+
+	struct MemoryStats {
+		std::array<vk::DeviceSize, static_cast<size_t>(MemoryCategory::eCount)> categoryBytes{};
+		std::array<uint32_t, static_cast<size_t>(MemoryCategory::eCount)> categoryAllocations{};
+		std::vector<MemoryHeapStats> heaps;
+		uint32_t allocationCount = 0;
+		uint32_t maxAllocationCount = 0; //maxMemoryAllocationCount, as low as 4096 on some drivers
+		bool budgetFromDriver = false; //False means the budget is VMA's 80% of heap size estimate
+	};
+
+	class VulkanMemoryStats : VulkanWrapper { //Per category and per heap device memory use against the budget, for streaming and LOD decisions
+	public:
+		static constexpr uint64_t LOG_INTERVAL_FRAMES = 3600;
+		static constexpr float WARNING_FRACTION = 0.9f; //Of a heap's budget or of maxMemoryAllocationCount
+		static constexpr float WARNING_CLEAR_FRACTION = 0.8f; //Warned again only after dropping below this
+
+		VulkanMemoryStats(VulkanCore* coreRef, VmaAllocator vmaAllocator, bool memoryBudgetSupported) : VulkanWrapper(coreRef), allocator(vmaAllocator), budgetSupported(memoryBudgetSupported) {
+			init();
+		}
+
+		static const char* getCategoryName(MemoryCategory category) {
+			static const char* names[] = { "vertex", "index", "texture", "staging", "uniform", "attachment", "other" };
+			return names[static_cast<size_t>(category)];
+		}
+
+		MemoryStats getStats() {
+			TrackedMemory tracked = getTrackedMemory();
+
+			MemoryStats stats;
+			stats.categoryBytes = tracked.categoryBytes;
+			stats.categoryAllocations = tracked.categoryAllocations;
+			stats.allocationCount = tracked.allocationCount;
+			stats.maxAllocationCount = maxAllocationCount;
+			stats.budgetFromDriver = budgetSupported;
+
+			std::vector<VmaBudget> budgets(heapCount);
+			vmaGetHeapBudgets(allocator, budgets.data());
+
+			stats.heaps.resize(heapCount);
+			for (uint32_t heap = 0; heap != heapCount; heap++) {
+				MemoryHeapStats& heapStats = stats.heaps[heap];
+				heapStats.size = heapSizes[heap];
+				heapStats.deviceLocal = heapDeviceLocal[heap];
+				heapStats.trackedBytes = heap < tracked.heapBytes.size() ? tracked.heapBytes[heap] : 0;
+				heapStats.budget = budgets[heap].budget;
+				heapStats.usage = budgetSupported ? budgets[heap].usage : heapStats.trackedBytes + budgets[heap].usage; //VMA only sees its own allocations without the extension
+			}
+
+			return stats;
+		}
+
+		void update(uint64_t frameNumber) { //Once per frame, VMA refreshes the driver's budget on frame index changes
+			vmaSetCurrentFrameIndex(allocator, static_cast<uint32_t>(frameNumber));
+
+			if (frameNumber % WARNING_CHECK_INTERVAL_FRAMES != 0)
+				return;
+
+			MemoryStats stats = getStats();
+			checkWarnings(stats);
+
+			if (frameNumber % LOG_INTERVAL_FRAMES == 0)
+				log(stats);
+		}
+
+		std::string toJson() {
+			MemoryStats stats = getStats();
+			std::ostringstream out;
+
+			out << "{\"allocationCount\":" << stats.allocationCount << ",\"maxAllocationCount\":" << stats.maxAllocationCount
+				<< ",\"budgetFromDriver\":" << (stats.budgetFromDriver ? "true" : "false") << ",\"categories\":{";
+
+			for (size_t category = 0; category != stats.categoryBytes.size(); category++)
+				out << (category ? "," : "") << "\"" << getCategoryName(static_cast<MemoryCategory>(category)) << "\":{\"bytes\":" << stats.categoryBytes[category]
+					<< ",\"allocations\":" << stats.categoryAllocations[category] << "}";
+
+			out << "},\"heaps\":[";
+
+			for (size_t heap = 0; heap != stats.heaps.size(); heap++) {
+				const MemoryHeapStats& heapStats = stats.heaps[heap];
+				out << (heap ? "," : "") << "{\"size\":" << heapStats.size << ",\"budget\":" << heapStats.budget << ",\"usage\":" << heapStats.usage
+					<< ",\"trackedBytes\":" << heapStats.trackedBytes << ",\"deviceLocal\":" << (heapStats.deviceLocal ? "true" : "false") << "}";
+			}
+
+			out << "]}";
+			return out.str();
+		}
+
+		bool writeJson(const std::string& path) {
+			std::ofstream file(path);
+			if (!file)
+				return false;
+
+			file << toJson() << std::endl;
+			return static_cast<bool>(file);
+		}
+
+	private:
+		static constexpr uint64_t WARNING_CHECK_INTERVAL_FRAMES = 30; //Budgets move slowly, no need to look every frame
+
+		VmaAllocator allocator;
+		bool budgetSupported;
+		uint32_t maxAllocationCount = 0;
+		uint32_t heapCount = 0;
+		std::vector<vk::DeviceSize> heapSizes;
+		std::vector<bool> heapDeviceLocal;
+
+		std::vector<bool> heapWarned;
+		bool allocationCountWarned = false;
+
+		void init() {
+			vk::PhysicalDevice* physicalDevice = getCorePtr()->getPhysicalDevicePtr();
+			vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice->getMemoryProperties();
+
+			maxAllocationCount = physicalDevice->getProperties().limits.maxMemoryAllocationCount;
+			heapCount = memoryProperties.memoryHeapCount;
+
+			for (uint32_t heap = 0; heap != heapCount; heap++) {
+				heapSizes.push_back(memoryProperties.memoryHeaps[heap].size);
+				heapDeviceLocal.push_back(static_cast<bool>(memoryProperties.memoryHeaps[heap].flags & vk::MemoryHeapFlagBits::eDeviceLocal));
+			}
+
+			heapWarned.resize(heapCount, false);
+
+			if (!budgetSupported)
+				std::cout << "VK_EXT_memory_budget unavailable, memory budgets are estimated from heap sizes" << std::endl;
+		}
+
+		void checkWarnings(const MemoryStats& stats) {
+			for (uint32_t heap = 0; heap != heapCount; heap++) {
+				const MemoryHeapStats& heapStats = stats.heaps[heap];
+				if (heapStats.budget == 0)
+					continue;
+
+				double fraction = static_cast<double>(heapStats.usage) / static_cast<double>(heapStats.budget);
+
+				if (!heapWarned[heap] && fraction >= WARNING_FRACTION) {
+					heapWarned[heap] = true;
+					std::cerr << "Memory heap " << heap << (heapStats.deviceLocal ? " (device local)" : "") << " is at " << static_cast<int>(fraction * 100.0)
+						<< "% of its budget: " << toMegabytes(heapStats.usage) << " of " << toMegabytes(heapStats.budget) << " MB" << std::endl;
+				}
+				else if (heapWarned[heap] && fraction < WARNING_CLEAR_FRACTION)
+					heapWarned[heap] = false;
+			}
+
+			double allocationFraction = static_cast<double>(stats.allocationCount) / static_cast<double>(std::max(stats.maxAllocationCount, 1u));
+
+			if (!allocationCountWarned && allocationFraction >= WARNING_FRACTION) {
+				allocationCountWarned = true;
+				std::cerr << "Device memory allocation count is at " << stats.allocationCount << " of maxMemoryAllocationCount " << stats.maxAllocationCount
+					<< ", suballocate instead of allocating per resource" << std::endl;
+			}
+			else if (allocationCountWarned && allocationFraction < WARNING_CLEAR_FRACTION)
+				allocationCountWarned = false;
+		}
+
+		void log(const MemoryStats& stats) {
+			std::cout << "GPU memory:";
+			for (size_t category = 0; category != stats.categoryBytes.size(); category++)
+				std::cout << " " << getCategoryName(static_cast<MemoryCategory>(category)) << " " << toMegabytes(stats.categoryBytes[category]) << " MB";
+
+			std::cout << ", " << stats.allocationCount << "/" << stats.maxAllocationCount << " allocations";
+
+			for (uint32_t heap = 0; heap != heapCount; heap++)
+				std::cout << ", heap " << heap << " " << toMegabytes(stats.heaps[heap].usage) << "/" << toMegabytes(stats.heaps[heap].budget) << " MB";
+
+			std::cout << std::endl;
+		}
+
+		static double toMegabytes(vk::DeviceSize bytes) {
+			return static_cast<double>(bytes) / (1024.0 * 1024.0);
+		}
+	};
+}
@@ -1,104 +1,189 @@
-#pragma once
-#include "VulkanModel.h"
-#include "VulkanBuffer.h"
-#include "fast_obj.h"
-
-namespace CinderVk {
-	uint32_t VulkanModelData::getModelIndicesSize() {
-		return modelIndicesSize;
-	}
-
-	uint32_t VulkanModelData::getModelVerticesSize() {
-		return modelVerticesSize;
-	}
-
-	vk::ImageView VulkanModelData::getImageView(size_t idx) {
-		return textureStructs[idx].textureImageView;
-	}
-
-	vk::Sampler VulkanModelData::getTextureSampler(size_t idx) {
-		return textureStructs[idx].textureSampler;
-	}
-
-	vk::Buffer VulkanModelData::getVertexBuffer() {
-		return vertexBuffer;
-	}
-
-	vk::Buffer VulkanModelData::getIndexBuffer() {
-		return indexBuffer;
-	}
-
-	void VulkanModelData::loadModelData() {
-
-
-	}
-
-	void VulkanModelData::setupBuffers(std::vector<Vertex>& verts, std::vector<uint32_t>& indices) {
-		modelIndicesSize = static_cast<uint32_t>(indices.size());
-		modelVerticesSize = static_cast<uint32_t>(verts.size());
-
-		createVertexBuffer(verts);
-		createIndexBuffer(indices);
-	}
-
-	void VulkanModelData::createVertexBuffer(std::vector<Vertex>& verts) {
-		vk::DeviceSize bufferSize = verts.size() * sizeof(Vertex);
-
-		vk::Buffer stagingBuffer;
-		vk::DeviceMemory stagingBufferMemory;
-
-		createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingBufferMemory, *logicalDevicePtr, *physicalDevicePtr);
-		
-		void* data;
-		vulkanMapMemory(*logicalDevicePtr, stagingBufferMemory, 0, bufferSize, vk::MemoryMapFlagBits{}, &data);
-		memcpy(data, verts.data(), (size_t)bufferSize);
-		vulkanUnmapMemory(*logicalDevicePtr, stagingBufferMemory);
-
-		createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, vertexBuffer, vertexBufferMemory, *logicalDevicePtr, *physicalDevicePtr);
-		copyBuffer(stagingBuffer, vertexBuffer, bufferSize, *commandPoolPtr, *logicalDevicePtr, *graphicsQueuePtr);
-
-		vulkanDestroyBuffer(*logicalDevicePtr, stagingBuffer);
-		vulkanFreeMemory(*logicalDevicePtr, stagingBufferMemory);
-	}
-
-	void VulkanModelData::createIndexBuffer(std::vector<uint32_t>& indices) {
-		vk::DeviceSize bufferSize = indices.size() * sizeof(uint32_t);
-		
-		vk::Buffer stagingBuffer;
-		vk::DeviceMemory stagingBufferMemory;
-
-		createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingBufferMemory, *logicalDevicePtr, *physicalDevicePtr);
-
-		void* data;
-		vulkanMapMemory(*logicalDevicePtr, stagingBufferMemory, 0, bufferSize, vk::MemoryMapFlagBits{}, &data);
-		memcpy(data, indices.data(), (size_t)bufferSize);
-		vulkanUnmapMemory(*logicalDevicePtr, stagingBufferMemory);
-
-		createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, indexBuffer, indexBufferMemory, *logicalDevicePtr, *physicalDevicePtr);
-		copyBuffer(stagingBuffer, indexBuffer, bufferSize, *commandPoolPtr, *logicalDevicePtr, *graphicsQueuePtr);
-
-		vulkanDestroyBuffer(*logicalDevicePtr, stagingBuffer);
-		vulkanFreeMemory(*logicalDevicePtr, stagingBufferMemory);
-	}
-
-	void VulkanModelData::setupTextures() {
-		TextureStruct tStruct;
-		std::vector<std::string> maps;
-
-		maps = {
-			materialLayers[0].map_Kd.path, //difuse
-			materialLayers[0].map_bump.path, //normal
-			materialLayers[0].map_Ks.path, //roughness
-			materialLayers[0].map_Ns.path, //metallic
-			materialLayers[0].map_Ka.path //AO
-		};
-
-		for (size_t i = 0; i != maps.size(); i++) {
-			//tStruct.texture = cre
-		}
-
-
-	}
-
-
+#pragma once
+#include "VulkanModel.h"
+#include "VulkanBuffer.h"
+#include "VulkanPipelineState.h"
+#include "fast_obj.h"
+#include "Tracer.h"
+#include <algorithm>
+
+namespace CinderVk {
+	uint32_t VulkanModelData::getModelIndicesSize() {
+		return modelIndicesSize;
+	}
+
+	uint32_t VulkanModelData::getTotalIndicesSize() {
+		return totalIndicesSize;
+	}
+
+	uint32_t VulkanModelData::getModelVerticesSize() {
+		return modelVerticesSize;
+	}
+
+	uint32_t VulkanModelData::getLodCount() {
+		return static_cast<uint32_t>(lods.size());
+	}
+
+	const MeshLod& VulkanModelData::getLod(uint32_t lod) {
+		return lods[lod];
+	}
+
+	const BoundingSphere& VulkanModelData::getBounds() {
+		return bounds;
+	}
+
+	vk::ImageView VulkanModelData::getImageView(size_t idx) {
+		return textureStructs[idx].textureImageView;
+	}
+
+	vk::Sampler VulkanModelData::getTextureSampler(size_t idx) {
+		return textureStructs[idx].textureSampler;
+	}
+
+	uint8_t VulkanModelData::getMaterialFeatures() {
+		if (materialLayers.empty())
+			return 0;
+
+		const fastObjMaterial& material = materialLayers[0];
+		const char* maps[] = { material.map_Kd.path, material.map_bump.path, material.map_Ks.path, material.map_Ns.path, material.map_Ka.path }; //Same order as setupTextures
+
+		uint8_t features = 0;
+		for (uint32_t i = 0; i != MATERIAL_FEATURE_COUNT; i++)
+			if (maps[i] && maps[i][0] != '\0')
+				features |= materialFeatureBit(static_cast<MaterialFeature>(i));
+
+		return features;
+	}
+
+	vk::Buffer VulkanModelData::getVertexBuffer() {
+		return vertexBuffer;
+	}
+
+	vk::Buffer VulkanModelData::getPositionBuffer() {
+		return positionBuffer;
+	}
+
+	vk::Buffer VulkanModelData::getIndexBuffer() {
+		return indexBuffer;
+	}
+
+	void VulkanModelData::loadModelData() {
+		CINDER_TRACE_SCOPE("VulkanModelData::loadModelData");
+
+
+	}
+
+	void VulkanModelData::setupBuffers(std::vector<Vertex>& verts, std::vector<uint32_t>& indices, const MeshSimplify::LodOptions& lodOptions) {
+		CINDER_TRACE_SCOPE("VulkanModelData::setupBuffers");
+		bounds = MeshSimplify::computeBoundingSphere(verts);
+		modelIndicesSize = static_cast<uint32_t>(indices.size());
+		lods = MeshSimplify::generateLodChain(verts, indices, lodOptions); //At load time, there is no offline asset step to bake them in yet. Coarser levels are appended to indices, all share one index buffer
+
+		totalIndicesSize = static_cast<uint32_t>(indices.size());
+		modelVerticesSize = static_cast<uint32_t>(verts.size());
+
+		createVertexBuffer(verts);
+		createPositionBuffer(verts);
+		createIndexBuffer(indices);
+	}
+
+	void VulkanModelData::createVertexBuffer(std::vector<Vertex>& verts) {
+		vk::DeviceSize bufferSize = verts.size() * sizeof(Vertex);
+
+		vk::Buffer stagingBuffer;
+		vk::DeviceMemory stagingBufferMemory;
+
+		createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingBufferMemory, *logicalDevicePtr, *physicalDevicePtr);
+		
+		void* data;
+		vulkanMapMemory(*logicalDevicePtr, stagingBufferMemory, 0, bufferSize, vk::MemoryMapFlagBits{}, &data);
+		memcpy(data, verts.data(), (size_t)bufferSize);
+		vulkanUnmapMemory(*logicalDevicePtr, stagingBufferMemory);
+
+		createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, vertexBuffer, vertexBufferMemory, *logicalDevicePtr, *physicalDevicePtr);
+		copyBuffer(stagingBuffer, vertexBuffer, bufferSize, *commandPoolPtr, *logicalDevicePtr, *graphicsQueuePtr, timelinePtr);
+
+		vulkanDestroyBuffer(*logicalDevicePtr, stagingBuffer);
+		vulkanFreeMemory(*logicalDevicePtr, stagingBufferMemory);
+	}
+
+	void VulkanModelData::createPositionBuffer(std::vector<Vertex>& verts) { //Same indices as the full stream, so both draw with indexBuffer
+		vk::DeviceSize bufferSize = verts.size() * sizeof(glm::vec3);
+
+		vk::Buffer stagingBuffer;
+		vk::DeviceMemory stagingBufferMemory;
+
+		createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingBufferMemory, *logicalDevicePtr, *physicalDevicePtr);
+
+		void* data;
+		vulkanMapMemory(*logicalDevicePtr, stagingBufferMemory, 0, bufferSize, vk::MemoryMapFlagBits{}, &data);
+
+		glm::vec3* positions = static_cast<glm::vec3*>(data);
+		for (size_t i = 0; i != verts.size(); i++)
+			positions[i] = verts[i].pos;
+
+		vulkanUnmapMemory(*logicalDevicePtr, stagingBufferMemory);
+
+		createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, positionBuffer, positionBufferMemory, *logicalDevicePtr, *physicalDevicePtr);
+		copyBuffer(stagingBuffer, positionBuffer, bufferSize, *commandPoolPtr, *logicalDevicePtr, *graphicsQueuePtr, timelinePtr);
+
+		vulkanDestroyBuffer(*logicalDevicePtr, stagingBuffer);
+		vulkanFreeMemory(*logicalDevicePtr, stagingBufferMemory);
+	}
+
+	void VulkanModelData::createIndexBuffer(std::vector<uint32_t>& indices) {
+		vk::DeviceSize bufferSize = indices.size() * sizeof(uint32_t);
+		
+		vk::Buffer stagingBuffer;
+		vk::DeviceMemory stagingBufferMemory;
+
+		createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingBufferMemory, *logicalDevicePtr, *physicalDevicePtr);
+
+		void* data;
+		vulkanMapMemory(*logicalDevicePtr, stagingBufferMemory, 0, bufferSize, vk::MemoryMapFlagBits{}, &data);
+		memcpy(data, indices.data(), (size_t)bufferSize);
+		vulkanUnmapMemory(*logicalDevicePtr, stagingBufferMemory);
+
+		createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, indexBuffer, indexBufferMemory, *logicalDevicePtr, *physicalDevicePtr);
+		copyBuffer(stagingBuffer, indexBuffer, bufferSize, *commandPoolPtr, *logicalDevicePtr, *graphicsQueuePtr, timelinePtr);
+
+		vulkanDestroyBuffer(*logicalDevicePtr, stagingBuffer);
+		vulkanFreeMemory(*logicalDevicePtr, stagingBufferMemory);
+	}
+
+	uint32_t VulkanModel::selectLod(const glm::vec3& cameraPosition, float projectionScale, float screenHeight, float maxPixelError) {
+		float worldScale = std::max({ glm::length(glm::vec3(worldTransform[0])), glm::length(glm::vec3(worldTransform[1])), glm::length(glm::vec3(worldTransform[2])) });
+
+		BoundingSphere worldBounds;
+		worldBounds.centre = glm::vec3(worldTransform * glm::vec4(dataPtr->bounds.centre, 1.0f));
+		worldBounds.radius = dataPtr->bounds.radius * worldScale;
+
+		currentLod = MeshSimplify::selectLod(dataPtr->lods, worldScale, worldBounds, cameraPosition, projectionScale, screenHeight, maxPixelError, currentLod);
+		return currentLod;
+	}
+
+	uint32_t VulkanModel::getCurrentLod() {
+		return currentLod;
+	}
+
+	void VulkanModelData::setupTextures() {
+		CINDER_TRACE_SCOPE("VulkanModelData::setupTextures");
+		TextureStruct tStruct;
+		std::vector<std::string> maps;
+
+		maps = {
+			materialLayers[0].map_Kd.path, //difuse
+			materialLayers[0].map_bump.path, //normal
+			materialLayers[0].map_Ks.path, //roughness
+			materialLayers[0].map_Ns.path, //metallic
+			materialLayers[0].map_Ka.path //AO
+		};
+
+		for (size_t i = 0; i != maps.size(); i++) {
+			//tStruct.texture = cre
+		}
+
+
+	}
+
+
 }
\ No newline at end of file
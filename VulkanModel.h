@@ -1,105 +1,148 @@
-#pragma once
-#include "glm/glm.hpp"
-#include "fast_obj.h"
-#include "Vertex.h"
-#include <memory>
-
-namespace CinderVk {
-
-	struct TextureStruct { //Basic texture structure for e.g PBR maps, other info maps
-		vk::DeviceMemory textureImageMemory;
-		vk::Image texture;
-		vk::ImageView textureImageView;
-		vk::Sampler textureSampler;
-	};
-
-	struct VulkanModelData { //A structure made to contain singular model data in memory
-		VulkanModelData(const std::string& modelLocation, vk::Device& logicalDevice, vk::Queue& graphicsQueue, vk::CommandPool& commandPool, vk::PhysicalDevice& physicalDevice) :
-			modelFileLocation(modelLocation), logicalDevicePtr(&logicalDevice), graphicsQueuePtr(&graphicsQueue), commandPoolPtr(&commandPool), physicalDevicePtr(&physicalDevice)
-		{};
-
-		~VulkanModelData() {
-			logicalDevicePtr->destroyBuffer(vertexBuffer, nullptr);
-			logicalDevicePtr->freeMemory(vertexBufferMemory, nullptr);
-
-			logicalDevicePtr->destroyBuffer(indexBuffer, nullptr);
-			logicalDevicePtr->freeMemory(indexBufferMemory, nullptr);
-
-			for (auto tStruct : textureStructs) {
-				logicalDevicePtr->destroySampler(tStruct.textureSampler, nullptr);
-				logicalDevicePtr->destroyImage(tStruct.texture, nullptr);
-				logicalDevicePtr->destroyImageView(tStruct.textureImageView, nullptr);
-				logicalDevicePtr->freeMemory(tStruct.textureImageMemory, nullptr);
-			}
-		};
-
-		vk::Device* logicalDevicePtr;
-		vk::Queue* graphicsQueuePtr;
-		vk::CommandPool* commandPoolPtr;
-		vk::PhysicalDevice* physicalDevicePtr;
-
-		std::vector<fastObjMaterial> materialLayers;
-		std::vector<TextureStruct> textureStructs;
-		std::string modelFileLocation;
-
-		vk::Buffer vertexBuffer;
-		vk::Buffer indexBuffer;
-		vk::DeviceMemory vertexBufferMemory;
-		vk::DeviceMemory indexBufferMemory;
-
-		uint32_t modelIndicesSize, modelVerticesSize; //set these in setupBuffers
-
-
-		uint32_t getModelIndicesSize();
-		uint32_t getModelVerticesSize();
-
-		vk::ImageView getImageView(size_t idx);
-		vk::Sampler getTextureSampler(size_t idx);
-
-		vk::Buffer getVertexBuffer();
-		vk::Buffer getIndexBuffer();
-
-		void loadModelData();
-
-		void setupBuffers(std::vector<Vertex>& verts, std::vector<uint32_t>& indices);
-		void setupTextures();
-
-		void createVertexBuffer(std::vector<Vertex>& verts);
-		void createIndexBuffer(std::vector<uint32_t>& indices);
-	};
-
-	class VulkanModel {
-	public:
-		VulkanModel(VulkanModelData* modelDataPtr) : dataPtr(modelDataPtr) {
-			worldTransform = glm::mat4(1.0f);
-			localTransform = glm::mat4(0.0f);
-		}
-
-		~VulkanModel() {
-
-		}
-
-		glm::vec3 getPosition();
-		glm::quat getRotation();
-		float getScale();
-
-		void setPosition(glm::vec3 pos);
-		void setRotation(glm::quat rot);
-
-		void update();
-
-		void rotate(glm::vec3 rotateVec, float angle);
-		void translate(glm::vec3 translateVec);
-		void scale(float scaleFactor);
-
-	private:
-		glm::mat4 localTransform;
-		glm::mat4 worldTransform;
-
-		std::shared_ptr<VulkanModelData> dataPtr;
-
-		void setupDescriptorSets();
-
-	};
-
-}
+#pragma once
+#include "glm/glm.hpp"
+#include "fast_obj.h"
+#include "Vertex.h"
+#include "MeshSimplify.h"
+#include "VulkanDeletionQueue.h"
+#include "VulkanBuffer.h"
+#include <memory>
+
+namespace CinderVk {
+
+	struct TextureStruct { //Basic texture structure for e.g PBR maps, other info maps
+		vk::DeviceMemory textureImageMemory;
+		vk::Image texture;
+		vk::ImageView textureImageView;
+		vk::Sampler textureSampler;
+	};
+
+	struct VulkanModelData { //A structure made to contain singular model data in memory
+		VulkanModelData(const std::string& modelLocation, vk::Device& logicalDevice, vk::Queue& graphicsQueue, vk::CommandPool& commandPool, vk::PhysicalDevice& physicalDevice, VulkanDeletionQueue* deletionQueue = nullptr, VulkanTimeline* timeline = nullptr) :
+			modelFileLocation(modelLocation), logicalDevicePtr(&logicalDevice), graphicsQueuePtr(&graphicsQueue), commandPoolPtr(&commandPool), physicalDevicePtr(&physicalDevice), deletionQueuePtr(deletionQueue), timelinePtr(timeline)
+		{};
+
+		~VulkanModelData() { //Frames in flight may still read these, hand them to the deletion queue rather than stalling
+			vk::Device* device = logicalDevicePtr;
+			vk::Buffer vBuffer = vertexBuffer, pBuffer = positionBuffer, iBuffer = indexBuffer;
+			vk::DeviceMemory vMemory = vertexBufferMemory, pMemory = positionBufferMemory, iMemory = indexBufferMemory;
+			std::vector<TextureStruct> textures = textureStructs;
+
+			auto destroy = [device, vBuffer, pBuffer, iBuffer, vMemory, pMemory, iMemory, textures]() {
+				device->destroyBuffer(vBuffer, nullptr);
+				vulkanFreeMemory(*device, vMemory);
+
+				device->destroyBuffer(pBuffer, nullptr);
+				vulkanFreeMemory(*device, pMemory);
+
+				device->destroyBuffer(iBuffer, nullptr);
+				vulkanFreeMemory(*device, iMemory);
+
+				for (auto tStruct : textures) {
+					device->destroySampler(tStruct.textureSampler, nullptr);
+					device->destroyImageView(tStruct.textureImageView, nullptr);
+					device->destroyImage(tStruct.texture, nullptr);
+					vulkanFreeMemory(*device, tStruct.textureImageMemory);
+				}
+			};
+
+			if (deletionQueuePtr)
+				deletionQueuePtr->push(lastUsedFrame, destroy);
+			else
+				destroy();
+		};
+
+		void markUsed(uint64_t frameNumber) { //Call whenever the model is recorded into a frame
+			lastUsedFrame = frameNumber;
+		}
+
+		vk::Device* logicalDevicePtr;
+		vk::Queue* graphicsQueuePtr;
+		vk::CommandPool* commandPoolPtr;
+		vk::PhysicalDevice* physicalDevicePtr;
+		VulkanDeletionQueue* deletionQueuePtr;
+		VulkanTimeline* timelinePtr; //Uploads wait on their own submission instead of idling the queue
+		uint64_t lastUsedFrame = 0;
+
+		std::vector<fastObjMaterial> materialLayers;
+		std::vector<TextureStruct> textureStructs;
+		std::string modelFileLocation;
+
+		vk::Buffer vertexBuffer;
+		vk::Buffer positionBuffer; //Positions only, 12 bytes a vertex instead of 44 for depth-only passes
+		vk::Buffer indexBuffer;
+		vk::DeviceMemory vertexBufferMemory;
+		vk::DeviceMemory positionBufferMemory;
+		vk::DeviceMemory indexBufferMemory;
+
+		uint32_t modelIndicesSize, modelVerticesSize; //set these in setupBuffers, modelIndicesSize is LOD 0 only
+		uint32_t totalIndicesSize; //Every LOD, the index buffer's length
+		std::vector<MeshLod> lods; //Finest first, lods[0] is the mesh as authored
+		BoundingSphere bounds; //Object space
+
+
+		uint32_t getModelIndicesSize();
+		uint32_t getTotalIndicesSize();
+		uint32_t getModelVerticesSize();
+
+		uint32_t getLodCount();
+		const MeshLod& getLod(uint32_t lod);
+		const BoundingSphere& getBounds();
+
+		vk::ImageView getImageView(size_t idx);
+		vk::Sampler getTextureSampler(size_t idx);
+
+		uint8_t getMaterialFeatures(); //MaterialFeature bits for the maps this model actually has
+
+		vk::Buffer getVertexBuffer();
+		vk::Buffer getPositionBuffer();
+		vk::Buffer getIndexBuffer();
+
+		void loadModelData();
+
+		void setupBuffers(std::vector<Vertex>& verts, std::vector<uint32_t>& indices, const MeshSimplify::LodOptions& lodOptions = {});
+		void setupTextures();
+
+		void createVertexBuffer(std::vector<Vertex>& verts);
+		void createPositionBuffer(std::vector<Vertex>& verts);
+		void createIndexBuffer(std::vector<uint32_t>& indices);
+	};
+
+	class VulkanModel {
+	public:
+		VulkanModel(VulkanModelData* modelDataPtr) : dataPtr(modelDataPtr) {
+			worldTransform = glm::mat4(1.0f);
+			localTransform = glm::mat4(0.0f);
+		}
+
+		~VulkanModel() {
+
+		}
+
+		glm::vec3 getPosition();
+		glm::quat getRotation();
+		float getScale();
+
+		void setPosition(glm::vec3 pos);
+		void setRotation(glm::quat rot);
+
+		void update();
+
+		uint32_t selectLod(const glm::vec3& cameraPosition, float projectionScale, float screenHeight, float maxPixelError = 1.0f); //projectionScale is projection[1][1], call once per frame before drawing
+		uint32_t getCurrentLod();
+
+		void rotate(glm::vec3 rotateVec, float angle);
+		void translate(glm::vec3 translateVec);
+		void scale(float scaleFactor);
+
+	private:
+		glm::mat4 localTransform;
+		glm::mat4 worldTransform;
+		uint32_t currentLod = 0;
+
+		std::shared_ptr<VulkanModelData> dataPtr;
+
+		void setupDescriptorSets();
+
+	};
+
+}
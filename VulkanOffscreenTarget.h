@@ -0,0 +1,146 @@
+#pragma once
+#include "VulkanWrapper.h"
+#include "VulkanHelper.h"
+#include "VulkanBuffer.h"
+#include "VulkanTexture.h"
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace CinderVk {
+	class VulkanOffscreenTarget : VulkanWrapper { //Stands in for the swapchain when headless, one colour image per frame in flight
+	public:
+		VulkanOffscreenTarget(VulkanCore* coreRef, vk::Extent2D targetExtent) : VulkanWrapper(coreRef), extent(targetExtent) {
+			init();
+		}
+
+		vk::Format getFormat() {
+			return format;
+		}
+
+		vk::Extent2D getExtent() {
+			return extent;
+		}
+
+		uint32_t getImageCount() {
+			return static_cast<uint32_t>(images.size());
+		}
+
+		vk::Image getImage(uint32_t index) {
+			return images[index].image;
+		}
+
+		vk::ImageView getImageView(uint32_t index) {
+			return images[index].view;
+		}
+
+		vk::Buffer getReadbackBuffer(uint32_t index) {
+			return images[index].readbackBuffer;
+		}
+
+		vk::DeviceSize getReadbackSize() {
+			return static_cast<vk::DeviceSize>(extent.width) * extent.height * 4;
+		}
+
+		void copyReadback(uint32_t index, std::vector<uint8_t>& rgba) { //The frame that wrote it must have retired
+			rgba.resize(static_cast<size_t>(getReadbackSize()));
+			memcpy(rgba.data(), images[index].readbackMapped, rgba.size());
+		}
+
+		static void writePPM(const std::string& path, const std::vector<uint8_t>& rgba, vk::Extent2D size) { //Binary PPM, alpha dropped, enough for image diffing in CI
+			std::ofstream file(path, std::ios::binary);
+			if (!file)
+				throw std::runtime_error("Failed to open " + path + " for writing.");
+
+			file << "P6\n" << size.width << " " << size.height << "\n255\n";
+			for (size_t i = 0; i + 3 < rgba.size(); i += 4)
+				file.write(reinterpret_cast<const char*>(&rgba[i]), 3);
+		}
+
+		static bool readPPM(const std::string& path, std::vector<uint8_t>& rgba, vk::Extent2D& size) { //What writePPM writes, false if the file is missing or isn't one
+			std::ifstream file(path, std::ios::binary);
+			std::string magic;
+			uint32_t maxValue = 0;
+
+			if (!(file >> magic >> size.width >> size.height >> maxValue) || magic != "P6" || maxValue != 255)
+				return false;
+
+			file.get(); //The single whitespace byte before the pixels
+			std::vector<uint8_t> rgb(static_cast<size_t>(size.width) * size.height * 3);
+			if (!file.read(reinterpret_cast<char*>(rgb.data()), rgb.size()))
+				return false;
+
+			rgba.resize(static_cast<size_t>(size.width) * size.height * 4);
+			for (size_t pixel = 0; pixel != static_cast<size_t>(size.width) * size.height; pixel++) {
+				memcpy(&rgba[pixel * 4], &rgb[pixel * 3], 3);
+				rgba[pixel * 4 + 3] = 255;
+			}
+
+			return true;
+		}
+
+		static double compareImages(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, uint8_t tolerance) { //Fraction of RGBA8 pixels with a colour channel off by more than tolerance, alpha ignored
+			if (a.size() != b.size() || a.empty())
+				return 1.0;
+
+			size_t differing = 0;
+			for (size_t i = 0; i + 3 < a.size(); i += 4)
+				for (size_t channel = 0; channel != 3; channel++)
+					if (std::abs(static_cast<int>(a[i + channel]) - static_cast<int>(b[i + channel])) > tolerance) {
+						differing++;
+						break;
+					}
+
+			return static_cast<double>(differing) / (a.size() / 4);
+		}
+
+		~VulkanOffscreenTarget() {
+			cleanup();
+		}
+
+	private:
+		struct OffscreenImage {
+			vk::Image image;
+			vk::DeviceMemory memory;
+			vk::ImageView view;
+
+			vk::Buffer readbackBuffer;
+			vk::DeviceMemory readbackMemory;
+			void* readbackMapped = nullptr;
+		};
+
+		vk::Format format = vk::Format::eR8G8B8A8Unorm; //Supported as a colour attachment everywhere, lavapipe included, and reads back as plain RGBA8
+		vk::Extent2D extent;
+		std::array<OffscreenImage, MAX_FRAMES_IN_FLIGHT> images;
+
+		void init() {
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+			vk::PhysicalDevice* physicalDevice = getCorePtr()->getPhysicalDevicePtr();
+
+			for (auto& offscreen : images) {
+				createImage(extent.width, extent.height, format, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+					vk::MemoryPropertyFlagBits::eDeviceLocal, offscreen.image, offscreen.memory, *device, *physicalDevice);
+				offscreen.view = Helper::createImageView(offscreen.image, format, vk::ImageAspectFlagBits::eColor, *device);
+
+				createBuffer(getReadbackSize(), vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+					offscreen.readbackBuffer, offscreen.readbackMemory, *device, *physicalDevice);
+				vulkanMapMemory(*device, offscreen.readbackMemory, 0, getReadbackSize(), vk::MemoryMapFlagBits{}, &offscreen.readbackMapped);
+			}
+		}
+
+		void cleanup() {
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+
+			for (auto& offscreen : images) {
+				device->destroyBuffer(offscreen.readbackBuffer, nullptr);
+				vulkanFreeMemory(*device, offscreen.readbackMemory);
+				device->destroyImageView(offscreen.view, nullptr);
+				device->destroyImage(offscreen.image, nullptr);
+				vulkanFreeMemory(*device, offscreen.memory);
+			}
+		}
+	};
+}
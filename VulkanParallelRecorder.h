@@ -0,0 +1,307 @@
+#pragma once
+#include "VulkanWrapper.h"
+#include "VulkanHelper.h"
+#include "JobSystem.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace CinderVk {
+	struct BindStats {
+		uint64_t pipelineBinds = 0;
+		uint64_t descriptorSetBinds = 0;
+		uint64_t vertexBufferBinds = 0;
+		uint64_t indexBufferBinds = 0;
+		uint64_t elidedBinds = 0; //Skipped because the same thing was already bound
+		uint64_t draws = 0;
+
+		BindStats& operator+=(const BindStats& other) {
+			pipelineBinds += other.pipelineBinds;
+			descriptorSetBinds += other.descriptorSetBinds;
+			vertexBufferBinds += other.vertexBufferBinds;
+			indexBufferBinds += other.indexBufferBinds;
+			elidedBinds += other.elidedBinds;
+			draws += other.draws;
+			return *this;
+		}
+	};
+
+	class DrawStateCache { //Remembers what one command buffer has bound so sorted draws skip redundant binds
+	public:
+		DrawStateCache(vk::CommandBuffer& commandBuffer) : commandBufferPtr(&commandBuffer) {}
+
+		void bindPipeline(vk::Pipeline pipeline) {
+			if (pipeline == boundPipeline) {
+				stats.elidedBinds++;
+				return;
+			}
+
+			commandBufferPtr->bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+			boundPipeline = pipeline;
+			stats.pipelineBinds++;
+		}
+
+		void bindDescriptorSet(vk::PipelineLayout layout, vk::DescriptorSet descriptorSet) { //Set 0, the only set the engine's layout has
+			if (descriptorSet == boundDescriptorSet && layout == boundLayout) {
+				stats.elidedBinds++;
+				return;
+			}
+
+			commandBufferPtr->bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 0, 1, &descriptorSet, 0, nullptr);
+			boundDescriptorSet = descriptorSet;
+			boundLayout = layout;
+			stats.descriptorSetBinds++;
+		}
+
+		void bindVertexBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0) {
+			if (buffer == boundVertexBuffer && offset == boundVertexOffset) {
+				stats.elidedBinds++;
+				return;
+			}
+
+			commandBufferPtr->bindVertexBuffers(0, 1, &buffer, &offset);
+			boundVertexBuffer = buffer;
+			boundVertexOffset = offset;
+			stats.vertexBufferBinds++;
+		}
+
+		void bindIndexBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0, vk::IndexType indexType = vk::IndexType::eUint32) {
+			if (buffer == boundIndexBuffer && offset == boundIndexOffset) {
+				stats.elidedBinds++;
+				return;
+			}
+
+			commandBufferPtr->bindIndexBuffer(buffer, offset, indexType);
+			boundIndexBuffer = buffer;
+			boundIndexOffset = offset;
+			stats.indexBufferBinds++;
+		}
+
+		void pushMaterialFeatures(vk::PipelineLayout layout, uint8_t features) { //What an unspecialized fragment shader samples, survives pipeline binds that share the layout
+			if (features == pushedMaterialFeatures && layout == pushedLayout) {
+				stats.elidedBinds++;
+				return;
+			}
+
+			uint32_t value = features;
+			commandBufferPtr->pushConstants(layout, vk::ShaderStageFlagBits::eFragment, 0, sizeof(value), &value);
+			pushedMaterialFeatures = features;
+			pushedLayout = layout;
+		}
+
+		void drawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset = 0, uint32_t instanceCount = 1, uint32_t firstInstance = 0) {
+			commandBufferPtr->drawIndexed(indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+			stats.draws++;
+		}
+
+		vk::CommandBuffer& getCommandBuffer() { //For anything not tracked here, e.g. push constants
+			return *commandBufferPtr;
+		}
+
+		const BindStats& getStats() {
+			return stats;
+		}
+
+	private:
+		vk::CommandBuffer* commandBufferPtr;
+		vk::Pipeline boundPipeline;
+		vk::PipelineLayout boundLayout;
+		vk::DescriptorSet boundDescriptorSet;
+		vk::Buffer boundVertexBuffer, boundIndexBuffer;
+		vk::DeviceSize boundVertexOffset = 0, boundIndexOffset = 0;
+		vk::PipelineLayout pushedLayout;
+		uint8_t pushedMaterialFeatures = 0;
+		BindStats stats;
+	};
+
+	using DrawSliceRecorder = std::function<void(DrawStateCache& state, size_t begin, size_t end)>; //Records draws [begin, end) of the draw list, viewport and scissor are already set
+
+	struct RecordingBenchmarkResult {
+		uint32_t threadCount;
+		double milliseconds; //Per recorded frame
+		double drawsPerMillisecond;
+	};
+
+	class VulkanParallelRecorder : VulkanWrapper { //Splits a render pass's draw list into slices recorded into secondary command buffers on the job system
+	public:
+		VulkanParallelRecorder(VulkanCore* coreRef, Cinder::JobSystem* jobs) : VulkanWrapper(coreRef), jobSystem(jobs) {
+			init();
+		}
+
+		void beginFrame(uint32_t frameIndex) { //Frame's previous submission must have retired, resets every thread's pool for it in one call each
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+
+			for (auto& pool : frames[frameIndex]) {
+				device->resetCommandPool(pool.pool, vk::CommandPoolResetFlags());
+				pool.used = 0;
+			}
+
+			std::lock_guard<std::mutex> lock(statsMutex);
+			lastFrameStats = frameStats;
+			frameStats = BindStats();
+		}
+
+		void record(vk::CommandBuffer& primary, uint32_t frameIndex, vk::RenderPass renderPass, vk::Framebuffer framebuffer, vk::Extent2D extent,
+			size_t drawCount, const DrawSliceRecorder& recordSlice) { //Call inside a render pass begun with eSecondaryCommandBuffers
+			std::vector<vk::CommandBuffer> secondaries = recordSecondaries(frameIndex, renderPass, framebuffer, extent, drawCount, recordSlice);
+
+			if (!secondaries.empty())
+				primary.executeCommands(static_cast<uint32_t>(secondaries.size()), secondaries.data()); //Slice order, whichever thread recorded them
+		}
+
+		std::vector<vk::CommandBuffer> recordSecondaries(uint32_t frameIndex, vk::RenderPass renderPass, vk::Framebuffer framebuffer, vk::Extent2D extent,
+			size_t drawCount, const DrawSliceRecorder& recordSlice) {
+			if (drawCount == 0)
+				return {};
+
+			size_t sliceCount = std::min<size_t>(threadCount * SLICES_PER_THREAD, (drawCount + MIN_DRAWS_PER_SLICE - 1) / MIN_DRAWS_PER_SLICE);
+			size_t sliceSize = (drawCount + sliceCount - 1) / sliceCount;
+			sliceCount = (drawCount + sliceSize - 1) / sliceSize;
+
+			std::vector<vk::CommandBuffer> secondaries(sliceCount);
+			auto recordOne = [&](size_t slice) {
+				CINDER_TRACE_SCOPE("recordSlice");
+				uint32_t thread = jobSystem ? jobSystem->getCurrentThreadIndex() : 0;
+				if (thread == UINT32_MAX) //The render thread, it takes slices itself while waiting on the workers
+					thread = threadCount;
+
+				vk::CommandBuffer commandBuffer = acquire(frames[frameIndex][thread]);
+				vk::CommandBufferInheritanceInfo inheritanceInfo(renderPass, 0, framebuffer);
+				vk::CommandBufferBeginInfo beginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue, &inheritanceInfo);
+
+				commandBuffer.begin(&beginInfo);
+				Helper::setViewportAndScissor(commandBuffer, extent);
+
+				DrawStateCache state(commandBuffer); //Secondaries inherit no bound state, every slice starts empty
+				recordSlice(state, slice * sliceSize, std::min(drawCount, (slice + 1) * sliceSize));
+				commandBuffer.end();
+
+				{
+					std::lock_guard<std::mutex> lock(statsMutex);
+					frameStats += state.getStats();
+				}
+
+				secondaries[slice] = commandBuffer;
+			};
+
+			if (jobSystem && sliceCount > 1)
+				jobSystem->parallelFor(sliceCount, 1, [&](size_t begin, size_t end) {
+					for (size_t slice = begin; slice != end; slice++)
+						recordOne(slice);
+				});
+			else
+				for (size_t slice = 0; slice != sliceCount; slice++)
+					recordOne(slice);
+
+			return secondaries;
+		}
+
+		uint32_t getThreadCount() {
+			return threadCount;
+		}
+
+		BindStats getLastFrameBindStats() { //Totals over every slice of the previous frame
+			std::lock_guard<std::mutex> lock(statsMutex);
+			return lastFrameStats;
+		}
+
+		std::vector<RecordingBenchmarkResult> benchmarkRecording(const std::vector<uint32_t>& threadCounts, size_t drawCount, uint32_t iterations, vk::Pipeline pipeline) { //CPU recording cost only, nothing is submitted
+			std::vector<RecordingBenchmarkResult> results;
+			vk::RenderPass renderPass = getCorePtr()->getRenderPass();
+			vk::Extent2D extent = getCorePtr()->getSwapchainExtent();
+
+			for (uint32_t count : threadCounts) {
+				std::unique_ptr<Cinder::JobSystem> jobs = count > 1 ? std::make_unique<Cinder::JobSystem>(count - 1) : nullptr; //No workers at all for the single thread baseline
+				VulkanParallelRecorder recorder(getCorePtr(), jobs.get());
+				double totalMilliseconds = 0.0;
+
+				for (uint32_t i = 0; i != iterations; i++) {
+					uint32_t frameIndex = i % MAX_FRAMES_IN_FLIGHT;
+					recorder.beginFrame(frameIndex);
+
+					auto start = std::chrono::steady_clock::now();
+					recorder.recordSecondaries(frameIndex, renderPass, vk::Framebuffer(), extent, drawCount, [pipeline](DrawStateCache& state, size_t begin, size_t end) {
+						state.bindPipeline(pipeline);
+						for (size_t draw = begin; draw != end; draw++)
+							state.getCommandBuffer().draw(3, 1, 0, static_cast<uint32_t>(draw));
+					});
+					totalMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				}
+
+				double milliseconds = totalMilliseconds / std::max(iterations, 1u);
+				results.push_back({ recorder.getThreadCount(), milliseconds, milliseconds > 0.0 ? drawCount / milliseconds : 0.0 });
+			}
+
+			return results;
+		}
+
+		~VulkanParallelRecorder() {
+			cleanup();
+		}
+
+	private:
+		static constexpr size_t SLICES_PER_THREAD = 2; //A little slack so a slow slice doesn't leave the other threads idle
+		static constexpr size_t MIN_DRAWS_PER_SLICE = 64; //Below this a job costs more than it records
+
+		struct ThreadPool { //Only ever touched by its own thread while recording
+			vk::CommandPool pool;
+			std::vector<vk::CommandBuffer> secondaries;
+			size_t used = 0;
+		};
+
+		Cinder::JobSystem* jobSystem;
+		uint32_t threadCount;
+		std::array<std::vector<ThreadPool>, MAX_FRAMES_IN_FLIGHT> frames;
+
+		std::mutex statsMutex;
+		BindStats frameStats, lastFrameStats;
+
+		void init() {
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+			Helper::QueueFamilyIndices queueFamilyIndices = Helper::findQueueFamilies(*getCorePtr()->getPhysicalDevicePtr(), *getCorePtr()->getSurfacePtr());
+			threadCount = jobSystem ? jobSystem->getThreadCount() : 1;
+
+			vk::CommandPoolCreateInfo poolInfo{};
+			poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+			poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient; //Reset as a whole every frame, never per buffer
+
+			for (auto& frame : frames) {
+				frame.resize(threadCount + 1); //Plus one for the single thread outside the job system that records
+
+				for (auto& threadPool : frame)
+					if (device->createCommandPool(&poolInfo, nullptr, &threadPool.pool) != vk::Result::eSuccess)
+						throw std::runtime_error("Failed to create a recording command pool.");
+			}
+		}
+
+		void cleanup() {
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+
+			for (auto& frame : frames)
+				for (auto& threadPool : frame)
+					device->destroyCommandPool(threadPool.pool, nullptr); //Frees its buffers too
+		}
+
+		vk::CommandBuffer acquire(ThreadPool& threadPool) { //Buffers are kept across frames and reused after the pool reset
+			if (threadPool.used == threadPool.secondaries.size()) {
+				vk::CommandBufferAllocateInfo allocInfo{};
+				allocInfo.commandPool = threadPool.pool;
+				allocInfo.level = vk::CommandBufferLevel::eSecondary;
+				allocInfo.commandBufferCount = 1;
+
+				vk::CommandBuffer commandBuffer;
+				if (getCorePtr()->getLogicalDevicePtr()->allocateCommandBuffers(&allocInfo, &commandBuffer) != vk::Result::eSuccess)
+					throw std::runtime_error("Failed to allocate a secondary command buffer.");
+
+				threadPool.secondaries.push_back(commandBuffer);
+			}
+
+			return threadPool.secondaries[threadPool.used++];
+		}
+	};
+}
@@ -0,0 +1,174 @@
+#pragma once
+#include "VulkanWrapper.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace CinderVk {
+	class VulkanPipelineCache : VulkanWrapper {
+	public:
+		VulkanPipelineCache(VulkanCore* coreRef, const std::string& path = "pipelineCache.bin") : VulkanWrapper(coreRef), cacheFilePath(path) {
+			init();
+		}
+
+		vk::PipelineCache getPipelineCache() {
+			return pipelineCache;
+		}
+
+		bool wasLoadedFromDisk() {
+			return loadedFromDisk;
+		}
+
+		void save() {
+			std::vector<uint8_t> data = getCorePtr()->getLogicalDevicePtr()->getPipelineCacheData(pipelineCache);
+
+			CacheFileHeader header = makeHeader();
+			header.dataSize = data.size();
+			header.dataHash = hashData(data.data(), data.size());
+
+			std::string tempPath = cacheFilePath + ".tmp"; //Write then rename so a crash mid-write never leaves a truncated cache behind
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+			if (!file.is_open()) {
+				std::cerr << "Failed to write the pipeline cache to: " << tempPath << std::endl;
+				return;
+			}
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(data.data()), data.size());
+			file.close();
+
+			std::remove(cacheFilePath.c_str());
+			if (std::rename(tempPath.c_str(), cacheFilePath.c_str()) != 0)
+				std::cerr << "Failed to replace the pipeline cache at: " << cacheFilePath << std::endl;
+		}
+
+		~VulkanPipelineCache() {
+			cleanup();
+		}
+
+	private:
+		static constexpr uint32_t CACHE_MAGIC = 0x43504B43; //"CKPC"
+		static constexpr uint32_t CACHE_FILE_VERSION = 1;
+
+		struct CacheFileHeader { //Prepended to the driver blob, the driver's own header has no driver version in it
+			uint32_t magic;
+			uint32_t fileVersion;
+			uint32_t vendorID;
+			uint32_t deviceID;
+			uint32_t driverVersion;
+			uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+			uint64_t dataSize;
+			uint64_t dataHash;
+		};
+
+		std::string cacheFilePath;
+		vk::PipelineCache pipelineCache;
+		bool loadedFromDisk = false;
+
+		void init() {
+			std::vector<uint8_t> initialData = loadFromDisk();
+			loadedFromDisk = !initialData.empty();
+
+			vk::PipelineCacheCreateInfo cacheInfo{};
+			cacheInfo.initialDataSize = initialData.size();
+			cacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+			if (getCorePtr()->getLogicalDevicePtr()->createPipelineCache(&cacheInfo, nullptr, &pipelineCache) != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to create the pipeline cache.");
+		}
+
+		void cleanup() {
+			save();
+			getCorePtr()->getLogicalDevicePtr()->destroyPipelineCache(pipelineCache, nullptr);
+		}
+
+		CacheFileHeader makeHeader() {
+			vk::PhysicalDeviceProperties properties = getCorePtr()->getPhysicalDevicePtr()->getProperties();
+
+			CacheFileHeader header{};
+			header.magic = CACHE_MAGIC;
+			header.fileVersion = CACHE_FILE_VERSION;
+			header.vendorID = properties.vendorID;
+			header.deviceID = properties.deviceID;
+			header.driverVersion = properties.driverVersion;
+			memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE);
+
+			return header;
+		}
+
+		std::vector<uint8_t> loadFromDisk() { //Returns nothing if the file is missing or was written by a different device/driver
+			std::ifstream file(cacheFilePath, std::ios::binary);
+
+			if (!file.is_open())
+				return {};
+
+			CacheFileHeader fileHeader{};
+			if (!file.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader)))
+				return {};
+
+			CacheFileHeader expected = makeHeader();
+			if (fileHeader.magic != expected.magic || fileHeader.fileVersion != expected.fileVersion ||
+				fileHeader.vendorID != expected.vendorID || fileHeader.deviceID != expected.deviceID ||
+				fileHeader.driverVersion != expected.driverVersion ||
+				memcmp(fileHeader.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+				std::cout << "Discarding pipeline cache built for a different device or driver." << std::endl;
+				return {};
+			}
+
+			std::streampos dataStart = file.tellg();
+			file.seekg(0, std::ios::end);
+			std::streamoff available = file.tellg() - dataStart;
+			file.seekg(dataStart);
+
+			if (available < 0 || fileHeader.dataSize != static_cast<uint64_t>(available)) { //Checked before allocating, a corrupt size could ask for anything
+				std::cout << "Discarding truncated or corrupt pipeline cache." << std::endl;
+				return {};
+			}
+
+			std::vector<uint8_t> data(static_cast<size_t>(fileHeader.dataSize));
+			if (!file.read(reinterpret_cast<char*>(data.data()), data.size()) || hashData(data.data(), data.size()) != fileHeader.dataHash) {
+				std::cout << "Discarding truncated or corrupt pipeline cache." << std::endl;
+				return {};
+			}
+
+			if (!isDriverHeaderValid(data, expected))
+				return {};
+
+			return data;
+		}
+
+		static bool isDriverHeaderValid(const std::vector<uint8_t>& data, const CacheFileHeader& expected) { //VkPipelineCacheHeaderVersionOne at the start of the blob
+			struct DriverHeader {
+				uint32_t headerSize;
+				uint32_t headerVersion;
+				uint32_t vendorID;
+				uint32_t deviceID;
+				uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+			} driverHeader;
+
+			if (data.size() < sizeof(DriverHeader))
+				return false;
+
+			memcpy(&driverHeader, data.data(), sizeof(DriverHeader));
+
+			return driverHeader.headerSize >= sizeof(DriverHeader) &&
+				driverHeader.headerVersion == static_cast<uint32_t>(vk::PipelineCacheHeaderVersion::eOne) &&
+				driverHeader.vendorID == expected.vendorID && driverHeader.deviceID == expected.deviceID &&
+				memcmp(driverHeader.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+		}
+
+		static uint64_t hashData(const uint8_t* data, size_t size) { //FNV-1a
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i != size; i++) {
+				hash ^= data[i];
+				hash *= 1099511628211ull;
+			}
+
+			return hash;
+		}
+	};
+}
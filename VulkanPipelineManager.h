@@ -0,0 +1,359 @@
+#pragma once
+#include "VulkanWrapper.h"
+#include "VulkanGraphicsPipeline.h"
+#include "VulkanPipelineState.h"
+#include "VulkanDeletionQueue.h"
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace CinderVk {
+	class VulkanPipelineManager : VulkanWrapper { //Builds graphics pipelines on demand from PipelineStateKeys, identical keys share one pipeline
+	public:
+		VulkanPipelineManager(VulkanCore* coreRef) : VulkanWrapper(coreRef) {
+			init();
+		}
+
+		vk::PipelineLayout getPipelineLayout() {
+			return pipelineLayout;
+		}
+
+		uint16_t getShaderId(const std::string& path) {
+			std::lock_guard<std::mutex> lock(pipelinesMutex);
+
+			for (size_t i = 0; i != shaderPaths.size(); i++)
+				if (shaderPaths[i] == path)
+					return static_cast<uint16_t>(i);
+
+			shaderPaths.push_back(path);
+			return static_cast<uint16_t>(shaderPaths.size() - 1);
+		}
+
+		PipelineStateKey getDefaultKey() { //The engine's original hardcoded state, used as the fallback while real pipelines compile
+			PipelineStateKey key{};
+			key.vertexShaderId = getShaderId("vertexShader.spv");
+			key.fragmentShaderId = getShaderId("fragmentShader.spv");
+			key.renderPass = getCorePtr()->getRenderPass();
+
+			return key;
+		}
+
+		PipelineStateKey getMaterialKey(uint8_t materialFeatures) { //Default state with the material's unused maps compiled out
+			PipelineStateKey key = getDefaultKey();
+			key.specialized = true;
+			key.materialFeatures = materialFeatures & ALL_MATERIAL_FEATURES;
+
+			return key;
+		}
+
+		PipelineStateKey getDepthPrepassKey() { //Position-only, depth writes, no fragment stage
+			PipelineStateKey key{};
+			key.vertexShaderId = getShaderId("depthPrepass.spv");
+			key.fragmentShaderId = key.vertexShaderId; //Unused, kept on the vertex shader so fragment reloads don't rebuild it
+			key.vertexLayout = VertexLayout::ePositionOnly;
+			key.blendMode = BlendMode::eOpaque;
+			key.cullMode = vk::CullModeFlagBits::eBack;
+			key.depthOnly = true;
+			key.renderPass = getCorePtr()->getDepthOnlyRenderPass();
+
+			return key;
+		}
+
+		PipelineStateKey getAfterDepthPrepassKey(PipelineStateKey key) { //Depth is final after the pre-pass, shade only the visible surface
+			key.depthCompareOp = vk::CompareOp::eEqual;
+			key.depthWrite = false;
+
+			return key;
+		}
+
+		vk::Pipeline getPipeline(const PipelineStateKey& key) { //Never blocks on compilation, the fallbacks are built in init
+			{
+				std::lock_guard<std::mutex> lock(pipelinesMutex);
+				auto it = pipelines.find(key);
+
+				if (it != pipelines.end())
+					return it->second->getPipeline();
+
+				if (pendingPipelines.find(key) == pendingPipelines.end() && failedKeys.find(key) == failedKeys.end())
+					pendingPipelines.emplace(key, std::async(std::launch::async, [this, key]() { return buildPipeline(key); }));
+			}
+
+			return getFallbackPipeline(key);
+		}
+
+		vk::Pipeline getPipelineBlocking(const PipelineStateKey& key) { //Throws if the build fails, the key then isn't retried until its shaders change
+			std::unique_lock<std::mutex> lock(pipelinesMutex);
+			auto it = pipelines.find(key);
+
+			if (it != pipelines.end())
+				return it->second->getPipeline();
+
+			if (failedKeys.find(key) != failedKeys.end())
+				throw std::runtime_error("Pipeline failed to build earlier, waiting for a shader change.");
+
+			std::future<std::unique_ptr<VulkanGraphicsPipeline>> future;
+			auto pending = pendingPipelines.find(key);
+			if (pending != pendingPipelines.end()) {
+				future = std::move(pending->second);
+				pendingPipelines.erase(pending);
+			}
+
+			bool stale = stalePending.erase(key) != 0;
+			lock.unlock();
+			std::unique_ptr<VulkanGraphicsPipeline> pipeline;
+
+			if (stale) { //The pending compile used the old module, let it finish and build from the new one
+				try {
+					future.get();
+				}
+				catch (...) {}
+			}
+
+			try {
+				pipeline = future.valid() ? future.get() : buildPipeline(key);
+			}
+			catch (...) {
+				lock.lock();
+				failedKeys.insert(key);
+				throw;
+			}
+
+			lock.lock();
+
+			return pipelines.emplace(key, std::move(pipeline)).first->second->getPipeline(); //If another thread won the race its pipeline is kept and ours is dropped
+		}
+
+		uint16_t getSortId(const PipelineStateKey& key) { //Small stable id for DrawKeyFields::pipeline, handed out in first use order
+			std::lock_guard<std::mutex> lock(pipelinesMutex);
+			auto it = sortIds.find(key);
+
+			if (it != sortIds.end())
+				return it->second;
+
+			uint16_t id = static_cast<uint16_t>(sortIds.size());
+			sortIds.emplace(key, id);
+			return id;
+		}
+
+		bool isPipelineReady(const PipelineStateKey& key) {
+			std::lock_guard<std::mutex> lock(pipelinesMutex);
+			return pipelines.find(key) != pipelines.end();
+		}
+
+		bool hasPipelineFailed(const PipelineStateKey& key) { //Until one of key's shaders changes
+			std::lock_guard<std::mutex> lock(pipelinesMutex);
+			return failedKeys.find(key) != failedKeys.end();
+		}
+
+		void reloadShaders(const std::vector<std::string>& changedPaths) { //Rebuilds every pipeline using one of these shaders in the background
+			std::lock_guard<std::mutex> lock(pipelinesMutex);
+
+			std::unordered_set<uint16_t> changedIds;
+			for (const auto& changedPath : changedPaths)
+				for (size_t i = 0; i != shaderPaths.size(); i++)
+					if (std::filesystem::path(shaderPaths[i]).filename() == std::filesystem::path(changedPath).filename())
+						changedIds.insert(static_cast<uint16_t>(i));
+
+			for (auto it = failedKeys.begin(); it != failedKeys.end();) { //Give broken pipelines another go with the new code
+				if (changedIds.count(it->vertexShaderId) || changedIds.count(it->fragmentShaderId))
+					it = failedKeys.erase(it);
+				else
+					++it;
+			}
+
+			for (auto& pipeline : pipelines) {
+				const PipelineStateKey& key = pipeline.first;
+
+				if (!changedIds.count(key.vertexShaderId) && !changedIds.count(key.fragmentShaderId))
+					continue;
+
+				if (reloadingPipelines.find(key) != reloadingPipelines.end())
+					staleReloads.insert(key); //Already compiling the previous edit, rebuild again once that finishes
+				else
+					reloadingPipelines.emplace(key, std::async(std::launch::async, [this, key]() { return buildPipeline(key); }));
+			}
+
+			for (auto& pending : pendingPipelines) //First-time compiles may have read the old module already
+				if (changedIds.count(pending.first.vertexShaderId) || changedIds.count(pending.first.fragmentShaderId))
+					stalePending.insert(pending.first);
+		}
+
+		void update(uint64_t frameNumber) { //Call once per frame at the frame boundary, moves finished background compiles into the cache
+			std::lock_guard<std::mutex> lock(pipelinesMutex);
+
+			for (auto it = reloadingPipelines.begin(); it != reloadingPipelines.end();) {
+				if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+					++it;
+					continue;
+				}
+
+				const PipelineStateKey key = it->first;
+				std::unique_ptr<VulkanGraphicsPipeline> rebuilt;
+
+				try {
+					rebuilt = it->second.get();
+				}
+				catch (const std::exception& e) {
+					std::cerr << "Shader reload failed, keeping the previous pipeline: " << e.what() << std::endl;
+				}
+
+				if (staleReloads.erase(key)) { //Never handed out, safe to drop straight away
+					it->second = std::async(std::launch::async, [this, key]() { return buildPipeline(key); });
+					++it;
+					continue;
+				}
+
+				if (rebuilt) {
+					std::unique_ptr<VulkanGraphicsPipeline>& current = pipelines[key];
+					std::shared_ptr<VulkanGraphicsPipeline> retired = std::move(current);
+					getCorePtr()->getDeletionQueuePtr()->push(frameNumber, [retired]() mutable { retired.reset(); }); //Frames in flight may still be using the old one
+					current = std::move(rebuilt);
+				}
+
+				it = reloadingPipelines.erase(it);
+			}
+
+			for (auto it = pendingPipelines.begin(); it != pendingPipelines.end();) {
+				if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+					++it;
+					continue;
+				}
+
+				if (stalePending.erase(it->first)) { //Built from the module before the reload, never handed out so drop it and compile again
+					try {
+						it->second.get();
+					}
+					catch (...) {}
+
+					const PipelineStateKey key = it->first;
+					it->second = std::async(std::launch::async, [this, key]() { return buildPipeline(key); });
+					++it;
+					continue;
+				}
+
+				try {
+					pipelines.emplace(it->first, it->second.get());
+				}
+				catch (const std::exception& e) { //Keep drawing with the fallback rather than taking the frame down
+					std::cerr << "Background pipeline compile failed: " << e.what() << std::endl;
+					failedKeys.insert(it->first);
+				}
+
+				it = pendingPipelines.erase(it);
+			}
+		}
+
+		size_t getPipelineCount() {
+			std::lock_guard<std::mutex> lock(pipelinesMutex);
+			return pipelines.size();
+		}
+
+		~VulkanPipelineManager() {
+			cleanup();
+		}
+
+	private:
+		vk::PipelineLayout pipelineLayout;
+
+		std::mutex pipelinesMutex;
+		std::vector<std::string> shaderPaths; //Indexed by shader id
+		std::unordered_map<PipelineStateKey, std::unique_ptr<VulkanGraphicsPipeline>> pipelines;
+		std::unordered_map<PipelineStateKey, std::future<std::unique_ptr<VulkanGraphicsPipeline>>> pendingPipelines;
+		std::unordered_map<PipelineStateKey, std::future<std::unique_ptr<VulkanGraphicsPipeline>>> reloadingPipelines; //Replacements for pipelines that are still being served
+		std::unordered_set<PipelineStateKey> staleReloads;
+		std::unordered_set<PipelineStateKey> stalePending; //pendingPipelines entries whose shaders changed mid-compile
+		std::unordered_set<PipelineStateKey> failedKeys; //Not retried until the shaders change
+		std::unordered_map<PipelineStateKey, uint16_t> sortIds;
+
+		void init() {
+			vk::PipelineLayoutCreateInfo pipelineLayoutInfo{};
+			pipelineLayoutInfo.setLayoutCount = 1;
+
+			vk::DescriptorSetLayout&& layouts = getCorePtr()->getDescriptorSetLayout();
+
+			vk::PushConstantRange materialRange(vk::ShaderStageFlagBits::eFragment, 0, sizeof(uint32_t)); //MaterialFeature bits for unspecialized pipelines
+
+			pipelineLayoutInfo.pSetLayouts = &layouts;
+			pipelineLayoutInfo.pushConstantRangeCount = 1;
+			pipelineLayoutInfo.pPushConstantRanges = &materialRange;
+
+			if (getCorePtr()->getLogicalDevicePtr()->createPipelineLayout(&pipelineLayoutInfo, nullptr, &pipelineLayout) != vk::Result::eSuccess) {
+				throw std::runtime_error("Failed to create the pipeline layout.");
+			}
+
+			PipelineStateKey defaultKey = getDefaultKey();
+			PipelineStateKey afterPrepassTransparentKey = defaultKey;
+			afterPrepassTransparentKey.depthWrite = false;
+
+			for (const PipelineStateKey& fallbackKey : { defaultKey, getAfterDepthPrepassKey(defaultKey), afterPrepassTransparentKey }) //Every depth state getMainPassKey hands out. The manager is rebuilt with the render pass, so these are too
+				getPipelineBlocking(fallbackKey);
+
+			try { //Without it the pre-pass stays off, see VulkanCore's hasPipelineFailed check
+				getPipelineBlocking(getDepthPrepassKey());
+			}
+			catch (const std::exception& e) {
+				std::cerr << "Depth pre-pass pipeline unavailable: " << e.what() << std::endl;
+			}
+		}
+
+		void cleanup() {
+			for (auto& pending : pendingPipelines) { //In-flight compiles still reference the device
+				try {
+					pending.second.get();
+				}
+				catch (...) {}
+			}
+
+			for (auto& reloading : reloadingPipelines) {
+				try {
+					reloading.second.get();
+				}
+				catch (...) {}
+			}
+
+			pendingPipelines.clear();
+			reloadingPipelines.clear();
+			stalePending.clear();
+			pipelines.clear();
+			getCorePtr()->getLogicalDevicePtr()->destroyPipelineLayout(pipelineLayout, nullptr);
+		}
+
+		std::unique_ptr<VulkanGraphicsPipeline> buildPipeline(const PipelineStateKey& key) {
+			std::string vertexPath, fragmentPath;
+			{
+				std::lock_guard<std::mutex> lock(pipelinesMutex);
+				vertexPath = shaderPaths.at(key.vertexShaderId);
+				fragmentPath = shaderPaths.at(key.fragmentShaderId);
+			}
+
+			return std::make_unique<VulkanGraphicsPipeline>(getCorePtr(), key, vertexPath, fragmentPath, pipelineLayout);
+		}
+
+		vk::Pipeline getFallbackPipeline(const PipelineStateKey& key) { //Lookup only, init built every fallback so recording threads never compile
+			PipelineStateKey baseKey = key.depthOnly ? getDepthPrepassKey() : getDefaultKey();
+			PipelineStateKey fallbackKey = baseKey;
+			fallbackKey.renderPass = key.renderPass; //Only a pipeline made for a compatible render pass can stand in
+			fallbackKey.depthTest = key.depthTest; //Same depth behaviour, an eLess fallback would draw nothing after a pre-pass
+			fallbackKey.depthWrite = key.depthWrite;
+			fallbackKey.depthCompareOp = key.depthCompareOp;
+
+			std::lock_guard<std::mutex> lock(pipelinesMutex);
+			auto it = pipelines.find(fallbackKey);
+
+			if (it == pipelines.end()) //A depth state init didn't build, the render pass's default depth state beats blocking
+				it = pipelines.find(baseKey);
+
+			if (it == pipelines.end())
+				throw std::runtime_error("No fallback pipeline for this render pass, it was not built in init.");
+
+			return it->second->getPipeline();
+		}
+	};
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "vulkan/vulkan.hpp"
+#include <cstdint>
+#include <functional>
+
+namespace CinderVk {
+	enum class VertexLayout : uint8_t {
+		eStandard, //Vertex, all four attributes interleaved
+		ePositionOnly //Tightly packed positions, VulkanModelData::getPositionBuffer
+	};
+
+	enum class BlendMode : uint8_t {
+		eOpaque,
+		eAlphaBlend,
+		eAdditive
+	};
+
+	enum class MaterialFeature : uint8_t { //Bit index into PipelineStateKey::materialFeatures, matches the PBR map binding order and the shader's constant_id
+		eAlbedoMap,
+		eNormalMap,
+		eMetallicMap,
+		eRoughnessMap,
+		eAOMap
+	};
+
+	constexpr uint32_t MATERIAL_FEATURE_COUNT = 5;
+	constexpr uint8_t ALL_MATERIAL_FEATURES = (1 << MATERIAL_FEATURE_COUNT) - 1;
+	constexpr uint32_t MATERIAL_SPECIALIZED_CONSTANT_ID = MATERIAL_FEATURE_COUNT; //The shader's SPECIALIZED, without it the maps come from the material push constant
+
+	constexpr uint8_t materialFeatureBit(MaterialFeature feature) {
+		return static_cast<uint8_t>(1 << static_cast<uint8_t>(feature));
+	}
+
+	struct PipelineStateKey { //Everything that makes two graphics pipelines differ, small so hashing and comparing stay cheap
+		uint16_t vertexShaderId = 0; //Ids handed out by VulkanPipelineManager::getShaderId
+		uint16_t fragmentShaderId = 0;
+		VertexLayout vertexLayout = VertexLayout::eStandard;
+		BlendMode blendMode = BlendMode::eAlphaBlend;
+		vk::CullModeFlagBits cullMode = vk::CullModeFlagBits::eNone;
+		vk::CompareOp depthCompareOp = vk::CompareOp::eLess;
+		bool depthTest = true;
+		bool depthWrite = true;
+		bool depthOnly = false; //No fragment shader or colour attachment, e.g. the depth pre-pass
+		bool specialized = false; //false leaves the shader's runtime branches in, fed by DrawStateCache::pushMaterialFeatures. The baseline to compare permutations against
+		uint8_t materialFeatures = ALL_MATERIAL_FEATURES; //Only read when specialized, features left out are compiled out of the fragment shader
+		VkRenderPass renderPass = VK_NULL_HANDLE; //Usable with any render pass compatible with this one
+
+		uint64_t getPackedState() const {
+			return static_cast<uint64_t>(vertexShaderId) |
+				static_cast<uint64_t>(fragmentShaderId) << 16 |
+				static_cast<uint64_t>(vertexLayout) << 32 |
+				static_cast<uint64_t>(blendMode) << 36 |
+				static_cast<uint64_t>(static_cast<uint32_t>(cullMode) & 0x3) << 40 |
+				static_cast<uint64_t>(static_cast<uint32_t>(depthCompareOp) & 0x7) << 42 |
+				static_cast<uint64_t>(depthTest) << 45 |
+				static_cast<uint64_t>(depthWrite) << 46 |
+				static_cast<uint64_t>(specialized) << 47 |
+				static_cast<uint64_t>(specialized ? materialFeatures : 0) << 48 |
+				static_cast<uint64_t>(depthOnly) << 56;
+		}
+
+		bool operator==(const PipelineStateKey& other) const {
+			return getPackedState() == other.getPackedState() && renderPass == other.renderPass;
+		}
+
+		bool operator!=(const PipelineStateKey& other) const {
+			return !(*this == other);
+		}
+	};
+}
+
+namespace std {
+	template<> struct hash<CinderVk::PipelineStateKey> {
+		size_t operator()(CinderVk::PipelineStateKey const& key) const {
+			uint64_t h = key.getPackedState() * 0x9E3779B97F4A7C15ull;
+			h ^= (uint64_t)(key.renderPass) + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+			return static_cast<size_t>(h);
+		}
+	};
+}
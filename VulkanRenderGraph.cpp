@@ -0,0 +1,863 @@
+#include "VulkanRenderGraph.h"
+#include "VulkanHelper.h"
+#include "VulkanBuffer.h"
+#include "VulkanDeletionQueue.h"
+#include "VulkanGpuProfiler.h"
+#include "Tracer.h"
+#include <algorithm>
+
+namespace CinderVk {
+	namespace {
+		struct UsageInfo {
+			vk::ImageLayout layout;
+			vk::PipelineStageFlags stages;
+			vk::AccessFlags access;
+			vk::ImageUsageFlags imageUsage;
+			vk::BufferUsageFlags bufferUsage;
+		};
+
+		UsageInfo getUsageInfo(ResourceUsage usage, vk::PipelineStageFlags stages) {
+			const vk::PipelineStageFlags depthStages = vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+
+			switch (usage) {
+			case ResourceUsage::eColorAttachment:
+				return { vk::ImageLayout::eColorAttachmentOptimal, vk::PipelineStageFlagBits::eColorAttachmentOutput,
+					vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite, vk::ImageUsageFlagBits::eColorAttachment, {} };
+			case ResourceUsage::eDepthAttachment:
+				return { vk::ImageLayout::eDepthStencilAttachmentOptimal, depthStages,
+					vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite, vk::ImageUsageFlagBits::eDepthStencilAttachment, {} };
+			case ResourceUsage::eDepthAttachmentRead:
+				return { vk::ImageLayout::eDepthStencilReadOnlyOptimal, depthStages,
+					vk::AccessFlagBits::eDepthStencilAttachmentRead, vk::ImageUsageFlagBits::eDepthStencilAttachment, {} };
+			case ResourceUsage::eShaderRead:
+				return { vk::ImageLayout::eShaderReadOnlyOptimal, stages ? stages : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eFragmentShader),
+					vk::AccessFlagBits::eShaderRead, vk::ImageUsageFlagBits::eSampled, vk::BufferUsageFlagBits::eStorageBuffer };
+			case ResourceUsage::eShaderWrite:
+				return { vk::ImageLayout::eGeneral, stages ? stages : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eComputeShader),
+					vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite, vk::ImageUsageFlagBits::eStorage, vk::BufferUsageFlagBits::eStorageBuffer };
+			case ResourceUsage::eTransferSrc:
+				return { vk::ImageLayout::eTransferSrcOptimal, vk::PipelineStageFlagBits::eTransfer,
+					vk::AccessFlagBits::eTransferRead, vk::ImageUsageFlagBits::eTransferSrc, vk::BufferUsageFlagBits::eTransferSrc };
+			case ResourceUsage::eTransferDst:
+				return { vk::ImageLayout::eTransferDstOptimal, vk::PipelineStageFlagBits::eTransfer,
+					vk::AccessFlagBits::eTransferWrite, vk::ImageUsageFlagBits::eTransferDst, vk::BufferUsageFlagBits::eTransferDst };
+			}
+
+			throw std::runtime_error("Unknown render graph resource usage.");
+		}
+
+		bool isAttachmentUsage(ResourceUsage usage) {
+			return usage == ResourceUsage::eColorAttachment || usage == ResourceUsage::eDepthAttachment || usage == ResourceUsage::eDepthAttachmentRead;
+		}
+
+		bool isWriteUsage(ResourceUsage usage) {
+			return usage == ResourceUsage::eColorAttachment || usage == ResourceUsage::eDepthAttachment || usage == ResourceUsage::eShaderWrite || usage == ResourceUsage::eTransferDst;
+		}
+
+		vk::ImageAspectFlags getAspectMask(vk::Format format) {
+			switch (format) {
+			case vk::Format::eD16Unorm:
+			case vk::Format::eD32Sfloat:
+			case vk::Format::eX8D24UnormPack32:
+				return vk::ImageAspectFlagBits::eDepth;
+			case vk::Format::eD16UnormS8Uint:
+			case vk::Format::eD24UnormS8Uint:
+			case vk::Format::eD32SfloatS8Uint:
+				return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+			case vk::Format::eS8Uint:
+				return vk::ImageAspectFlagBits::eStencil;
+			default:
+				return vk::ImageAspectFlagBits::eColor;
+			}
+		}
+
+		void hashCombine(uint64_t& hash, uint64_t value) { //FNV-1a over the value's bytes
+			for (int i = 0; i != 8; i++) {
+				hash ^= (value >> (i * 8)) & 0xff;
+				hash *= 1099511628211ull;
+			}
+		}
+
+		constexpr uint64_t HASH_SEED = 14695981039346656037ull;
+	}
+
+	size_t VulkanRenderGraph::KeyHash::operator()(const RenderPassKey& key) const {
+		uint64_t hash = HASH_SEED;
+		for (const auto& attachment : key.attachments) {
+			hashCombine(hash, static_cast<uint64_t>(attachment.format));
+			hashCombine(hash, static_cast<uint64_t>(attachment.loadOp));
+			hashCombine(hash, static_cast<uint64_t>(attachment.storeOp));
+			hashCombine(hash, static_cast<uint64_t>(attachment.layout));
+		}
+
+		return static_cast<size_t>(hash);
+	}
+
+	size_t VulkanRenderGraph::KeyHash::operator()(const FramebufferKey& key) const {
+		uint64_t hash = HASH_SEED;
+		hashCombine(hash, (uint64_t)key.renderPass);
+		hashCombine(hash, (static_cast<uint64_t>(key.extent.width) << 32) | key.extent.height);
+		for (const auto& view : key.views)
+			hashCombine(hash, (uint64_t)view);
+
+		return static_cast<size_t>(hash);
+	}
+
+	void RenderGraphPassBuilder::read(RenderGraphResource resource, ResourceUsage usage, vk::PipelineStageFlags stages) {
+		if (isWriteUsage(usage))
+			throw std::runtime_error("Render graph read declared with a write usage.");
+
+		graphPtr->addAccess(passIndex, { resource, usage, stages, false, false });
+	}
+
+	void RenderGraphPassBuilder::write(RenderGraphResource resource, ResourceUsage usage, bool clear, vk::PipelineStageFlags stages) {
+		if (!isWriteUsage(usage))
+			throw std::runtime_error("Render graph write declared with a read usage.");
+
+		graphPtr->addAccess(passIndex, { resource, usage, stages, true, clear && isAttachmentUsage(usage) });
+	}
+
+	void RenderGraphPassBuilder::setSideEffects() {
+		graphPtr->passes[passIndex].sideEffects = true;
+	}
+
+	void RenderGraphPassBuilder::setSecondaryCommandBuffers() {
+		graphPtr->passes[passIndex].secondaryCommandBuffers = true;
+	}
+
+	void VulkanRenderGraph::reset() {
+		passes.clear();
+		resources.clear();
+		finalImageBarriers.clear();
+		finalSrcStages = {};
+	}
+
+	void VulkanRenderGraph::invalidateFramebuffers() {
+		destroyFramebuffers(false);
+	}
+
+	RenderGraphResource VulkanRenderGraph::createImage(const std::string& name, const RenderGraphImageDesc& desc) {
+		Resource resource;
+		resource.name = name;
+		resource.imageDesc = desc;
+		return addResource(std::move(resource));
+	}
+
+	RenderGraphResource VulkanRenderGraph::createBuffer(const std::string& name, vk::DeviceSize size) {
+		Resource resource;
+		resource.name = name;
+		resource.isImage = false;
+		resource.bufferSize = size;
+		return addResource(std::move(resource));
+	}
+
+	RenderGraphResource VulkanRenderGraph::importImage(const std::string& name, vk::Image image, vk::ImageView view, const RenderGraphImageDesc& desc, vk::ImageLayout initialLayout, vk::ImageLayout finalLayout) {
+		Resource resource;
+		resource.name = name;
+		resource.imported = true;
+		resource.output = finalLayout != vk::ImageLayout::eUndefined;
+		resource.imageDesc = desc;
+		resource.image = image;
+		resource.view = view;
+		resource.initialLayout = initialLayout;
+		resource.finalLayout = finalLayout;
+		return addResource(std::move(resource));
+	}
+
+	RenderGraphResource VulkanRenderGraph::importBuffer(const std::string& name, vk::Buffer buffer, vk::DeviceSize size) {
+		Resource resource;
+		resource.name = name;
+		resource.isImage = false;
+		resource.imported = true;
+		resource.buffer = buffer;
+		resource.bufferSize = size;
+		return addResource(std::move(resource));
+	}
+
+	void VulkanRenderGraph::markOutput(RenderGraphResource resource) {
+		resources.at(resource).output = true;
+	}
+
+	uint32_t VulkanRenderGraph::addPass(const std::string& name, const std::function<void(RenderGraphPassBuilder&)>& setup, const std::function<void(vk::CommandBuffer&)>& execute) {
+		uint32_t passIndex = static_cast<uint32_t>(passes.size());
+
+		Pass pass;
+		pass.name = name;
+		pass.execute = execute;
+		passes.push_back(std::move(pass));
+
+		RenderGraphPassBuilder builder(this, passIndex);
+		setup(builder);
+
+		return passIndex;
+	}
+
+	void VulkanRenderGraph::compile() {
+		compileCount++;
+
+		cullPasses();
+		computeLifetimes();
+		allocatePhysicalResources();
+		computeBarriers();
+		createPassRenderPasses();
+		pruneFramebuffers();
+	}
+
+	void VulkanRenderGraph::execute(vk::CommandBuffer& commandBuffer) {
+		for (auto& pass : passes) {
+			if (!pass.live)
+				continue;
+
+			CINDER_TRACE_SCOPE_DYNAMIC(pass.name);
+			GpuScope scope(profiler, commandBuffer, pass.name, !pass.secondaryCommandBuffers); //Barriers included, a pass that waits on its inputs is paying for them. No statistics query around secondaries, they'd have to inherit it
+
+			if (!pass.imageBarriers.empty() || !pass.bufferBarriers.empty())
+				commandBuffer.pipelineBarrier(pass.srcStages, pass.dstStages, {},
+					0, nullptr,
+					static_cast<uint32_t>(pass.bufferBarriers.size()), pass.bufferBarriers.data(),
+					static_cast<uint32_t>(pass.imageBarriers.size()), pass.imageBarriers.data()
+				);
+
+			if (pass.renderPass) {
+				vk::RenderPassBeginInfo renderPassInfo{};
+				renderPassInfo.renderPass = pass.renderPass;
+				renderPassInfo.framebuffer = pass.framebuffer;
+				renderPassInfo.renderArea.offset = vk::Offset2D(0, 0);
+				renderPassInfo.renderArea.extent = pass.extent;
+				renderPassInfo.clearValueCount = static_cast<uint32_t>(pass.clearValues.size());
+				renderPassInfo.pClearValues = pass.clearValues.data();
+
+				if (pass.secondaryCommandBuffers) //Dynamic state isn't inherited, each secondary sets its own viewport
+					commandBuffer.beginRenderPass(&renderPassInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+				else {
+					commandBuffer.beginRenderPass(&renderPassInfo, vk::SubpassContents::eInline);
+					Helper::setViewportAndScissor(commandBuffer, pass.extent);
+				}
+
+				if (pass.execute)
+					pass.execute(commandBuffer);
+
+				commandBuffer.endRenderPass();
+			}
+			else if (pass.execute)
+				pass.execute(commandBuffer);
+		}
+
+		if (!finalImageBarriers.empty())
+			commandBuffer.pipelineBarrier(finalSrcStages, vk::PipelineStageFlagBits::eBottomOfPipe, {},
+				0, nullptr, 0, nullptr,
+				static_cast<uint32_t>(finalImageBarriers.size()), finalImageBarriers.data()
+			);
+	}
+
+	void VulkanRenderGraph::setProfiler(VulkanGpuProfiler* gpuProfiler) {
+		profiler = gpuProfiler;
+	}
+
+	vk::Image VulkanRenderGraph::getImage(RenderGraphResource resource) {
+		return resources.at(resource).image;
+	}
+
+	vk::ImageView VulkanRenderGraph::getImageView(RenderGraphResource resource) {
+		return resources.at(resource).view;
+	}
+
+	vk::Buffer VulkanRenderGraph::getBuffer(RenderGraphResource resource) {
+		return resources.at(resource).buffer;
+	}
+
+	vk::RenderPass VulkanRenderGraph::getPassRenderPass(uint32_t pass) {
+		return passes.at(pass).renderPass;
+	}
+
+	vk::Framebuffer VulkanRenderGraph::getPassFramebuffer(uint32_t pass) {
+		return passes.at(pass).framebuffer;
+	}
+
+	vk::Extent2D VulkanRenderGraph::getPassExtent(uint32_t pass) {
+		return passes.at(pass).extent;
+	}
+
+	uint32_t VulkanRenderGraph::getCulledPassCount() {
+		return static_cast<uint32_t>(std::count_if(passes.begin(), passes.end(), [](const Pass& pass) { return !pass.live; }));
+	}
+
+	vk::DeviceSize VulkanRenderGraph::getTransientMemorySize() {
+		return transientMemorySize;
+	}
+
+	vk::DeviceSize VulkanRenderGraph::getUnaliasedMemorySize() {
+		return unaliasedMemorySize;
+	}
+
+	void VulkanRenderGraph::cleanup() { //Device is idle by now
+		releasePhysicalResources(false);
+		destroyFramebuffers(false);
+
+		for (const auto& renderPass : renderPassCache)
+			getCorePtr()->getLogicalDevicePtr()->destroyRenderPass(renderPass.second, nullptr);
+
+		renderPassCache.clear();
+	}
+
+	RenderGraphResource VulkanRenderGraph::addResource(Resource&& resource) {
+		for (const auto& existing : resources) //Names tie transients to their physical resources across frames
+			if (existing.name == resource.name)
+				throw std::runtime_error("Render graph resource " + resource.name + " declared twice.");
+
+		resources.push_back(std::move(resource));
+		return static_cast<RenderGraphResource>(resources.size() - 1);
+	}
+
+	void VulkanRenderGraph::addAccess(uint32_t pass, const ResourceAccess& access) {
+		const Resource& resource = resources.at(access.resource);
+
+		if (!resource.isImage && isAttachmentUsage(access.usage))
+			throw std::runtime_error("Render graph buffer " + resource.name + " used as an attachment.");
+
+		for (const auto& existing : passes[pass].accesses) //One state per resource per pass keeps the barrier batch valid
+			if (existing.resource == access.resource)
+				throw std::runtime_error("Render graph pass " + passes[pass].name + " declares " + resource.name + " twice.");
+
+		passes[pass].accesses.push_back(access);
+	}
+
+	void VulkanRenderGraph::cullPasses() { //Walk backwards from the outputs, a pass lives if something alive needs what it writes
+		std::vector<bool> needed(resources.size());
+		for (size_t i = 0; i != resources.size(); i++)
+			needed[i] = resources[i].output;
+
+		for (size_t p = passes.size(); p-- != 0;) {
+			Pass& pass = passes[p];
+			pass.live = pass.sideEffects;
+
+			for (const auto& access : pass.accesses)
+				if (access.write && needed[access.resource])
+					pass.live = true;
+
+			if (!pass.live)
+				continue;
+
+			for (const auto& access : pass.accesses) //A clear overwrites everything, earlier writers are only needed by reads and loads
+				if (access.write && access.clear)
+					needed[access.resource] = false;
+
+			for (const auto& access : pass.accesses)
+				if (!access.write || !access.clear)
+					needed[access.resource] = true;
+		}
+	}
+
+	void VulkanRenderGraph::computeLifetimes() {
+		for (auto& resource : resources) {
+			resource.firstPass = -1;
+			resource.lastPass = -1;
+			resource.imageUsage = {};
+			resource.bufferUsage = {};
+		}
+
+		for (size_t p = 0; p != passes.size(); p++) {
+			if (!passes[p].live)
+				continue;
+
+			for (const auto& access : passes[p].accesses) {
+				Resource& resource = resources[access.resource];
+				UsageInfo info = getUsageInfo(access.usage, access.stages);
+
+				if (resource.firstPass < 0)
+					resource.firstPass = static_cast<int>(p);
+
+				resource.lastPass = static_cast<int>(p);
+				resource.imageUsage |= info.imageUsage;
+				resource.bufferUsage |= info.bufferUsage;
+			}
+		}
+	}
+
+	void VulkanRenderGraph::allocatePhysicalResources() { //Transients whose lifetimes don't overlap share memory
+		uint64_t planHash = HASH_SEED;
+		for (const auto& resource : resources) {
+			if (resource.imported || resource.firstPass < 0)
+				continue;
+
+			hashCombine(planHash, std::hash<std::string>()(resource.name));
+			hashCombine(planHash, resource.isImage);
+			hashCombine(planHash, static_cast<uint64_t>(resource.imageDesc.format));
+			hashCombine(planHash, (static_cast<uint64_t>(resource.imageDesc.extent.width) << 32) | resource.imageDesc.extent.height);
+			hashCombine(planHash, resource.bufferSize);
+			hashCombine(planHash, static_cast<VkImageUsageFlags>(resource.imageUsage));
+			hashCombine(planHash, static_cast<VkBufferUsageFlags>(resource.bufferUsage));
+			hashCombine(planHash, (static_cast<uint64_t>(resource.firstPass) << 32) | static_cast<uint32_t>(resource.lastPass));
+		}
+
+		if (planHash != physicalPlanHash) {
+			releasePhysicalResources(true);
+
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+			vk::PhysicalDeviceMemoryProperties memoryProperties = getCorePtr()->getPhysicalDevicePtr()->getMemoryProperties();
+
+			auto hasDeviceLocalType = [&](uint32_t typeBits) {
+				for (uint32_t i = 0; i != memoryProperties.memoryTypeCount; i++)
+					if ((typeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eDeviceLocal))
+						return true;
+
+				return false;
+			};
+
+			std::vector<std::pair<RenderGraphResource, vk::MemoryRequirements>> candidates;
+
+			for (size_t i = 0; i != resources.size(); i++) {
+				const Resource& resource = resources[i];
+				if (resource.imported || resource.firstPass < 0)
+					continue;
+
+				PhysicalResource& physical = physicalResources[resource.name];
+				vk::MemoryRequirements requirements;
+
+				if (resource.isImage) {
+					vk::ImageCreateInfo imageInfo{};
+					imageInfo.imageType = vk::ImageType::e2D;
+					imageInfo.extent = vk::Extent3D(resource.imageDesc.extent.width, resource.imageDesc.extent.height, 1);
+					imageInfo.mipLevels = 1;
+					imageInfo.arrayLayers = 1;
+					imageInfo.format = resource.imageDesc.format;
+					imageInfo.tiling = vk::ImageTiling::eOptimal;
+					imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+					imageInfo.usage = resource.imageUsage;
+					imageInfo.samples = vk::SampleCountFlagBits::e1;
+					imageInfo.sharingMode = vk::SharingMode::eExclusive;
+
+					if (device->createImage(&imageInfo, nullptr, &physical.image) != vk::Result::eSuccess)
+						throw std::runtime_error("Failed to create render graph image " + resource.name + ".");
+
+					requirements = device->getImageMemoryRequirements(physical.image);
+				}
+				else {
+					vk::BufferCreateInfo bufferInfo{};
+					bufferInfo.size = resource.bufferSize;
+					bufferInfo.usage = resource.bufferUsage;
+					bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+
+					if (device->createBuffer(&bufferInfo, nullptr, &physical.buffer) != vk::Result::eSuccess)
+						throw std::runtime_error("Failed to create render graph buffer " + resource.name + ".");
+
+					requirements = device->getBufferMemoryRequirements(physical.buffer);
+				}
+
+				candidates.emplace_back(static_cast<RenderGraphResource>(i), requirements);
+				unaliasedMemorySize += requirements.size;
+			}
+
+			std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) { //Biggest first so small transients fill in around them
+				return a.second.size > b.second.size;
+			});
+
+			for (const auto& candidate : candidates) {
+				const Resource& resource = resources[candidate.first];
+				int chosenSlot = -1;
+
+				for (size_t s = 0; s != aliasSlots.size() && chosenSlot < 0; s++) {
+					AliasSlot& slot = aliasSlots[s];
+					uint32_t typeBits = slot.memoryTypeBits & candidate.second.memoryTypeBits;
+
+					if (slot.isImage != resource.isImage || !hasDeviceLocalType(typeBits))
+						continue;
+
+					bool overlaps = false;
+					for (RenderGraphResource member : slot.members)
+						if (resources[member].firstPass <= resource.lastPass && resource.firstPass <= resources[member].lastPass)
+							overlaps = true;
+
+					if (!overlaps)
+						chosenSlot = static_cast<int>(s);
+				}
+
+				if (chosenSlot < 0) {
+					AliasSlot slot;
+					slot.isImage = resource.isImage;
+					slot.memoryTypeBits = candidate.second.memoryTypeBits;
+					aliasSlots.push_back(slot);
+					chosenSlot = static_cast<int>(aliasSlots.size() - 1);
+				}
+
+				AliasSlot& slot = aliasSlots[chosenSlot];
+				slot.memoryTypeBits &= candidate.second.memoryTypeBits;
+				slot.size = std::max(slot.size, candidate.second.size);
+				slot.alignment = std::max(slot.alignment, candidate.second.alignment);
+				slot.members.push_back(candidate.first);
+				physicalResources[resource.name].aliasSlot = chosenSlot;
+			}
+
+			for (auto& slot : aliasSlots) {
+				vk::MemoryAllocateInfo allocInfo{};
+				allocInfo.allocationSize = slot.size;
+				allocInfo.memoryTypeIndex = findMemoryType(slot.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal, *getCorePtr()->getPhysicalDevicePtr());
+
+				if (device->allocateMemory(&allocInfo, nullptr, &slot.memory) != vk::Result::eSuccess)
+					throw std::runtime_error("Failed to allocate render graph transient memory.");
+
+				trackDeviceMemory(slot.memory, slot.size, allocInfo.memoryTypeIndex, slot.isImage ? MemoryCategory::eAttachment : MemoryCategory::eOther, *getCorePtr()->getPhysicalDevicePtr());
+
+				transientMemorySize += slot.size;
+
+				for (RenderGraphResource member : slot.members) { //Every member starts at offset 0, they never live at the same time
+					PhysicalResource& physical = physicalResources[resources[member].name];
+
+					if (slot.isImage) {
+						device->bindImageMemory(physical.image, slot.memory, 0);
+						vk::Format format = resources[member].imageDesc.format;
+						physical.view = Helper::createImageView(physical.image, format, getAspectMask(format), *device);
+					}
+					else
+						device->bindBufferMemory(physical.buffer, slot.memory, 0);
+				}
+			}
+
+			physicalPlanHash = planHash;
+		}
+
+		for (auto& resource : resources) {
+			if (resource.imported || resource.firstPass < 0)
+				continue;
+
+			const PhysicalResource& physical = physicalResources.at(resource.name);
+			resource.image = physical.image;
+			resource.view = physical.view;
+			resource.buffer = physical.buffer;
+			resource.aliasSlot = physical.aliasSlot;
+		}
+	}
+
+	void VulkanRenderGraph::releasePhysicalResources(bool deferred) {
+		destroyFramebuffers(deferred); //They reference the transient views
+
+		std::vector<PhysicalResource> oldResources;
+		for (const auto& physical : physicalResources)
+			oldResources.push_back(physical.second);
+
+		std::vector<vk::DeviceMemory> oldMemories;
+		for (const auto& slot : aliasSlots)
+			oldMemories.push_back(slot.memory);
+
+		physicalResources.clear();
+		aliasSlots.clear();
+		physicalPlanHash = 0;
+		transientMemorySize = 0;
+		unaliasedMemorySize = 0;
+
+		vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+		auto deleter = [device, oldResources, oldMemories]() {
+			for (const auto& physical : oldResources) {
+				device->destroyImageView(physical.view, nullptr);
+				device->destroyImage(physical.image, nullptr);
+				device->destroyBuffer(physical.buffer, nullptr);
+			}
+
+			for (const auto& memory : oldMemories)
+				vulkanFreeMemory(*device, memory);
+		};
+
+		if (deferred)
+			getCorePtr()->getDeletionQueuePtr()->push(getCorePtr()->getFrameNumber(), deleter);
+		else
+			deleter();
+	}
+
+	void VulkanRenderGraph::computeBarriers() { //One batched barrier before each pass, only where a hazard or layout change needs it
+		std::vector<AccessState> states(resources.size());
+
+		for (size_t i = 0; i != resources.size(); i++) {
+			if (!resources[i].imported)
+				continue;
+
+			states[i].layout = resources[i].initialLayout;
+			states[i].writeStages = vk::PipelineStageFlagBits::eAllCommands; //Unknown prior use, e.g. a swapchain image behind an acquire semaphore
+		}
+
+		for (size_t p = 0; p != passes.size(); p++) {
+			Pass& pass = passes[p];
+			pass.srcStages = {};
+			pass.dstStages = {};
+			pass.imageBarriers.clear();
+			pass.bufferBarriers.clear();
+
+			if (!pass.live)
+				continue;
+
+			for (const auto& access : pass.accesses) {
+				const Resource& resource = resources[access.resource];
+				AccessState& state = states[access.resource];
+				UsageInfo info = getUsageInfo(access.usage, access.stages);
+
+				if (!resource.imported && resource.firstPass == static_cast<int>(p) && resource.aliasSlot >= 0) { //Wait for whichever alias used the memory last
+					int previous = -1;
+					for (RenderGraphResource member : aliasSlots[resource.aliasSlot].members)
+						if (resources[member].lastPass < resource.firstPass && (previous < 0 || resources[member].lastPass > resources[previous].lastPass))
+							previous = static_cast<int>(member);
+
+					if (previous >= 0) {
+						state.writeStages = states[previous].writeStages | states[previous].readStages;
+						state.writeAccess = states[previous].writeAccess;
+					}
+					else { //First use this frame, the previous frame may still be using the memory with frames in flight
+						state.writeStages = aliasSlots[resource.aliasSlot].carriedStages;
+						state.writeAccess = aliasSlots[resource.aliasSlot].carriedAccess;
+					}
+				}
+
+				bool layoutChange = resource.isImage && state.layout != info.layout;
+				bool needsBarrier = false;
+				vk::PipelineStageFlags srcStages;
+
+				if (layoutChange || (access.write && (state.writeStages || state.readStages))) { //Transitions, write-after-write and write-after-read
+					needsBarrier = true;
+					srcStages = state.writeStages | state.readStages;
+				}
+				else if (!access.write && state.writeStages && (info.stages & ~state.visibleStages)) { //Read-after-write not yet visible to these stages
+					needsBarrier = true;
+					srcStages = state.writeStages;
+				}
+
+				if (needsBarrier) {
+					if (!srcStages)
+						srcStages = vk::PipelineStageFlagBits::eTopOfPipe;
+
+					if (resource.isImage) {
+						vk::ImageMemoryBarrier barrier{};
+						barrier.oldLayout = state.layout;
+						barrier.newLayout = info.layout;
+						barrier.srcAccessMask = state.writeAccess;
+						barrier.dstAccessMask = info.access;
+						barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+						barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+						barrier.image = resource.image;
+						barrier.subresourceRange = vk::ImageSubresourceRange(getAspectMask(resource.imageDesc.format), 0, 1, 0, 1);
+						pass.imageBarriers.push_back(barrier);
+					}
+					else {
+						vk::BufferMemoryBarrier barrier{};
+						barrier.srcAccessMask = state.writeAccess;
+						barrier.dstAccessMask = info.access;
+						barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+						barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+						barrier.buffer = resource.buffer;
+						barrier.offset = 0;
+						barrier.size = VK_WHOLE_SIZE;
+						pass.bufferBarriers.push_back(barrier);
+					}
+
+					pass.srcStages |= srcStages;
+					pass.dstStages |= info.stages;
+				}
+
+				if (access.write) {
+					state.writeStages = info.stages;
+					state.writeAccess = info.access;
+					state.readStages = {};
+					state.visibleStages = {};
+				}
+				else {
+					if (layoutChange) //Later readers chain off the transition
+						state.writeStages = info.stages;
+
+					state.readStages |= info.stages;
+
+					if (needsBarrier || !state.writeStages)
+						state.visibleStages |= info.stages;
+				}
+
+				state.layout = info.layout;
+			}
+		}
+
+		for (size_t i = 0; i != resources.size(); i++) {
+			const Resource& resource = resources[i];
+			if (!resource.imported || !resource.isImage || resource.finalLayout == vk::ImageLayout::eUndefined || states[i].layout == resource.finalLayout)
+				continue;
+
+			vk::ImageMemoryBarrier barrier{};
+			barrier.oldLayout = states[i].layout;
+			barrier.newLayout = resource.finalLayout;
+			barrier.srcAccessMask = states[i].writeAccess;
+			barrier.dstAccessMask = {};
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = resource.image;
+			barrier.subresourceRange = vk::ImageSubresourceRange(getAspectMask(resource.imageDesc.format), 0, 1, 0, 1);
+			finalImageBarriers.push_back(barrier);
+
+			finalSrcStages |= states[i].writeStages | states[i].readStages;
+		}
+
+		if (!finalImageBarriers.empty() && !finalSrcStages)
+			finalSrcStages = vk::PipelineStageFlagBits::eTopOfPipe;
+
+		std::vector<int> lastUsers(aliasSlots.size(), -1); //Carry each slot's final use into the next compile, which is recorded after this one on the same queue
+		for (size_t i = 0; i != resources.size(); i++) {
+			const Resource& resource = resources[i];
+			if (resource.imported || resource.aliasSlot < 0 || resource.firstPass < 0)
+				continue;
+
+			int& lastUser = lastUsers[resource.aliasSlot];
+			if (lastUser < 0 || resource.lastPass > resources[lastUser].lastPass)
+				lastUser = static_cast<int>(i);
+		}
+
+		for (size_t s = 0; s != aliasSlots.size(); s++) {
+			if (lastUsers[s] < 0)
+				continue;
+
+			const AccessState& state = states[lastUsers[s]];
+			aliasSlots[s].carriedStages = state.writeStages | state.readStages;
+			aliasSlots[s].carriedAccess = state.writeAccess;
+		}
+	}
+
+	void VulkanRenderGraph::createPassRenderPasses() { //Layouts are already right when the render pass begins, so it only does load and store
+		vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+
+		for (size_t p = 0; p != passes.size(); p++) {
+			Pass& pass = passes[p];
+			pass.renderPass = nullptr;
+			pass.framebuffer = nullptr;
+			pass.clearValues.clear();
+
+			if (!pass.live)
+				continue;
+
+			std::vector<const ResourceAccess*> attachmentAccesses; //Colour first then depth, matching VulkanRenderpass so pipelines built against it stay compatible
+			for (const auto& access : pass.accesses)
+				if (access.usage == ResourceUsage::eColorAttachment)
+					attachmentAccesses.push_back(&access);
+
+			for (const auto& access : pass.accesses)
+				if (access.usage == ResourceUsage::eDepthAttachment || access.usage == ResourceUsage::eDepthAttachmentRead)
+					attachmentAccesses.push_back(&access);
+
+			if (attachmentAccesses.empty())
+				continue;
+
+			std::vector<vk::AttachmentDescription> attachments;
+			std::vector<vk::AttachmentReference> colourRefs;
+			vk::AttachmentReference depthRef{};
+			bool hasDepth = false;
+			std::vector<vk::ImageView> views;
+			RenderPassKey renderPassKey;
+
+			for (const ResourceAccess* access : attachmentAccesses) {
+				const Resource& resource = resources[access->resource];
+				UsageInfo info = getUsageInfo(access->usage, access->stages);
+
+				bool firstUse = !resource.imported && resource.firstPass == static_cast<int>(p);
+				bool readLater = resource.output || resource.imported || resource.lastPass > static_cast<int>(p);
+
+				vk::AttachmentDescription attachment{};
+				attachment.format = resource.imageDesc.format;
+				attachment.samples = vk::SampleCountFlagBits::e1;
+				attachment.loadOp = access->clear ? vk::AttachmentLoadOp::eClear : (firstUse ? vk::AttachmentLoadOp::eDontCare : vk::AttachmentLoadOp::eLoad);
+				attachment.storeOp = readLater ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare;
+				attachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+				attachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+				attachment.initialLayout = info.layout;
+				attachment.finalLayout = info.layout;
+
+				vk::AttachmentReference reference(static_cast<uint32_t>(attachments.size()), info.layout);
+				if (access->usage == ResourceUsage::eColorAttachment)
+					colourRefs.push_back(reference);
+				else {
+					depthRef = reference;
+					hasDepth = true;
+				}
+
+				attachments.push_back(attachment);
+				views.push_back(resource.view);
+				pass.clearValues.push_back(resource.imageDesc.clearValue);
+				pass.extent = resource.imageDesc.extent;
+
+				renderPassKey.attachments.push_back({ attachment.format, attachment.loadOp, attachment.storeOp, info.layout });
+			}
+
+			auto cachedRenderPass = renderPassCache.find(renderPassKey);
+			if (cachedRenderPass == renderPassCache.end()) {
+				vk::SubpassDescription subpass{};
+				subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+				subpass.colorAttachmentCount = static_cast<uint32_t>(colourRefs.size());
+				subpass.pColorAttachments = colourRefs.data();
+				subpass.pDepthStencilAttachment = hasDepth ? &depthRef : nullptr;
+
+				vk::RenderPassCreateInfo renderPassInfo{};
+				renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+				renderPassInfo.pAttachments = attachments.data();
+				renderPassInfo.subpassCount = 1;
+				renderPassInfo.pSubpasses = &subpass;
+
+				vk::RenderPass renderPass;
+				if (device->createRenderPass(&renderPassInfo, nullptr, &renderPass) != vk::Result::eSuccess)
+					throw std::runtime_error("Failed to create the render pass for " + pass.name + ".");
+
+				cachedRenderPass = renderPassCache.emplace(renderPassKey, renderPass).first;
+			}
+
+			pass.renderPass = cachedRenderPass->second;
+
+			FramebufferKey framebufferKey{ static_cast<VkRenderPass>(pass.renderPass), pass.extent, {} };
+			for (const auto& view : views)
+				framebufferKey.views.push_back(static_cast<VkImageView>(view));
+
+			auto cachedFramebuffer = framebufferCache.find(framebufferKey);
+			if (cachedFramebuffer == framebufferCache.end()) {
+				vk::FramebufferCreateInfo framebufferInfo{};
+				framebufferInfo.renderPass = pass.renderPass;
+				framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+				framebufferInfo.pAttachments = views.data();
+				framebufferInfo.width = pass.extent.width;
+				framebufferInfo.height = pass.extent.height;
+				framebufferInfo.layers = 1;
+
+				vk::Framebuffer framebuffer;
+				if (device->createFramebuffer(&framebufferInfo, nullptr, &framebuffer) != vk::Result::eSuccess)
+					throw std::runtime_error("Failed to create the framebuffer for " + pass.name + ".");
+
+				cachedFramebuffer = framebufferCache.emplace(framebufferKey, std::make_pair(framebuffer, compileCount)).first;
+			}
+
+			cachedFramebuffer->second.second = compileCount;
+			pass.framebuffer = cachedFramebuffer->second.first;
+		}
+	}
+
+	void VulkanRenderGraph::pruneFramebuffers() { //Swapchain images rotate, so only drop framebuffers unused for longer than a full rotation
+		const uint64_t maxUnusedCompiles = 16;
+
+		for (auto it = framebufferCache.begin(); it != framebufferCache.end();) {
+			if (compileCount - it->second.second > maxUnusedCompiles) {
+				vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+				vk::Framebuffer framebuffer = it->second.first;
+				getCorePtr()->getDeletionQueuePtr()->push(getCorePtr()->getFrameNumber(), [device, framebuffer]() {
+					device->destroyFramebuffer(framebuffer, nullptr);
+				});
+
+				it = framebufferCache.erase(it);
+			}
+			else
+				it++;
+		}
+	}
+
+	void VulkanRenderGraph::destroyFramebuffers(bool deferred) {
+		vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+
+		for (const auto& cached : framebufferCache) {
+			vk::Framebuffer framebuffer = cached.second.first;
+
+			if (deferred)
+				getCorePtr()->getDeletionQueuePtr()->push(getCorePtr()->getFrameNumber(), [device, framebuffer]() {
+					device->destroyFramebuffer(framebuffer, nullptr);
+				});
+			else
+				device->destroyFramebuffer(framebuffer, nullptr);
+		}
+
+		framebufferCache.clear();
+	}
+}
@@ -0,0 +1,221 @@
+#pragma once
+#include "VulkanWrapper.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace CinderVk {
+	using RenderGraphResource = uint32_t;
+
+	enum class ResourceUsage : uint8_t {
+		eColorAttachment,
+		eDepthAttachment, //Depth test and write
+		eDepthAttachmentRead, //Depth test only, e.g. a main pass after a depth pre-pass
+		eShaderRead, //Sampled image or storage buffer read
+		eShaderWrite, //Storage image or storage buffer write
+		eTransferSrc,
+		eTransferDst
+	};
+
+	struct RenderGraphImageDesc {
+		vk::Format format = vk::Format::eUndefined;
+		vk::Extent2D extent;
+		vk::ClearValue clearValue{}; //Used by passes that write the image with clear set
+	};
+
+	class VulkanRenderGraph;
+	class VulkanGpuProfiler;
+
+	class RenderGraphPassBuilder { //Handed to a pass's setup function to declare what it touches
+	public:
+		void read(RenderGraphResource resource, ResourceUsage usage, vk::PipelineStageFlags stages = {});
+		void write(RenderGraphResource resource, ResourceUsage usage, bool clear = false, vk::PipelineStageFlags stages = {}); //clear only applies to attachments
+		void setSideEffects(); //Never culled, e.g. readbacks nothing in the graph consumes
+		void setSecondaryCommandBuffers(); //Render pass contents come from secondaries, execute may only call executeCommands
+
+	private:
+		friend class VulkanRenderGraph;
+		RenderGraphPassBuilder(VulkanRenderGraph* graph, uint32_t pass) : graphPtr(graph), passIndex(pass) {}
+
+		VulkanRenderGraph* graphPtr;
+		uint32_t passIndex;
+	};
+
+	class VulkanRenderGraph : VulkanWrapper { //Passes declare reads and writes, the graph culls, orders barriers and aliases transient memory
+	public:
+		VulkanRenderGraph(VulkanCore* coreRef) : VulkanWrapper(coreRef) {
+			init();
+		}
+
+		~VulkanRenderGraph() {
+			cleanup();
+		}
+
+		void reset(); //Start describing a new frame, physical resources and render passes are kept for reuse
+		void invalidateFramebuffers(); //Imported views were destroyed, e.g. on swapchain recreate. Device must be idle
+
+		RenderGraphResource createImage(const std::string& name, const RenderGraphImageDesc& desc);
+		RenderGraphResource createBuffer(const std::string& name, vk::DeviceSize size);
+		RenderGraphResource importImage(const std::string& name, vk::Image image, vk::ImageView view, const RenderGraphImageDesc& desc, vk::ImageLayout initialLayout, vk::ImageLayout finalLayout);
+		RenderGraphResource importBuffer(const std::string& name, vk::Buffer buffer, vk::DeviceSize size);
+		void markOutput(RenderGraphResource resource); //Keeps the passes producing it alive, imported images with a final layout are outputs already
+
+		uint32_t addPass(const std::string& name, const std::function<void(RenderGraphPassBuilder&)>& setup, const std::function<void(vk::CommandBuffer&)>& execute);
+
+		void compile();
+		void execute(vk::CommandBuffer& commandBuffer);
+		void setProfiler(VulkanGpuProfiler* gpuProfiler); //Every live pass gets a GPU scope under its own name, null turns that off
+
+		vk::Image getImage(RenderGraphResource resource);
+		vk::ImageView getImageView(RenderGraphResource resource);
+		vk::Buffer getBuffer(RenderGraphResource resource);
+		vk::RenderPass getPassRenderPass(uint32_t pass); //Valid after compile, stable while the attachment formats and load ops are
+		vk::Framebuffer getPassFramebuffer(uint32_t pass); //Valid after compile, for secondary command buffer inheritance
+		vk::Extent2D getPassExtent(uint32_t pass);
+
+		uint32_t getCulledPassCount();
+		vk::DeviceSize getTransientMemorySize(); //Actually allocated, after aliasing
+		vk::DeviceSize getUnaliasedMemorySize(); //What every transient would need on its own
+
+	private:
+		friend class RenderGraphPassBuilder;
+
+		struct ResourceAccess {
+			RenderGraphResource resource;
+			ResourceUsage usage;
+			vk::PipelineStageFlags stages;
+			bool write;
+			bool clear;
+		};
+
+		struct Pass {
+			std::string name;
+			std::vector<ResourceAccess> accesses;
+			std::function<void(vk::CommandBuffer&)> execute;
+			bool sideEffects = false;
+			bool secondaryCommandBuffers = false;
+			bool live = false;
+
+			vk::PipelineStageFlags srcStages, dstStages;
+			std::vector<vk::ImageMemoryBarrier> imageBarriers;
+			std::vector<vk::BufferMemoryBarrier> bufferBarriers;
+
+			vk::RenderPass renderPass;
+			vk::Framebuffer framebuffer;
+			vk::Extent2D extent;
+			std::vector<vk::ClearValue> clearValues;
+		};
+
+		struct Resource {
+			std::string name;
+			bool isImage = true;
+			bool imported = false;
+			bool output = false;
+
+			RenderGraphImageDesc imageDesc;
+			vk::DeviceSize bufferSize = 0;
+			vk::ImageUsageFlags imageUsage;
+			vk::BufferUsageFlags bufferUsage;
+			vk::ImageLayout initialLayout = vk::ImageLayout::eUndefined;
+			vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;
+
+			vk::Image image;
+			vk::ImageView view;
+			vk::Buffer buffer;
+
+			int firstPass = -1; //Lifetime over live passes, used for aliasing
+			int lastPass = -1;
+			int aliasSlot = -1;
+		};
+
+		struct PhysicalResource { //Transient resources survive between frames while the plan stays the same
+			vk::Image image;
+			vk::ImageView view;
+			vk::Buffer buffer;
+			int aliasSlot = -1;
+		};
+
+		struct AliasSlot {
+			bool isImage;
+			uint32_t memoryTypeBits;
+			vk::DeviceSize size = 0;
+			vk::DeviceSize alignment = 1;
+			std::vector<RenderGraphResource> members;
+			vk::DeviceMemory memory;
+
+			vk::PipelineStageFlags carriedStages; //The previous frame's last use of this memory, the next frame's first barrier waits on it
+			vk::AccessFlags carriedAccess;
+		};
+
+		struct AccessState {
+			vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+			vk::PipelineStageFlags writeStages, readStages, visibleStages;
+			vk::AccessFlags writeAccess;
+		};
+
+		std::vector<Pass> passes;
+		std::vector<Resource> resources;
+		std::vector<vk::ImageMemoryBarrier> finalImageBarriers;
+		vk::PipelineStageFlags finalSrcStages;
+
+		uint64_t physicalPlanHash = 0;
+		std::unordered_map<std::string, PhysicalResource> physicalResources;
+		std::vector<AliasSlot> aliasSlots;
+		vk::DeviceSize transientMemorySize = 0, unaliasedMemorySize = 0;
+
+		struct AttachmentKey {
+			vk::Format format;
+			vk::AttachmentLoadOp loadOp;
+			vk::AttachmentStoreOp storeOp;
+			vk::ImageLayout layout;
+
+			bool operator==(const AttachmentKey& other) const {
+				return format == other.format && loadOp == other.loadOp && storeOp == other.storeOp && layout == other.layout;
+			}
+		};
+
+		struct RenderPassKey { //The whole description, so two render passes whose hashes collide are still told apart
+			std::vector<AttachmentKey> attachments;
+
+			bool operator==(const RenderPassKey& other) const {
+				return attachments == other.attachments;
+			}
+		};
+
+		struct FramebufferKey {
+			VkRenderPass renderPass;
+			vk::Extent2D extent;
+			std::vector<VkImageView> views;
+
+			bool operator==(const FramebufferKey& other) const {
+				return renderPass == other.renderPass && extent == other.extent && views == other.views;
+			}
+		};
+
+		struct KeyHash {
+			size_t operator()(const RenderPassKey& key) const;
+			size_t operator()(const FramebufferKey& key) const;
+		};
+
+		std::unordered_map<RenderPassKey, vk::RenderPass, KeyHash> renderPassCache;
+		std::unordered_map<FramebufferKey, std::pair<vk::Framebuffer, uint64_t>, KeyHash> framebufferCache; //With the compile it was last used in
+		uint64_t compileCount = 0;
+		VulkanGpuProfiler* profiler = nullptr;
+
+		void init() {}
+		void cleanup();
+
+		RenderGraphResource addResource(Resource&& resource);
+		void addAccess(uint32_t pass, const ResourceAccess& access);
+		void cullPasses();
+		void computeLifetimes();
+		void allocatePhysicalResources();
+		void releasePhysicalResources(bool deferred);
+		void computeBarriers();
+		void createPassRenderPasses();
+		void pruneFramebuffers();
+		void destroyFramebuffers(bool deferred);
+	};
+}
@@ -1,21 +1,39 @@
-#pragma once
-#include "VulkanWrapper.h"
-#include "VulkanModel.h"
-
-class VulkanScene : VulkanWrapper { //Acts as model manager
-public:
-
-
-
-
-
-
-private:
-	std::vector<VulkanModelData> modelDatas;
-	std::vector<VulkanModel> models;
-
-
-
-
-
-};
+#pragma once
+#include "VulkanWrapper.h"
+#include "VulkanModel.h"
+
+class VulkanScene : VulkanWrapper { //Acts as model manager
+public:
+	VulkanScene(VulkanCore* coreRef) : VulkanWrapper(coreRef) {}
+
+	void makeCurrent() { //Applies this scene's render settings to the core
+		getCorePtr()->setDepthPrepassEnabled(depthPrepass);
+	}
+
+	void setDepthPrepass(bool enabled) { //Applied straight away, makeCurrent re-applies it when switching scenes
+		depthPrepass = enabled;
+		getCorePtr()->setDepthPrepassEnabled(enabled);
+	}
+
+	bool getDepthPrepass() {
+		return depthPrepass;
+	}
+
+
+
+
+
+
+private:
+	std::vector<VulkanModelData> modelDatas;
+	std::vector<VulkanModel> models;
+	bool depthPrepass = false; //Dense interiors want it on, open scenes with little overdraw are cheaper without
+
+	void init() {}
+	void cleanup() {}
+
+
+
+
+
+};
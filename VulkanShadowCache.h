@@ -0,0 +1,554 @@
+#pragma once
+#include "VulkanWrapper.h"
+#include "VulkanHelper.h"
+#include "VulkanBuffer.h"
+#include "VulkanTexture.h"
+#include "VulkanRenderGraph.h"
+#include "Vertex.h"
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/matrix_clip_space.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <vector>
+
+namespace CinderVk {
+	constexpr uint32_t MAX_SHADOWED_LIGHTS = 64;
+	constexpr uint32_t SHADOW_TILES_PER_LIGHT = 6; //Cube faces for point lights, directional lights use the first
+
+	enum class ShadowLightType : uint8_t {
+		eDirectional,
+		ePoint
+	};
+
+	struct ShadowLight {
+		ShadowLightType type = ShadowLightType::ePoint;
+		glm::vec3 position = glm::vec3(0.0f); //Directional lights: centre of the region they shadow
+		glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f); //Directional lights only
+		float radius = 10.0f; //Point light range, or half extent of the directional region
+	};
+
+	struct ShadowTile { //std430, tile n of light i is entry i * SHADOW_TILES_PER_LIGHT + n, a zero sized atlasRect means unshadowed
+		glm::mat4 viewProjection;
+		glm::vec4 atlasRect; //Offset and size in atlas UVs
+	};
+
+	using ShadowCasterCallback = std::function<void(vk::CommandBuffer& commandBuffer, vk::PipelineLayout layout, bool staticCasters)>; //The depth-only pipeline, the tile's viewport and scissor and its viewProjection are set. Bind a position-only stream, push each caster's model matrix at offset 64 and draw
+
+	class VulkanShadowCache : VulkanWrapper { //Static casters are rendered into their own atlas only when invalidated, each frame copies that and adds the dynamic casters
+	public:
+		VulkanShadowCache(VulkanCore* coreRef, uint32_t size = 4096) : VulkanWrapper(coreRef), atlasSize(size) {
+			init();
+		}
+
+		void setLights(const std::vector<ShadowLight>& shadowLights) { //Index i here is index i in the tile buffer, fragmentShader shadows point light i with it
+			size_t count = std::min<size_t>(shadowLights.size(), MAX_SHADOWED_LIGHTS);
+
+			if (lights.size() != count)
+				lights.resize(count);
+
+			for (size_t i = 0; i != count; i++) {
+				const ShadowLight& newLight = shadowLights[i];
+				CachedLight& light = lights[i];
+
+				if (light.light.type != newLight.type || glm::any(glm::greaterThan(glm::abs(light.light.position - newLight.position), glm::vec3(1e-4f))) ||
+					glm::any(glm::greaterThan(glm::abs(light.light.direction - newLight.direction), glm::vec3(1e-4f))) || std::abs(light.light.radius - newLight.radius) > 1e-4f)
+					light.staticDirty = true;
+
+				light.light = newLight;
+			}
+		}
+
+		void setCasterCallback(const ShadowCasterCallback& callback) {
+			casterCallback = callback;
+		}
+
+		void invalidateStatic() { //Static geometry changed everywhere, e.g. on scene load
+			for (auto& light : lights)
+				light.staticDirty = true;
+		}
+
+		void invalidateStatic(const glm::vec3& centre, float radius) { //Static geometry moved inside this sphere, only lights reaching it re-render
+			for (auto& light : lights)
+				if (light.light.type == ShadowLightType::eDirectional || glm::length(light.light.position - centre) < light.light.radius + radius)
+					light.staticDirty = true;
+		}
+
+		void setCamera(const glm::mat4& view, const glm::mat4& projection) { //Drives how much atlas each light gets
+			cameraPosition = glm::vec3(glm::inverse(view)[3]);
+			projectionScale = std::abs(projection[1][1]);
+		}
+
+		RenderGraphResource addPasses(VulkanRenderGraph& graph, uint32_t frameIndex) {
+			allocateTiles();
+			uploadTiles(frameIndex);
+
+			RenderGraphImageDesc desc{};
+			desc.format = depthFormat;
+			desc.extent = vk::Extent2D(atlasSize, atlasSize);
+			desc.clearValue.depthStencil = vk::ClearDepthStencilValue(1.0f, 0);
+
+			RenderGraphResource staticAtlasResource = graph.importImage("staticShadowAtlas", staticAtlas, staticAtlasView, desc, staticAtlasLayout, vk::ImageLayout::eTransferSrcOptimal);
+			RenderGraphResource atlasResource = graph.importImage("shadowAtlas", atlas, atlasView, desc, atlasLayout, vk::ImageLayout::eShaderReadOnlyOptimal);
+			staticAtlasLayout = vk::ImageLayout::eTransferSrcOptimal;
+			atlasLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+
+			std::vector<size_t> dirtyLights, tiledLights; //Snapshots, the passes execute after the dirty flags below are cleared
+			staticTilesRendered = 0;
+			for (size_t i = 0; i != lights.size(); i++) {
+				if (lights[i].level < 0)
+					continue;
+
+				tiledLights.push_back(i);
+				if (lights[i].staticDirty) {
+					dirtyLights.push_back(i);
+					staticTilesRendered += getTileCount(lights[i]);
+				}
+			}
+
+			if (!dirtyLights.empty()) {
+				staticPass = graph.addPass("shadowStatic", [&](RenderGraphPassBuilder& builder) {
+					builder.write(staticAtlasResource, ResourceUsage::eDepthAttachment);
+				}, [this, &graph, dirtyLights](vk::CommandBuffer& commandBuffer) {
+					renderTiles(commandBuffer, graph.getPassRenderPass(staticPass), dirtyLights, true);
+				});
+			}
+
+			if (!tiledLights.empty()) {
+				graph.addPass("shadowCopyStatic", [&](RenderGraphPassBuilder& builder) {
+					builder.read(staticAtlasResource, ResourceUsage::eTransferSrc);
+					builder.write(atlasResource, ResourceUsage::eTransferDst);
+				}, [this, tiledLights](vk::CommandBuffer& commandBuffer) {
+					copyStaticTiles(commandBuffer, tiledLights);
+				});
+
+				dynamicPass = graph.addPass("shadowDynamic", [&](RenderGraphPassBuilder& builder) {
+					builder.write(atlasResource, ResourceUsage::eDepthAttachment);
+				}, [this, &graph, tiledLights](vk::CommandBuffer& commandBuffer) {
+					renderTiles(commandBuffer, graph.getPassRenderPass(dynamicPass), tiledLights, false);
+				});
+			}
+
+			for (auto& light : lights)
+				light.staticDirty = false;
+
+			return atlasResource;
+		}
+
+		vk::ImageView getAtlasView() {
+			return atlasView;
+		}
+
+		vk::Sampler getSampler() { //Depth compare, sample with sampler2DShadow
+			return compareSampler;
+		}
+
+		vk::Buffer getTileBuffer(uint32_t frameIndex) {
+			return frames[frameIndex].tileBuffer;
+		}
+
+		void writeShadingDescriptors(uint32_t frameIndex, vk::DescriptorSet set) { //Bindings 9 and 10 of VulkanDescriptorSetLayout
+			vk::DescriptorImageInfo imageInfo(compareSampler, atlasView, vk::ImageLayout::eShaderReadOnlyOptimal);
+			vk::DescriptorBufferInfo bufferInfo(frames[frameIndex].tileBuffer, 0, VK_WHOLE_SIZE);
+
+			std::array<vk::WriteDescriptorSet, 2> writes = {
+				vk::WriteDescriptorSet(set, 9, 0, 1, vk::DescriptorType::eCombinedImageSampler, &imageInfo, nullptr, nullptr),
+				vk::WriteDescriptorSet(set, 10, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &bufferInfo, nullptr)
+			};
+
+			getCorePtr()->getLogicalDevicePtr()->updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+		}
+
+		uint32_t getStaticTilesRendered() { //Last frame, zero while nothing static changes
+			return staticTilesRendered;
+		}
+
+		~VulkanShadowCache() {
+			cleanup();
+		}
+
+	private:
+		static constexpr uint32_t MIN_TILE_SIZE = 128;
+
+		struct CachedLight {
+			ShadowLight light;
+			bool staticDirty = true;
+			int level = -1; //Tile size is maxTileSize >> level, -1 for no tile
+			std::array<vk::Rect2D, SHADOW_TILES_PER_LIGHT> tiles{};
+			std::array<glm::mat4, SHADOW_TILES_PER_LIGHT> viewProjections{};
+		};
+
+		struct FrameResources {
+			vk::Buffer tileBuffer;
+			vk::DeviceMemory tileMemory;
+			void* tileMapped = nullptr;
+		};
+
+		const uint32_t atlasSize;
+		uint32_t maxTileSize;
+		uint32_t levelCount;
+		vk::Format depthFormat;
+
+		vk::Image staticAtlas, atlas;
+		vk::DeviceMemory staticAtlasMemory, atlasMemory;
+		vk::ImageView staticAtlasView, atlasView;
+		vk::ImageLayout staticAtlasLayout = vk::ImageLayout::eUndefined, atlasLayout = vk::ImageLayout::eUndefined;
+		vk::Sampler compareSampler;
+		std::array<FrameResources, MAX_FRAMES_IN_FLIGHT> frames;
+
+		std::vector<CachedLight> lights;
+		ShadowCasterCallback casterCallback;
+		glm::vec3 cameraPosition = glm::vec3(0.0f);
+		float projectionScale = 1.0f; //projection[1][1]
+		uint32_t staticTilesRendered = 0;
+		uint32_t staticPass = 0, dynamicPass = 0;
+
+		vk::ShaderModule casterShader;
+		vk::PipelineLayout pipelineLayout;
+		vk::Pipeline pipeline; //Built on first use, every shadow pass's render pass is compatible with the first one's
+
+		void init() {
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+			vk::PhysicalDevice* physicalDevice = getCorePtr()->getPhysicalDevicePtr();
+			std::vector<char> shaderCode = Helper::readFile("shadowCaster.spv"); //First, so a missing shader throws before anything needs freeing
+
+			vk::ShaderModuleCreateInfo moduleInfo{};
+			moduleInfo.codeSize = shaderCode.size();
+			moduleInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+
+			if (device->createShaderModule(&moduleInfo, nullptr, &casterShader) != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to create the shadow caster shader module.");
+
+			vk::PushConstantRange pushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, 2 * sizeof(glm::mat4)); //viewProjection then model
+
+			vk::PipelineLayoutCreateInfo pipelineLayoutInfo{};
+			pipelineLayoutInfo.pushConstantRangeCount = 1;
+			pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+			if (device->createPipelineLayout(&pipelineLayoutInfo, nullptr, &pipelineLayout) != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to create the shadow caster pipeline layout.");
+
+			maxTileSize = atlasSize / 2;
+			levelCount = 1;
+			while ((maxTileSize >> levelCount) >= MIN_TILE_SIZE)
+				levelCount++;
+
+			depthFormat = Helper::findSupportedFormat({ vk::Format::eD32Sfloat, vk::Format::eD16Unorm }, vk::ImageTiling::eOptimal, //No stencil, so copies and sampling only see depth
+				vk::FormatFeatureFlagBits::eDepthStencilAttachment | vk::FormatFeatureFlagBits::eSampledImage, *physicalDevice);
+
+			createImage(atlasSize, atlasSize, depthFormat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+				vk::MemoryPropertyFlagBits::eDeviceLocal, staticAtlas, staticAtlasMemory, *device, *physicalDevice);
+			createImage(atlasSize, atlasSize, depthFormat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+				vk::MemoryPropertyFlagBits::eDeviceLocal, atlas, atlasMemory, *device, *physicalDevice);
+
+			staticAtlasView = Helper::createImageView(staticAtlas, depthFormat, vk::ImageAspectFlagBits::eDepth, *device);
+			atlasView = Helper::createImageView(atlas, depthFormat, vk::ImageAspectFlagBits::eDepth, *device);
+
+			vk::SamplerCreateInfo samplerInfo{};
+			samplerInfo.magFilter = vk::Filter::eLinear;
+			samplerInfo.minFilter = vk::Filter::eLinear;
+			samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+			samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+			samplerInfo.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+			samplerInfo.compareEnable = VK_TRUE; //Hardware 2x2 PCF
+			samplerInfo.compareOp = vk::CompareOp::eLessOrEqual;
+			samplerInfo.mipmapMode = vk::SamplerMipmapMode::eNearest;
+			samplerInfo.borderColor = vk::BorderColor::eFloatOpaqueWhite;
+
+			if (device->createSampler(&samplerInfo, nullptr, &compareSampler) != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to create the shadow sampler.");
+
+			vk::DeviceSize tileBufferSize = MAX_SHADOWED_LIGHTS * SHADOW_TILES_PER_LIGHT * sizeof(ShadowTile);
+			for (auto& frame : frames) {
+				createBuffer(tileBufferSize, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+					frame.tileBuffer, frame.tileMemory, *device, *physicalDevice);
+				vulkanMapMemory(*device, frame.tileMemory, 0, tileBufferSize, vk::MemoryMapFlagBits{}, &frame.tileMapped);
+				memset(frame.tileMapped, 0, static_cast<size_t>(tileBufferSize));
+			}
+		}
+
+		void cleanup() {
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+
+			for (auto& frame : frames) {
+				device->destroyBuffer(frame.tileBuffer, nullptr);
+				vulkanFreeMemory(*device, frame.tileMemory);
+			}
+
+			device->destroyPipeline(pipeline, nullptr);
+			device->destroyPipelineLayout(pipelineLayout, nullptr);
+			device->destroyShaderModule(casterShader, nullptr);
+			device->destroySampler(compareSampler, nullptr);
+			device->destroyImageView(atlasView, nullptr);
+			device->destroyImageView(staticAtlasView, nullptr);
+			device->destroyImage(atlas, nullptr);
+			device->destroyImage(staticAtlas, nullptr);
+			vulkanFreeMemory(*device, atlasMemory);
+			vulkanFreeMemory(*device, staticAtlasMemory);
+		}
+
+		void createPipeline(vk::RenderPass renderPass) {
+			vk::PipelineShaderStageCreateInfo stageInfo{};
+			stageInfo.stage = vk::ShaderStageFlagBits::eVertex;
+			stageInfo.module = casterShader;
+			stageInfo.pName = "main";
+
+			vk::VertexInputBindingDescription bindingDescription = Vertex::getPositionBindingDescription();
+			vk::VertexInputAttributeDescription attributeDescription = Vertex::getPositionAttributeDescription();
+
+			vk::PipelineVertexInputStateCreateInfo vertexInputInfo{};
+			vertexInputInfo.vertexBindingDescriptionCount = 1;
+			vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+			vertexInputInfo.vertexAttributeDescriptionCount = 1;
+			vertexInputInfo.pVertexAttributeDescriptions = &attributeDescription;
+
+			vk::PipelineInputAssemblyStateCreateInfo inputAssembly{};
+			inputAssembly.topology = vk::PrimitiveTopology::eTriangleList;
+
+			vk::PipelineViewportStateCreateInfo viewportState{}; //Dynamic, set per tile
+			viewportState.viewportCount = 1;
+			viewportState.scissorCount = 1;
+
+			std::array<vk::DynamicState, 2> dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+			vk::PipelineDynamicStateCreateInfo dynamicState{};
+			dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+			dynamicState.pDynamicStates = dynamicStates.data();
+
+			vk::PipelineRasterizationStateCreateInfo rasterizer{};
+			rasterizer.polygonMode = vk::PolygonMode::eFill;
+			rasterizer.cullMode = vk::CullModeFlagBits::eNone; //Cube faces flip winding, and thin casters need both sides
+			rasterizer.frontFace = vk::FrontFace::eCounterClockwise;
+			rasterizer.lineWidth = 1.0f;
+			rasterizer.depthBiasEnable = VK_TRUE; //Against acne on surfaces facing the light
+			rasterizer.depthBiasConstantFactor = 1.25f;
+			rasterizer.depthBiasSlopeFactor = 1.75f;
+
+			vk::PipelineMultisampleStateCreateInfo multisampling{};
+			multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
+
+			vk::PipelineDepthStencilStateCreateInfo depthStencil{};
+			depthStencil.depthTestEnable = VK_TRUE;
+			depthStencil.depthWriteEnable = VK_TRUE;
+			depthStencil.depthCompareOp = vk::CompareOp::eLessOrEqual; //Dynamic casters land on top of the copied static depth
+
+			vk::PipelineColorBlendStateCreateInfo colorBlending{};
+
+			vk::GraphicsPipelineCreateInfo pipelineInfo{};
+			pipelineInfo.stageCount = 1;
+			pipelineInfo.pStages = &stageInfo;
+			pipelineInfo.pVertexInputState = &vertexInputInfo;
+			pipelineInfo.pInputAssemblyState = &inputAssembly;
+			pipelineInfo.pViewportState = &viewportState;
+			pipelineInfo.pRasterizationState = &rasterizer;
+			pipelineInfo.pMultisampleState = &multisampling;
+			pipelineInfo.pDepthStencilState = &depthStencil;
+			pipelineInfo.pColorBlendState = &colorBlending;
+			pipelineInfo.pDynamicState = &dynamicState;
+			pipelineInfo.layout = pipelineLayout;
+			pipelineInfo.renderPass = renderPass;
+
+			if (getCorePtr()->getLogicalDevicePtr()->createGraphicsPipelines(getCorePtr()->getPipelineCache(), 1, &pipelineInfo, nullptr, &pipeline) != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to create the shadow caster pipeline.");
+		}
+
+		uint32_t getTileCount(const CachedLight& light) {
+			return light.light.type == ShadowLightType::ePoint ? 6 : 1;
+		}
+
+		float getImportanceLevel(const CachedLight& light) { //log2 of how many times smaller than maxTileSize the tile should be
+			if (light.light.type == ShadowLightType::eDirectional)
+				return 0.0f;
+
+			float distance = std::max(glm::length(light.light.position - cameraPosition), 1e-3f);
+			float projectedRadius = light.light.radius * projectionScale / distance; //Fraction of half the screen height the light's reach covers
+
+			if (projectedRadius >= 1.0f)
+				return 0.0f;
+
+			return std::log2(1.0f / std::max(projectedRadius, 1e-6f));
+		}
+
+		void allocateTiles() { //Repacked every frame, stable importance levels keep every tile where it was
+			std::vector<float> importance(lights.size());
+
+			for (size_t i = 0; i != lights.size(); i++) {
+				CachedLight& light = lights[i];
+				float continuous = getImportanceLevel(light);
+				int level = std::min(static_cast<int>(continuous), static_cast<int>(levelCount) - 1);
+
+				if (light.level >= 0 && continuous > light.level - 0.25f && continuous < light.level + 1.25f) //Hysteresis, a light sitting on a boundary doesn't flip sizes every frame
+					level = light.level;
+
+				importance[i] = static_cast<float>(level);
+				light.level = level;
+			}
+
+			std::vector<size_t> order(lights.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return importance[a] < importance[b]; }); //Biggest tiles first, then declaration order
+
+			std::vector<std::vector<vk::Offset2D>> freeBlocks(levelCount + 1); //Buddy allocator, level 0 blocks are maxTileSize, the atlas is four of them
+			for (uint32_t y = 0; y != atlasSize; y += maxTileSize)
+				for (uint32_t x = 0; x != atlasSize; x += maxTileSize)
+					freeBlocks[0].push_back(vk::Offset2D(static_cast<int32_t>(x), static_cast<int32_t>(y)));
+
+			for (auto& freeList : freeBlocks) //Hand out top-left first so the packing is deterministic
+				std::reverse(freeList.begin(), freeList.end());
+
+			auto allocateBlock = [&](int level, vk::Offset2D& offset) {
+				int source = level;
+				while (source >= 0 && freeBlocks[source].empty())
+					source--;
+
+				if (source < 0)
+					return false;
+
+				while (source < level) { //Split down to the wanted size, keep three quarters free
+					vk::Offset2D block = freeBlocks[source].back();
+					freeBlocks[source].pop_back();
+					int32_t half = static_cast<int32_t>(maxTileSize >> (source + 1));
+
+					freeBlocks[source + 1].push_back(vk::Offset2D(block.x + half, block.y + half));
+					freeBlocks[source + 1].push_back(vk::Offset2D(block.x, block.y + half));
+					freeBlocks[source + 1].push_back(vk::Offset2D(block.x + half, block.y));
+					freeBlocks[source + 1].push_back(block);
+					source++;
+				}
+
+				offset = freeBlocks[level].back();
+				freeBlocks[level].pop_back();
+				return true;
+			};
+
+			for (size_t index : order) {
+				CachedLight& light = lights[index];
+				std::array<vk::Rect2D, SHADOW_TILES_PER_LIGHT> tiles{};
+				int level = light.level;
+				bool allocated = false;
+
+				while (!allocated && level < static_cast<int>(levelCount)) { //Shrink until it fits, no tile at all once below MIN_TILE_SIZE
+					allocated = true;
+					uint32_t tileSize = maxTileSize >> level;
+
+					for (uint32_t face = 0; face != getTileCount(light) && allocated; face++) {
+						vk::Offset2D offset;
+						allocated = allocateBlock(level, offset);
+						tiles[face] = vk::Rect2D(offset, vk::Extent2D(tileSize, tileSize));
+					}
+
+					if (!allocated)
+						level++;
+				}
+
+				if (!allocated)
+					level = -1;
+
+				if (level != light.level || tiles != light.tiles) //Moved or resized, the cached static depth is in the wrong place
+					light.staticDirty = true;
+
+				light.level = level;
+				light.tiles = tiles;
+				updateViewProjections(light);
+			}
+		}
+
+		void updateViewProjections(CachedLight& light) {
+			const ShadowLight& source = light.light;
+
+			if (source.type == ShadowLightType::eDirectional) {
+				glm::vec3 direction = glm::normalize(source.direction);
+				glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+				glm::mat4 view = glm::lookAt(source.position - direction * source.radius, source.position, up);
+
+				light.viewProjections[0] = glm::orthoZO(-source.radius, source.radius, -source.radius, source.radius, 0.0f, 2.0f * source.radius) * view;
+				return;
+			}
+
+			static const std::array<glm::vec3, 6> faceDirections = { glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1) };
+			static const std::array<glm::vec3, 6> faceUps = { glm::vec3(0, -1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1), glm::vec3(0, -1, 0), glm::vec3(0, -1, 0) };
+			glm::mat4 projection = glm::perspectiveZO(glm::radians(90.0f), 1.0f, std::max(source.radius * 0.001f, 0.01f), source.radius);
+
+			for (size_t face = 0; face != 6; face++)
+				light.viewProjections[face] = projection * glm::lookAt(source.position, source.position + faceDirections[face], faceUps[face]);
+		}
+
+		void uploadTiles(uint32_t frameIndex) {
+			std::vector<ShadowTile> tiles(MAX_SHADOWED_LIGHTS * SHADOW_TILES_PER_LIGHT);
+			float invAtlasSize = 1.0f / static_cast<float>(atlasSize);
+
+			for (size_t i = 0; i != lights.size(); i++) {
+				const CachedLight& light = lights[i];
+				if (light.level < 0)
+					continue;
+
+				for (uint32_t face = 0; face != getTileCount(light); face++) {
+					const vk::Rect2D& rect = light.tiles[face];
+					ShadowTile& tile = tiles[i * SHADOW_TILES_PER_LIGHT + face];
+
+					tile.viewProjection = light.viewProjections[face];
+					tile.atlasRect = glm::vec4(rect.offset.x, rect.offset.y, rect.extent.width, rect.extent.height) * invAtlasSize;
+				}
+			}
+
+			memcpy(frames[frameIndex].tileMapped, tiles.data(), tiles.size() * sizeof(ShadowTile));
+		}
+
+		void renderTiles(vk::CommandBuffer& commandBuffer, vk::RenderPass renderPass, const std::vector<size_t>& lightIndices, bool staticCasters) {
+			if (!pipeline)
+				createPipeline(renderPass);
+
+			commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+
+			for (size_t index : lightIndices) {
+				const CachedLight& light = lights[index];
+
+				for (uint32_t face = 0; face != getTileCount(light); face++) {
+					const vk::Rect2D& rect = light.tiles[face];
+
+					if (staticCasters) { //Clear only this tile, the rest of the static atlas is still valid
+						vk::ClearAttachment clearAttachment(vk::ImageAspectFlagBits::eDepth, 0, vk::ClearDepthStencilValue(1.0f, 0));
+						vk::ClearRect clearRect(rect, 0, 1);
+						commandBuffer.clearAttachments(1, &clearAttachment, 1, &clearRect);
+					}
+
+					vk::Viewport viewport(static_cast<float>(rect.offset.x), static_cast<float>(rect.offset.y),
+						static_cast<float>(rect.extent.width), static_cast<float>(rect.extent.height), 0.0f, 1.0f);
+					commandBuffer.setViewport(0, 1, &viewport);
+					commandBuffer.setScissor(0, 1, &rect);
+
+					commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(glm::mat4), &light.viewProjections[face]);
+
+					if (casterCallback)
+						casterCallback(commandBuffer, pipelineLayout, staticCasters);
+				}
+			}
+		}
+
+		void copyStaticTiles(vk::CommandBuffer& commandBuffer, const std::vector<size_t>& lightIndices) {
+			std::vector<vk::ImageCopy> regions;
+
+			for (size_t index : lightIndices) {
+				const CachedLight& light = lights[index];
+
+				for (uint32_t face = 0; face != getTileCount(light); face++) {
+					const vk::Rect2D& rect = light.tiles[face];
+
+					vk::ImageCopy region{};
+					region.srcSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eDepth, 0, 0, 1);
+					region.dstSubresource = region.srcSubresource;
+					region.srcOffset = vk::Offset3D(rect.offset.x, rect.offset.y, 0);
+					region.dstOffset = region.srcOffset;
+					region.extent = vk::Extent3D(rect.extent.width, rect.extent.height, 1);
+					regions.push_back(region);
+				}
+			}
+
+			commandBuffer.copyImage(staticAtlas, vk::ImageLayout::eTransferSrcOptimal, atlas, vk::ImageLayout::eTransferDstOptimal,
+				static_cast<uint32_t>(regions.size()), regions.data());
+		}
+	};
+}
@@ -1,157 +1,182 @@
-#pragma once
-
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-
-#include "vulkan/vulkan.hpp"
-#include "VulkanBuffer.h"
-
-namespace CinderVk {
-	void createImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Image& image, vk::DeviceMemory& imageMemory, vk::Device& device, vk::PhysicalDevice& physicalDevice) {
-		vk::ImageCreateInfo imageInfo{};
-		imageInfo.imageType = vk::ImageType::e2D;
-		imageInfo.extent.width = width;
-		imageInfo.extent.height = height;
-		imageInfo.extent.depth = 1;
-		imageInfo.mipLevels = 1;
-		imageInfo.arrayLayers = 1;
-		imageInfo.format = format;
-		imageInfo.tiling = tiling;
-		imageInfo.initialLayout = vk::ImageLayout::eUndefined;
-		imageInfo.usage = usage;
-		imageInfo.samples = vk::SampleCountFlagBits::e1;
-		imageInfo.sharingMode = vk::SharingMode::eExclusive;
-
-		if (device.createImage(&imageInfo, nullptr, &image) != vk::Result::eSuccess) {
-			throw std::runtime_error("Failed to create image");
-		}
-
-		vk::MemoryRequirements memRequirements;
-		device.getImageMemoryRequirements(image, &memRequirements);
-
-		vk::MemoryAllocateInfo allocInfo{};
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties, physicalDevice);
-
-		if (device.allocateMemory(&allocInfo, nullptr, &imageMemory) != vk::Result::eSuccess) {
-			throw std::runtime_error("Failed to allocate image memory");
-		}
-
-		device.bindImageMemory(image, imageMemory, 0);
-	}
-
-	void transitionImageLayout(vk::Image& image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, vk::CommandPool& commandPool, vk::Device& device, vk::Queue& graphicsQueue) {
-		vk::CommandBuffer commandBuffer = beginSingleTimeCommands(commandPool, device);
-
-		vk::ImageMemoryBarrier barrier{};
-		barrier.oldLayout = oldLayout;
-		barrier.newLayout = newLayout;
-		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.image = image;
-		barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-		barrier.subresourceRange.baseMipLevel = 0;
-		barrier.subresourceRange.levelCount = 1;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
-		//barrier.srcAccessMask = vk::AccessFlagBits::;
-		//barrier.dstAccessMask = 0;
-
-		vk::PipelineStageFlags sourceStage, destinationStage;
-
-		if (oldLayout == vk::ImageLayout::eUndefined && newLayout == vk::ImageLayout::eTransferDstOptimal) {
-			//barrier.srcAccessMask = 0;
-			barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-
-			sourceStage = vk::PipelineStageFlagBits::eTopOfPipe;
-			destinationStage = vk::PipelineStageFlagBits::eTransfer;
-		}
-		else if (oldLayout == vk::ImageLayout::eTransferDstOptimal && newLayout == vk::ImageLayout::eShaderReadOnlyOptimal) {
-			barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-			barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-			sourceStage = vk::PipelineStageFlagBits::eTransfer;
-			destinationStage = vk::PipelineStageFlagBits::eFragmentShader;
-		}
-		else {
-			throw std::invalid_argument("Unsupported layout transition.");
-		}
-
-
-		commandBuffer.pipelineBarrier(sourceStage, destinationStage, vk::DependencyFlags(), nullptr, nullptr, barrier);
-
-		endSingleTimeCommands(commandBuffer, graphicsQueue, device, commandPool);
-	}
-
-	void copyBufferToImage(vk::Buffer& buffer, vk::Image image, uint32_t width, uint32_t height, vk::CommandPool& commandPool, vk::Device& logicalDevice, vk::Queue& graphicsQueue) {
-		vk::CommandBuffer commandBuffer = beginSingleTimeCommands(commandPool, logicalDevice);
-
-		vk::BufferImageCopy region{};
-		region.bufferOffset = 0;
-		region.bufferRowLength = 0;
-		region.bufferImageHeight = 0;
-
-		region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-		region.imageSubresource.mipLevel = 0;
-		region.imageSubresource.baseArrayLayer = 0;
-		region.imageSubresource.layerCount = 1;
-
-		region.imageOffset = vk::Offset3D({ 0, 0, 0 });
-		region.imageExtent = vk::Extent3D({
-			width, height, 1
-		});
-
-		commandBuffer.copyBufferToImage(
-			buffer,
-			image,
-			vk::ImageLayout::eTransferDstOptimal,
-			1,
-			&region
-		);
-
-		endSingleTimeCommands(commandBuffer, graphicsQueue, logicalDevice, commandPool);
-	}
-
-	vk::Image createTextureImage(const std::string& texturePath, vk::Device& logicalDevice, vk::PhysicalDevice& physicalDevice, vk::DeviceMemory& textureImageMemory, vk::CommandPool& commandPool, vk::Queue& graphicsQueue) {
-		int texWidth, texHeight, texChannels;
-		vk::Image textureImage;
-		stbi_uc* pixels = stbi_load(texturePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-		vk::DeviceSize imageSize = texWidth * texHeight * 4;
-
-		if (!pixels)
-			throw std::runtime_error("Failed to load the texture image of: " + texturePath);
-
-		vk::Buffer stagingBuffer;
-		vk::DeviceMemory stagingBufferMemory;
-
-		createBuffer(imageSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingBufferMemory, logicalDevice, physicalDevice);
-		void* data;
-		vkMapMemory(logicalDevice, stagingBufferMemory, 0, imageSize, 0, &data);
-		memcpy(data, pixels, static_cast<size_t>(imageSize));
-		vkUnmapMemory(logicalDevice, stagingBufferMemory);
-
-		stbi_image_free(pixels);
-
-		createImage(texWidth, texHeight, vk::Format::eR8G8B8A8Srgb, vk::ImageTiling::eOptimal,
-			vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
-			vk::MemoryPropertyFlagBits::eDeviceLocal, textureImage, textureImageMemory, logicalDevice, physicalDevice
-		);
-
-		transitionImageLayout(textureImage, vk::Format::eR8G8B8A8Srgb, vk::ImageLayout::eUndefined,
-			vk::ImageLayout::eTransferDstOptimal,
-			commandPool, logicalDevice, graphicsQueue
-		);
-
-		copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), commandPool, logicalDevice, graphicsQueue);
-
-		transitionImageLayout(textureImage, vk::Format::eR8G8B8A8Srgb, vk::ImageLayout::eTransferDstOptimal,
-			vk::ImageLayout::eShaderReadOnlyOptimal,
-			commandPool, logicalDevice, graphicsQueue
-		);
-
-		logicalDevice.destroyBuffer(stagingBuffer, nullptr);
-		logicalDevice.freeMemory(stagingBufferMemory, nullptr);
-
-		return textureImage;
-	}
-}
+#pragma once
+
+#include "vulkan/vulkan.hpp"
+#include "VulkanBuffer.h"
+#include "TextureDecode.h"
+
+namespace CinderVk {
+	void createImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Image& image, vk::DeviceMemory& imageMemory, vk::Device& device, vk::PhysicalDevice& physicalDevice) {
+		vk::ImageCreateInfo imageInfo{};
+		imageInfo.imageType = vk::ImageType::e2D;
+		imageInfo.extent.width = width;
+		imageInfo.extent.height = height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = format;
+		imageInfo.tiling = tiling;
+		imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+		imageInfo.usage = usage;
+		imageInfo.samples = vk::SampleCountFlagBits::e1;
+		imageInfo.sharingMode = vk::SharingMode::eExclusive;
+
+		if (device.createImage(&imageInfo, nullptr, &image) != vk::Result::eSuccess) {
+			throw std::runtime_error("Failed to create image");
+		}
+
+		vk::MemoryRequirements memRequirements;
+		device.getImageMemoryRequirements(image, &memRequirements);
+
+		vk::MemoryAllocateInfo allocInfo{};
+		allocInfo.allocationSize = memRequirements.size;
+		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties, physicalDevice);
+
+		if (device.allocateMemory(&allocInfo, nullptr, &imageMemory) != vk::Result::eSuccess) {
+			throw std::runtime_error("Failed to allocate image memory");
+		}
+
+		trackDeviceMemory(imageMemory, allocInfo.allocationSize, allocInfo.memoryTypeIndex, categorizeImage(usage), physicalDevice);
+
+		device.bindImageMemory(image, imageMemory, 0);
+	}
+
+	void transitionImageLayout(vk::Image& image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, vk::CommandPool& commandPool, vk::Device& device, vk::Queue& graphicsQueue, VulkanTimeline* timeline = nullptr) {
+		vk::CommandBuffer commandBuffer = beginSingleTimeCommands(commandPool, device);
+
+		vk::ImageMemoryBarrier barrier{};
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		//barrier.srcAccessMask = vk::AccessFlagBits::;
+		//barrier.dstAccessMask = 0;
+
+		vk::PipelineStageFlags sourceStage, destinationStage;
+
+		if (oldLayout == vk::ImageLayout::eUndefined && newLayout == vk::ImageLayout::eTransferDstOptimal) {
+			//barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+
+			sourceStage = vk::PipelineStageFlagBits::eTopOfPipe;
+			destinationStage = vk::PipelineStageFlagBits::eTransfer;
+		}
+		else if (oldLayout == vk::ImageLayout::eTransferDstOptimal && newLayout == vk::ImageLayout::eShaderReadOnlyOptimal) {
+			barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+			barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+			sourceStage = vk::PipelineStageFlagBits::eTransfer;
+			destinationStage = vk::PipelineStageFlagBits::eFragmentShader;
+		}
+		else {
+			throw std::invalid_argument("Unsupported layout transition.");
+		}
+
+
+		commandBuffer.pipelineBarrier(sourceStage, destinationStage, vk::DependencyFlags(), nullptr, nullptr, barrier);
+
+		endSingleTimeCommands(commandBuffer, graphicsQueue, device, commandPool, timeline);
+	}
+
+	void copyBufferToImage(vk::Buffer& buffer, vk::Image image, uint32_t width, uint32_t height, vk::CommandPool& commandPool, vk::Device& logicalDevice, vk::Queue& graphicsQueue, vk::DeviceSize bufferOffset = 0, VulkanTimeline* timeline = nullptr) {
+		vk::CommandBuffer commandBuffer = beginSingleTimeCommands(commandPool, logicalDevice);
+
+		vk::BufferImageCopy region{};
+		region.bufferOffset = bufferOffset;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+
+		region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+
+		region.imageOffset = vk::Offset3D({ 0, 0, 0 });
+		region.imageExtent = vk::Extent3D({
+			width, height, 1
+		});
+
+		commandBuffer.copyBufferToImage(
+			buffer,
+			image,
+			vk::ImageLayout::eTransferDstOptimal,
+			1,
+			&region
+		);
+
+		endSingleTimeCommands(commandBuffer, graphicsQueue, logicalDevice, commandPool, timeline);
+	}
+
+	std::vector<vk::Image> createTextureImages(const std::vector<std::string>& texturePaths, const std::vector<vk::Format>& formats, vk::Device& logicalDevice, vk::PhysicalDevice& physicalDevice, std::vector<vk::DeviceMemory>& textureImageMemories, vk::CommandPool& commandPool, vk::Queue& graphicsQueue, VulkanTimeline* timeline = nullptr) {
+		if (texturePaths.empty())
+			throw std::runtime_error("No texture paths given to createTextureImages.");
+
+		if (formats.size() != texturePaths.size())
+			throw std::runtime_error("createTextureImages needs one format per texture path.");
+
+		std::vector<TextureDecode::ImageInfo> images = TextureDecode::queryImages(texturePaths); //Header reads only, gives every image its slice of one staging buffer
+		vk::DeviceSize stagingSize = TextureDecode::getTotalStagingSize(images);
+
+		vk::Buffer stagingBuffer;
+		vk::DeviceMemory stagingBufferMemory;
+
+		createBuffer(stagingSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingBufferMemory, logicalDevice, physicalDevice);
+		void* data;
+		vkMapMemory(logicalDevice, stagingBufferMemory, 0, stagingSize, 0, &data);
+
+		try {
+			TextureDecode::decodeInto(images, static_cast<uint8_t*>(data)); //Workers decode and expand to RGBA straight into mapped memory
+		}
+		catch (...) {
+			vkUnmapMemory(logicalDevice, stagingBufferMemory);
+			logicalDevice.destroyBuffer(stagingBuffer, nullptr);
+			vulkanFreeMemory(logicalDevice, stagingBufferMemory);
+			throw;
+		}
+
+		vkUnmapMemory(logicalDevice, stagingBufferMemory);
+
+		std::vector<vk::Image> textureImages(images.size());
+		textureImageMemories.resize(images.size());
+
+		for (size_t i = 0; i != images.size(); i++) {
+			uint32_t texWidth = static_cast<uint32_t>(images[i].width);
+			uint32_t texHeight = static_cast<uint32_t>(images[i].height);
+
+			createImage(texWidth, texHeight, formats[i], vk::ImageTiling::eOptimal,
+				vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+				vk::MemoryPropertyFlagBits::eDeviceLocal, textureImages[i], textureImageMemories[i], logicalDevice, physicalDevice
+			);
+
+			transitionImageLayout(textureImages[i], formats[i], vk::ImageLayout::eUndefined,
+				vk::ImageLayout::eTransferDstOptimal,
+				commandPool, logicalDevice, graphicsQueue, timeline
+			);
+
+			copyBufferToImage(stagingBuffer, textureImages[i], texWidth, texHeight, commandPool, logicalDevice, graphicsQueue, images[i].stagingOffset, timeline);
+
+			transitionImageLayout(textureImages[i], formats[i], vk::ImageLayout::eTransferDstOptimal,
+				vk::ImageLayout::eShaderReadOnlyOptimal,
+				commandPool, logicalDevice, graphicsQueue, timeline
+			);
+		}
+
+		logicalDevice.destroyBuffer(stagingBuffer, nullptr);
+		vulkanFreeMemory(logicalDevice, stagingBufferMemory);
+
+		return textureImages;
+	}
+
+	vk::Image createTextureImage(const std::string& texturePath, vk::Device& logicalDevice, vk::PhysicalDevice& physicalDevice, vk::DeviceMemory& textureImageMemory, vk::CommandPool& commandPool, vk::Queue& graphicsQueue, VulkanTimeline* timeline = nullptr) {
+		std::vector<vk::DeviceMemory> textureImageMemories;
+		std::vector<vk::Image> textureImages = createTextureImages({ texturePath }, { vk::Format::eR8G8B8A8Srgb }, logicalDevice, physicalDevice, textureImageMemories, commandPool, graphicsQueue, timeline);
+
+		textureImageMemory = textureImageMemories[0];
+		return textureImages[0];
+	}
+}
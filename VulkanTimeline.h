@@ -0,0 +1,269 @@
+#pragma once
+#include "VulkanWrapper.h"
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace CinderVk {
+	struct TimelineSubmitInfo {
+		std::vector<vk::CommandBuffer> commandBuffers;
+		std::vector<uint64_t> timelineWaits; //Earlier values on this timeline, e.g. an upload the graphics work reads
+		std::vector<vk::PipelineStageFlags> timelineWaitStages;
+		std::vector<vk::Semaphore> waitSemaphores; //Binary, e.g. swapchain image acquired
+		std::vector<vk::PipelineStageFlags> waitStages;
+		std::vector<vk::Semaphore> signalSemaphores; //Binary, e.g. ready to present
+	};
+
+	class VulkanTimeline : VulkanWrapper { //Every submission gets the next value, the CPU waits on or polls values instead of idling queues
+	public:
+		VulkanTimeline(VulkanCore* coreRef, bool useTimelineSemaphore) : VulkanWrapper(coreRef), timelineSemaphoreEnabled(useTimelineSemaphore) {
+			init();
+		}
+
+		uint64_t submit(vk::Queue queue, const TimelineSubmitInfo& info) {
+			if (!timelineSemaphoreEnabled) //Without timeline semaphores cross-submission waits happen on the CPU, before taking the lock so other threads aren't held up
+				for (uint64_t waitValue : info.timelineWaits)
+					wait(waitValue);
+
+			std::lock_guard<std::mutex> lock(submitMutex); //Values must reach the queue in the order they are handed out
+			std::lock_guard<std::mutex> queueLock(queueMutex);
+			uint64_t value = lastSubmittedValue + 1;
+
+			if (timelineSemaphoreEnabled)
+				submitTimeline(queue, info, value);
+			else
+				submitFence(queue, info, value);
+
+			lastSubmittedValue = value;
+			return value;
+		}
+
+		std::unique_lock<std::mutex> lockQueues() { //Hold around every other queue use, present and queue or device waitIdle, so a submit from another thread never overlaps them
+			return std::unique_lock<std::mutex>(queueMutex);
+		}
+
+		uint64_t getLastSubmittedValue() {
+			std::lock_guard<std::mutex> lock(submitMutex);
+			return lastSubmittedValue;
+		}
+
+		uint64_t getCompletedValue() { //Non-blocking
+			if (timelineSemaphoreEnabled) {
+				uint64_t value = 0;
+				pfnGetSemaphoreCounterValue(*getCorePtr()->getLogicalDevicePtr(), timelineSemaphore, &value);
+				return value;
+			}
+
+			std::lock_guard<std::mutex> lock(submitMutex);
+			retireSignalledFences();
+			return completedValue;
+		}
+
+		bool isComplete(uint64_t value) {
+			return getCompletedValue() >= value;
+		}
+
+		bool wait(uint64_t value, uint64_t timeout = UINT64_MAX) { //False on timeout
+			if (value == 0 || isComplete(value))
+				return true;
+
+			if (timelineSemaphoreEnabled) {
+				VkSemaphore semaphore = timelineSemaphore;
+				VkSemaphoreWaitInfoKHR waitInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR };
+				waitInfo.semaphoreCount = 1;
+				waitInfo.pSemaphores = &semaphore;
+				waitInfo.pValues = &value;
+
+				return pfnWaitSemaphores(*getCorePtr()->getLogicalDevicePtr(), &waitInfo, timeout) == VK_SUCCESS;
+			}
+
+			vk::Fence fence;
+			{
+				std::lock_guard<std::mutex> lock(submitMutex);
+				for (const auto& submission : inFlightSubmissions) { //Submissions retire in order, the first one at or past value covers it
+					if (submission.value >= value) {
+						fence = submission.fence;
+						break;
+					}
+				}
+
+				if (!fence) //Retired between the check and the lock
+					return true;
+
+				fenceWaiters[static_cast<VkFence>(fence)]++; //Keeps the fence from being recycled and reset while we wait on it
+			}
+
+			bool signalled = getCorePtr()->getLogicalDevicePtr()->waitForFences(1, &fence, VK_TRUE, timeout) == vk::Result::eSuccess;
+
+			std::lock_guard<std::mutex> lock(submitMutex);
+			auto waiters = fenceWaiters.find(static_cast<VkFence>(fence));
+
+			if (--waiters->second == 0) {
+				fenceWaiters.erase(waiters);
+
+				auto held = std::find(heldFences.begin(), heldFences.end(), fence);
+				if (held != heldFences.end()) { //Retired while we waited, last waiter out hands it back
+					heldFences.erase(held);
+					freeFences.push_back(fence);
+				}
+			}
+
+			return signalled;
+		}
+
+		bool isUsingTimelineSemaphore() {
+			return timelineSemaphoreEnabled;
+		}
+
+		~VulkanTimeline() {
+			cleanup();
+		}
+
+	private:
+		struct FenceSubmission {
+			uint64_t value;
+			vk::Fence fence;
+		};
+
+		const bool timelineSemaphoreEnabled;
+		vk::Semaphore timelineSemaphore;
+		PFN_vkWaitSemaphoresKHR pfnWaitSemaphores = nullptr;
+		PFN_vkGetSemaphoreCounterValueKHR pfnGetSemaphoreCounterValue = nullptr;
+
+		std::mutex submitMutex;
+		std::mutex queueMutex; //Taken after submitMutex, kept separate so a present blocking on vsync doesn't hold up wait and getCompletedValue
+		uint64_t lastSubmittedValue = 0;
+
+		uint64_t completedValue = 0; //Fence fallback only
+		std::deque<FenceSubmission> inFlightSubmissions;
+		std::vector<vk::Fence> freeFences;
+		std::unordered_map<VkFence, uint32_t> fenceWaiters; //Threads blocked in wait() on each fence
+		std::vector<vk::Fence> heldFences; //Retired but still waited on, recycled once fenceWaiters drops them
+
+		void init() {
+			if (!timelineSemaphoreEnabled)
+				return;
+
+			VkDevice device = *getCorePtr()->getLogicalDevicePtr();
+			pfnWaitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR"));
+			pfnGetSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR"));
+
+			if (!pfnWaitSemaphores || !pfnGetSemaphoreCounterValue)
+				throw std::runtime_error("Timeline semaphore functions are missing.");
+
+			VkSemaphoreTypeCreateInfoKHR typeInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR };
+			typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+			typeInfo.initialValue = 0;
+
+			vk::SemaphoreCreateInfo semaphoreInfo{};
+			semaphoreInfo.pNext = &typeInfo;
+
+			if (getCorePtr()->getLogicalDevicePtr()->createSemaphore(&semaphoreInfo, nullptr, &timelineSemaphore) != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to create the timeline semaphore.");
+		}
+
+		void cleanup() {
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+			wait(lastSubmittedValue);
+
+			device->destroySemaphore(timelineSemaphore, nullptr);
+
+			for (const auto& submission : inFlightSubmissions)
+				device->destroyFence(submission.fence, nullptr);
+
+			for (const auto& fence : freeFences)
+				device->destroyFence(fence, nullptr);
+
+			for (const auto& fence : heldFences)
+				device->destroyFence(fence, nullptr);
+		}
+
+		void submitTimeline(vk::Queue queue, const TimelineSubmitInfo& info, uint64_t value) {
+			std::vector<vk::Semaphore> waitSemaphores = info.waitSemaphores;
+			std::vector<vk::PipelineStageFlags> waitStages = info.waitStages;
+			std::vector<uint64_t> waitValues(info.waitSemaphores.size(), 0); //Ignored for binary semaphores
+
+			for (size_t i = 0; i != info.timelineWaits.size(); i++) {
+				waitSemaphores.push_back(timelineSemaphore);
+				waitStages.push_back(info.timelineWaitStages[i]);
+				waitValues.push_back(info.timelineWaits[i]);
+			}
+
+			std::vector<vk::Semaphore> signalSemaphores = info.signalSemaphores;
+			std::vector<uint64_t> signalValues(info.signalSemaphores.size(), 0);
+			signalSemaphores.push_back(timelineSemaphore);
+			signalValues.push_back(value);
+
+			vk::TimelineSemaphoreSubmitInfoKHR timelineInfo{};
+			timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+			timelineInfo.pWaitSemaphoreValues = waitValues.data();
+			timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+			timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+			vk::SubmitInfo submitInfo{};
+			submitInfo.pNext = &timelineInfo;
+			submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+			submitInfo.pWaitSemaphores = waitSemaphores.data();
+			submitInfo.pWaitDstStageMask = waitStages.data();
+			submitInfo.commandBufferCount = static_cast<uint32_t>(info.commandBuffers.size());
+			submitInfo.pCommandBuffers = info.commandBuffers.data();
+			submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+			submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+			if (queue.submit(1, &submitInfo, nullptr) != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to submit to the timeline.");
+		}
+
+		void submitFence(vk::Queue queue, const TimelineSubmitInfo& info, uint64_t value) { //info.timelineWaits were already waited for in submit
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+
+			retireSignalledFences();
+
+			vk::Fence fence;
+			if (!freeFences.empty()) {
+				fence = freeFences.back();
+				freeFences.pop_back();
+				device->resetFences(1, &fence);
+			}
+			else {
+				vk::FenceCreateInfo fenceInfo{};
+				if (device->createFence(&fenceInfo, nullptr, &fence) != vk::Result::eSuccess)
+					throw std::runtime_error("Failed to create a submission fence.");
+			}
+
+			vk::SubmitInfo submitInfo{};
+			submitInfo.waitSemaphoreCount = static_cast<uint32_t>(info.waitSemaphores.size());
+			submitInfo.pWaitSemaphores = info.waitSemaphores.data();
+			submitInfo.pWaitDstStageMask = info.waitStages.data();
+			submitInfo.commandBufferCount = static_cast<uint32_t>(info.commandBuffers.size());
+			submitInfo.pCommandBuffers = info.commandBuffers.data();
+			submitInfo.signalSemaphoreCount = static_cast<uint32_t>(info.signalSemaphores.size());
+			submitInfo.pSignalSemaphores = info.signalSemaphores.data();
+
+			if (queue.submit(1, &submitInfo, fence) != vk::Result::eSuccess) {
+				freeFences.push_back(fence);
+				throw std::runtime_error("Failed to submit to the timeline.");
+			}
+
+			inFlightSubmissions.push_back({ value, fence });
+		}
+
+		void retireSignalledFences() { //Caller holds submitMutex
+			vk::Device* device = getCorePtr()->getLogicalDevicePtr();
+
+			while (!inFlightSubmissions.empty() && device->getFenceStatus(inFlightSubmissions.front().fence) == vk::Result::eSuccess) {
+				vk::Fence fence = inFlightSubmissions.front().fence;
+				completedValue = inFlightSubmissions.front().value;
+
+				if (fenceWaiters.count(static_cast<VkFence>(fence))) //A waiter still holds it, resetting now could make its wait never return
+					heldFences.push_back(fence);
+				else
+					freeFences.push_back(fence);
+
+				inFlightSubmissions.pop_front();
+			}
+		}
+	};
+}
@@ -0,0 +1,31 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(binding = 1) uniform sampler2D albedoMap;
+
+#define CLUSTERED_LIGHTS_FRAGMENT //Bindings 6 to 8, so the manyLights scene pays for the cluster lookup and light loop like the real shader
+#include "clusteredLights.glsl"
+
+layout(location = 0) in vec3 fragColour;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) in vec3 fragNormal;
+layout(location = 3) in vec3 fragWorldPos;
+
+layout(location = 0) out vec4 outColour;
+
+void main() {
+	vec3 N = normalize(fragNormal);
+	vec3 lit = vec3(max(dot(N, normalize(vec3(0.4, 1.0, 0.3))), 0.0) * 0.8 + 0.2);
+
+	uvec2 cluster = clusterGrid.clusters[getClusterIndex(clusterGrid.header, gl_FragCoord.xy, fragWorldPos)];
+	for (uint i = 0; i != cluster.y; i++) { //Lambert only, same windowed falloff as fragmentShader
+		PointLight light = pLights.pointLights[clusterLightIndices.indices[cluster.x + i]];
+		vec3 toLight = light.positionRadius.xyz - fragWorldPos;
+		float distance = length(toLight);
+		float ratio = distance / light.positionRadius.w;
+		float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+		lit += light.colour.rgb * max(dot(N, toLight / max(distance, 1e-4)), 0.0) * window * window / max(distance * distance, 1e-4);
+	}
+
+	outColour = vec4(texture(albedoMap, fragTexCoord).rgb * fragColour * lit, 1.0);
+}
@@ -0,0 +1,35 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+//Synthetic benchmark scenes only, instance n of a draw is offset onto a grid so instanced cubes don't all overlap
+#define GRID_SIDE 64
+#define GRID_SPACING 3.0
+
+layout(binding = 0) uniform UniformBufferObject {
+	mat4 model;
+	mat4 view;
+	mat4 proj;
+} ubo;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColour;
+layout(location = 2) in vec2 inTexCoord;
+layout(location = 3) in vec3 inNormal;
+
+layout(location = 0) out vec3 fragColour;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 fragNormal;
+layout(location = 3) out vec3 fragWorldPos; //For the cluster lookup and the light vectors
+
+void main() {
+	uint instance = uint(gl_InstanceIndex);
+	vec3 offset = vec3(instance % GRID_SIDE, instance / (GRID_SIDE * GRID_SIDE), (instance / GRID_SIDE) % GRID_SIDE) * GRID_SPACING;
+
+	vec4 position = vec4(inPosition + offset, 1.0);
+
+	gl_Position = ubo.proj * ubo.view * ubo.model * position;
+	fragColour = inColour;
+	fragTexCoord = inTexCoord;
+	fragNormal = mat3(ubo.model) * inNormal;
+	fragWorldPos = (ubo.model * position).xyz;
+}
@@ -0,0 +1,49 @@
+#ifndef CLUSTERED_LIGHTS_GLSL
+#define CLUSTERED_LIGHTS_GLSL
+
+//Keep in sync with VulkanClusteredLighting.h
+#define CLUSTER_COUNT_X 16
+#define CLUSTER_COUNT_Y 9
+#define CLUSTER_COUNT_Z 24
+#define MAX_LIGHTS_PER_CLUSTER 256
+
+struct PointLight {
+	vec4 positionRadius; //World space position, influence radius in w
+	vec4 colour;
+};
+
+struct ClusterGridHeader {
+	vec4 clusterScale; //Screen pixels to tiles in xy, log(view depth) to slice scale and bias in zw
+	vec4 viewZRow; //Third row of the view matrix, view depth is -dot(viewZRow, vec4(worldPos, 1.0))
+};
+
+uint getClusterIndex(ClusterGridHeader header, vec2 fragCoord, vec3 worldPos) {
+	float viewDepth = max(-dot(header.viewZRow, vec4(worldPos, 1.0)), 1e-4);
+	uint slice = uint(max(log(viewDepth) * header.clusterScale.z + header.clusterScale.w, 0.0));
+	uvec2 tile = uvec2(fragCoord * header.clusterScale.xy);
+
+	tile = min(tile, uvec2(CLUSTER_COUNT_X - 1, CLUSTER_COUNT_Y - 1));
+	slice = min(slice, uint(CLUSTER_COUNT_Z - 1));
+
+	return tile.x + tile.y * CLUSTER_COUNT_X + slice * CLUSTER_COUNT_X * CLUSTER_COUNT_Y;
+}
+
+#ifdef CLUSTERED_LIGHTS_FRAGMENT
+//Fragment side, bindings 6 to 8 of VulkanDescriptorSetLayout. Loop with
+//	uvec2 cluster = clusterGrid.clusters[getClusterIndex(clusterGrid.header, gl_FragCoord.xy, WorldPos)];
+//	for (uint i = 0; i != cluster.y; i++) { PointLight light = pLights.pointLights[clusterLightIndices.indices[cluster.x + i]]; ... }
+layout(std430, binding = 6) readonly buffer PointLightBlock {
+	PointLight pointLights[];
+} pLights;
+
+layout(std430, binding = 7) readonly buffer ClusterGridBlock {
+	ClusterGridHeader header;
+	uvec2 clusters[]; //Offset into indices and light count
+} clusterGrid;
+
+layout(std430, binding = 8) readonly buffer ClusterLightIndexBlock {
+	uint indices[];
+} clusterLightIndices;
+#endif
+
+#endif
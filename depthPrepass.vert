@@ -0,0 +1,16 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(binding = 0) uniform UniformBufferObject {
+	mat4 model;
+	mat4 view;
+	mat4 proj;
+} ubo;
+
+layout(location = 0) in vec3 inPosition;
+
+invariant gl_Position; //The main pass tests eEqual against this, vertexShader must match bit for bit
+
+void main() {
+	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+}
@@ -0,0 +1,118 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+//Specialization constants, ids match MaterialFeature. A false constant compiles its map out and uses the stand-in value
+layout(constant_id = 0) const bool HAS_ALBEDO_MAP = true;
+layout(constant_id = 1) const bool HAS_NORMAL_MAP = true;
+layout(constant_id = 2) const bool HAS_METALLIC_MAP = true;
+layout(constant_id = 3) const bool HAS_ROUGHNESS_MAP = true;
+layout(constant_id = 4) const bool HAS_AO_MAP = true;
+layout(constant_id = 5) const bool SPECIALIZED = false; //Set by specialized pipelines, otherwise the maps are picked at runtime from material.features
+
+layout(push_constant) uniform MaterialConstants {
+	uint features; //MaterialFeature bits, only read by unspecialized pipelines
+} material;
+
+bool hasMap(bool specializedFlag, uint feature) { //Folds to the constant when specialized, a uniform branch per draw when not
+	return SPECIALIZED ? specializedFlag : (material.features & (1u << feature)) != 0u;
+}
+
+layout(binding = 1) uniform sampler2D albedoMap;
+layout(binding = 2) uniform sampler2D normalMap;
+layout(binding = 3) uniform sampler2D metallicMap;
+layout(binding = 4) uniform sampler2D roughnessMap;
+layout(binding = 5) uniform sampler2D aoMap;
+
+#define CLUSTERED_LIGHTS_FRAGMENT //Bindings 6 to 8, the lights and this frame's cluster lists
+#include "clusteredLights.glsl"
+#include "shadows.glsl" //Bindings 9 and 10, shadow tile i belongs to point light i
+
+layout(location = 0) in vec2 TexCoords;
+layout(location = 1) in vec3 WorldPos;
+layout(location = 2) in vec3 Normal;
+layout(location = 3) in vec3 camPos;
+
+layout(location = 0) out vec4 FragColour;
+
+const float PI = 3.14159265359;
+
+float DistributionGGX(vec3 N, vec3 H, float roughness) {
+	float a = roughness * roughness;
+	float a2 = a * a;
+	float NdotH = max(dot(N, H), 0.0);
+	float denom = NdotH * NdotH * (a2 - 1.0) + 1.0;
+	return a2 / (PI * denom * denom);
+}
+
+float GeometrySchlickGGX(float NdotV, float k) {
+	return NdotV / (NdotV * (1.0 - k) + k);
+}
+
+float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness) {
+	float r = roughness + 1.0;
+	float k = (r * r) / 8.0;
+	return GeometrySchlickGGX(max(dot(N, V), 0.0), k) * GeometrySchlickGGX(max(dot(N, L), 0.0), k);
+}
+
+vec3 fresnelSchlick(float cosTheta, vec3 F0) {
+	return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
+
+void main() {
+	vec3 albedo = vec3(1.0);
+	float metallic = 0.0;
+	float roughness = 0.5;
+	float ao = 1.0;
+
+	if (hasMap(HAS_ALBEDO_MAP, 0u))
+		albedo = pow(texture(albedoMap, TexCoords).rgb, vec3(2.2));
+
+	vec3 N = normalize(Normal);
+	if (hasMap(HAS_NORMAL_MAP, 1u)) { //Tangent frame from screen space derivatives, the vertex format has no tangents
+		vec3 Q1 = dFdx(WorldPos);
+		vec3 Q2 = dFdy(WorldPos);
+		vec2 st1 = dFdx(TexCoords);
+		vec2 st2 = dFdy(TexCoords);
+
+		vec3 T = normalize(Q1 * st2.t - Q2 * st1.t);
+		vec3 B = -normalize(cross(N, T));
+		N = normalize(mat3(T, B, N) * (texture(normalMap, TexCoords).xyz * 2.0 - 1.0));
+	}
+
+	if (hasMap(HAS_METALLIC_MAP, 2u))
+		metallic = texture(metallicMap, TexCoords).r;
+	if (hasMap(HAS_ROUGHNESS_MAP, 3u))
+		roughness = texture(roughnessMap, TexCoords).r;
+	if (hasMap(HAS_AO_MAP, 4u))
+		ao = texture(aoMap, TexCoords).r;
+
+	vec3 V = normalize(camPos - WorldPos);
+	vec3 F0 = mix(vec3(0.04), albedo, metallic);
+
+	vec3 Lo = vec3(0.0);
+	uvec2 cluster = clusterGrid.clusters[getClusterIndex(clusterGrid.header, gl_FragCoord.xy, WorldPos)];
+	for (uint i = 0; i != cluster.y; i++) {
+		PointLight light = pLights.pointLights[clusterLightIndices.indices[cluster.x + i]];
+		vec3 L = normalize(light.positionRadius.xyz - WorldPos);
+		vec3 H = normalize(V + L);
+		float distance = length(light.positionRadius.xyz - WorldPos);
+		float ratio = distance / light.positionRadius.w;
+		float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0); //Reaches zero at the culling radius, so culled lights can't pop
+		float attenuation = window * window / max(distance * distance, 1e-4) * getPointShadow(clusterLightIndices.indices[cluster.x + i], light.positionRadius.xyz, WorldPos);
+		vec3 radiance = light.colour.rgb * attenuation;
+
+		float NDF = DistributionGGX(N, H, roughness);
+		float G = GeometrySmith(N, V, L, roughness);
+		vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
+
+		vec3 kD = (vec3(1.0) - F) * (1.0 - metallic);
+		float NdotL = max(dot(N, L), 0.0);
+		vec3 specular = (NDF * G * F) / (4.0 * max(dot(N, V), 0.0) * NdotL + 0.0001);
+		Lo += (kD * albedo / PI + specular) * radiance * NdotL;
+	}
+
+	vec3 colour = vec3(0.03) * albedo * ao + Lo;
+	colour = colour / (colour + vec3(1.0));
+	colour = pow(colour, vec3(1.0 / 2.2));
+	FragColour = vec4(colour, 1.0);
+}
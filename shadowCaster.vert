@@ -0,0 +1,13 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(push_constant) uniform ShadowCasterConstants {
+	mat4 viewProjection; //Pushed by VulkanShadowCache per tile
+	mat4 model; //Pushed by the caster callback per draw
+} constants;
+
+layout(location = 0) in vec3 inPosition;
+
+void main() {
+	gl_Position = constants.viewProjection * constants.model * vec4(inPosition, 1.0);
+}
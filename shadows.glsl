@@ -0,0 +1,53 @@
+#ifndef SHADOWS_GLSL
+#define SHADOWS_GLSL
+
+//Keep in sync with VulkanShadowCache.h
+#define MAX_SHADOWED_LIGHTS 64
+#define SHADOW_TILES_PER_LIGHT 6
+
+struct ShadowTile {
+	mat4 viewProjection;
+	vec4 atlasRect; //Offset and size in atlas UVs, zero size when the light has no tile
+};
+
+//Fragment side, bindings 9 and 10 of VulkanDescriptorSetLayout
+layout(binding = 9) uniform sampler2DShadow shadowAtlas;
+
+layout(std430, binding = 10) readonly buffer ShadowTileBlock {
+	ShadowTile tiles[];
+} shadowTiles;
+
+uint getCubeFace(vec3 lightToFragment) { //Same face order as VulkanShadowCache, +x -x +y -y +z -z
+	vec3 a = abs(lightToFragment);
+
+	if (a.x >= a.y && a.x >= a.z)
+		return lightToFragment.x > 0.0 ? 0u : 1u;
+	if (a.y >= a.z)
+		return lightToFragment.y > 0.0 ? 2u : 3u;
+	return lightToFragment.z > 0.0 ? 4u : 5u;
+}
+
+float sampleShadowTile(uint tileIndex, vec3 worldPos) { //1.0 lit, 0.0 shadowed
+	ShadowTile tile = shadowTiles.tiles[tileIndex];
+	if (tile.atlasRect.z == 0.0)
+		return 1.0;
+
+	vec4 clip = tile.viewProjection * vec4(worldPos, 1.0);
+	vec3 ndc = clip.xyz / clip.w;
+	vec2 uv = clamp(ndc.xy * 0.5 + 0.5, vec2(0.0), vec2(1.0)); //Clamped so filtering never reads a neighbouring tile
+
+	return textureLod(shadowAtlas, vec3(tile.atlasRect.xy + uv * tile.atlasRect.zw, ndc.z), 0.0); //One mip, and callers sample inside light loops
+}
+
+float getPointShadow(uint lightIndex, vec3 lightPos, vec3 worldPos) { //Lights past MAX_SHADOWED_LIGHTS are lit, the tile buffer ends there
+	if (lightIndex >= MAX_SHADOWED_LIGHTS)
+		return 1.0;
+
+	return sampleShadowTile(lightIndex * SHADOW_TILES_PER_LIGHT + getCubeFace(worldPos - lightPos), worldPos);
+}
+
+float getDirectionalShadow(uint lightIndex, vec3 worldPos) {
+	return sampleShadowTile(lightIndex * SHADOW_TILES_PER_LIGHT, worldPos);
+}
+
+#endif
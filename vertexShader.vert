@@ -0,0 +1,27 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(binding = 0) uniform UniformBufferObject {
+	mat4 model;
+	mat4 view;
+	mat4 proj;
+} ubo;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 2) in vec2 inTexCoord;
+layout(location = 3) in vec3 inNormal;
+
+layout(location = 0) out vec2 TexCoords;
+layout(location = 1) out vec3 WorldPos; //World space, what the cluster lookup and the light vectors need
+layout(location = 2) out vec3 Normal;
+layout(location = 3) out vec3 cameraPos;
+
+invariant gl_Position; //Same expression as depthPrepass, the main pass tests eEqual against its depth
+
+void main() {
+	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+	TexCoords = inTexCoord;
+	WorldPos = (ubo.model * vec4(inPosition, 1.0)).xyz;
+	Normal = mat3(ubo.model) * inNormal; //Models are only scaled uniformly
+	cameraPos = inverse(ubo.view)[3].xyz;
+}